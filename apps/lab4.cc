@@ -83,6 +83,13 @@ class NetworkInterfaceAdapter : public TCPOverIPv4Adapter {
         }
     }
 
+    void send_pending(IOUring &ring) {
+        while (not _interface.frames_out().empty()) {
+            ring.write(_data_socket_pair.first, _interface.frames_out().front().serialize());
+            _interface.frames_out().pop();
+        }
+    }
+
   public:
     NetworkInterfaceAdapter(const Address &ip_address, const Address &next_hop)
         : _interface(random_host_ethernet_address(), ip_address), _next_hop(next_hop) {}
@@ -110,6 +117,10 @@ class NetworkInterfaceAdapter : public TCPOverIPv4Adapter {
         _interface.send_datagram(wrap_tcp_in_ip(seg), _next_hop);
         send_pending();
     }
+    void write(TCPSegment &seg, IOUring &ring) {
+        _interface.send_datagram(wrap_tcp_in_ip(seg), _next_hop);
+        send_pending(ring);
+    }
     void tick(const size_t ms_since_last_tick) {
         _interface.tick(ms_since_last_tick);
         send_pending();
@@ -1,112 +1,313 @@
+#include "tcp_config.hh"
 #include "tcp_connection.hh"
 
+#include <algorithm>
 #include <chrono>
 #include <cstdlib>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <random>
 #include <string>
+#include <unordered_set>
+#include <vector>
 
 using namespace std;
 using namespace std::chrono;
 
-constexpr size_t len = 100 * 1024 * 1024;
+constexpr size_t LEN_DFLT = 100 * 1024 * 1024;
+
+//! How segments are delivered between the two ends of each connection pair
+struct ScenarioConfig {
+    TCPConfig tcp{};             //!< configuration of both ends
+    size_t len = LEN_DFLT;       //!< bytes sent from x to y, per connection pair
+    size_t pairs = 1;            //!< number of connection pairs driven by the same loop
+    double loss_rate = 0;        //!< probability that a segment is dropped
+    double dup_rate = 0;         //!< probability that a segment is delivered twice
+    size_t reorder_window = 0;   //!< segments are shuffled within windows of this many (0 or 1: in order)
+    bool reverse = false;        //!< deliver each batch of segments fully reversed
+    string description = "";     //!< printed with the results
+};
+
+//! What happened to the segments of one run
+struct ScenarioStats {
+    size_t segments = 0;         //!< segments delivered (both directions, counting duplicates)
+    size_t retransmissions = 0;  //!< segments from x whose sequence number x had already sent
+};
+
+static void show_usage(const char *argv0, const char *msg) {
+    cout << "Usage: " << argv0 << " [options]\n\n"
+
+         << "   Option                                                          Default\n"
+         << "   --                                                              --\n\n"
+
+         << "   -n <bytes>      Transfer <bytes> per connection pair            " << LEN_DFLT << "\n\n"
+
+         << "   -s <bytes>      Set send_capacity to <bytes>                    " << TCPConfig::DEFAULT_CAPACITY
+         << "\n"
+         << "   -r <bytes>      Set recv_capacity to <bytes>                    " << TCPConfig::DEFAULT_CAPACITY
+         << "\n"
+         << "   -p <bytes>      Set max_payload_size to <bytes>                 " << TCPConfig::MAX_PAYLOAD_SIZE
+         << "\n"
+         << "   -t <tmout>      Set rt_timeout to tmout                         " << TCPConfig::TIMEOUT_DFLT << "\n\n"
+
+         << "   -L <loss>       Drop segments at <rate> (float in 0..1)         (no loss)\n"
+         << "   -D <dup>        Duplicate segments at <rate> (float in 0..1)    (no duplication)\n"
+         << "   -R <window>     Shuffle segments within <window> segments       (in order, then reversed)\n"
+         << "   -c <pairs>      Run <pairs> connection pairs concurrently       1\n\n"
+
+         << "   -h              Show this message and quit.\n\n"
+
+         << "   With no delivery options (-L, -D, -R) the benchmark runs twice,\n"
+         << "   once in order and once with every batch of segments reversed.\n\n";
+
+    if (msg != nullptr) {
+        cout << msg;
+    }
+    cout << endl;
+}
+
+static void check_argc(int argc, char **argv, int curr, const char *err) {
+    if (curr + 1 >= argc) {
+        show_usage(argv[0], err);
+        exit(1);
+    }
+}
+
+static vector<ScenarioConfig> get_config(int argc, char **argv) {
+    ScenarioConfig cfg{};
+    bool custom_delivery = false;
+
+    int curr = 1;
+    while (curr < argc) {
+        if (strncmp("-n", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -n requires one argument.");
+            cfg.len = strtoull(argv[curr + 1], nullptr, 0);
+            curr += 2;
+
+        } else if (strncmp("-s", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -s requires one argument.");
+            cfg.tcp.send_capacity = strtoull(argv[curr + 1], nullptr, 0);
+            curr += 2;
+
+        } else if (strncmp("-r", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -r requires one argument.");
+            cfg.tcp.recv_capacity = strtoull(argv[curr + 1], nullptr, 0);
+            curr += 2;
+
+        } else if (strncmp("-p", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -p requires one argument.");
+            cfg.tcp.max_payload_size = strtoull(argv[curr + 1], nullptr, 0);
+            curr += 2;
+
+        } else if (strncmp("-t", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -t requires one argument.");
+            cfg.tcp.rt_timeout = strtol(argv[curr + 1], nullptr, 0);
+            curr += 2;
+
+        } else if (strncmp("-L", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -L requires one argument.");
+            cfg.loss_rate = strtod(argv[curr + 1], nullptr);
+            custom_delivery = true;
+            curr += 2;
+
+        } else if (strncmp("-D", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -D requires one argument.");
+            cfg.dup_rate = strtod(argv[curr + 1], nullptr);
+            custom_delivery = true;
+            curr += 2;
+
+        } else if (strncmp("-R", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -R requires one argument.");
+            cfg.reorder_window = strtoull(argv[curr + 1], nullptr, 0);
+            custom_delivery = true;
+            curr += 2;
+
+        } else if (strncmp("-c", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -c requires one argument.");
+            cfg.pairs = max<size_t>(1, strtoull(argv[curr + 1], nullptr, 0));
+            curr += 2;
+
+        } else if (strncmp("-h", argv[curr], 3) == 0) {
+            show_usage(argv[0], nullptr);
+            exit(0);
+
+        } else {
+            show_usage(argv[0], std::string("ERROR: unrecognized option " + std::string(argv[curr])).c_str());
+            exit(1);
+        }
+    }
+
+    if (custom_delivery) {
+        cfg.description = "loss " + to_string(cfg.loss_rate) + ", dup " + to_string(cfg.dup_rate) +
+                          ", reorder window " + to_string(cfg.reorder_window);
+        return {cfg};
+    }
+
+    ScenarioConfig reversed = cfg;
+    reversed.reverse = true;
+    cfg.description = "in order";
+    reversed.description = "with reordering";
+    return {cfg, reversed};
+}
+
+//! Deliver the segments queued by x to y; if `perturb`, drop, duplicate and reorder them as configured
+void move_segments(TCPConnection &x,
+                   TCPConnection &y,
+                   vector<TCPSegment> &segments,
+                   const ScenarioConfig &cfg,
+                   const bool perturb,
+                   mt19937 &rd,
+                   ScenarioStats &stats,
+                   unordered_set<uint32_t> *seqnos_sent) {
+    bernoulli_distribution drop{perturb ? cfg.loss_rate : 0}, dup{perturb ? cfg.dup_rate : 0};
 
-void move_segments(TCPConnection &x, TCPConnection &y, vector<TCPSegment> &segments, const bool reorder) {
     while (not x.segments_out().empty()) {
-        segments.emplace_back(move(x.segments_out().front()));
+        TCPSegment &seg = x.segments_out().front();
+        if (seqnos_sent and seg.length_in_sequence_space() > 0 and
+            not seqnos_sent->insert(seg.header().seqno.raw_value()).second) {
+            stats.retransmissions++;
+        }
+        if (not drop(rd)) {
+            if (dup(rd)) {
+                segments.push_back(seg);
+            }
+            segments.emplace_back(move(seg));
+        }
         x.segments_out().pop();
     }
-    if (reorder) {
-        for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
-            y.segment_received(move(*it));
-        }
-    } else {
-        for (auto it = segments.begin(); it != segments.end(); ++it) {
-            y.segment_received(move(*it));
+
+    if (perturb and cfg.reverse) {
+        reverse(segments.begin(), segments.end());
+    } else if (perturb and cfg.reorder_window > 1) {
+        for (size_t i = 0; i < segments.size(); i += cfg.reorder_window) {
+            const size_t end = min(i + cfg.reorder_window, segments.size());
+            shuffle(segments.begin() + i, segments.begin() + end, rd);
         }
     }
+
+    for (auto &seg : segments) {
+        y.segment_received(move(seg));
+    }
+    stats.segments += segments.size();
     segments.clear();
 }
 
-void main_loop(const bool reorder) {
-    TCPConfig config;
-    TCPConnection x{config}, y{config};
+//! One connection pair: x sends `len` random bytes to y
+struct ConnectionPair {
+    TCPConnection x, y;
+    string string_to_send;
+    Buffer bytes_to_send;
+    string string_received{};
+    bool x_closed{false};
+    unordered_set<uint32_t> seqnos_sent{};
 
-    string string_to_send(len, 'x');
-    for (auto &ch : string_to_send) {
-        ch = rand();
+    ConnectionPair(const ScenarioConfig &cfg)
+        : x{cfg.tcp}, y{cfg.tcp}, string_to_send(cfg.len, 'x'), bytes_to_send() {
+        for (auto &ch : string_to_send) {
+            ch = rand();
+        }
+        bytes_to_send = Buffer{string(string_to_send)};
+        string_received.reserve(cfg.len);
+        x.connect();
+        y.end_input_stream();
     }
+};
 
-    Buffer bytes_to_send{string(string_to_send)};
-    x.connect();
-    y.end_input_stream();
+void main_loop(const ScenarioConfig &cfg) {
+    mt19937 rd{random_device()()};
+    // ConnectionPair can only be copied, and copying active connections is costly (and noisy), so never regrow
+    vector<ConnectionPair> pairs;
+    pairs.reserve(cfg.pairs);
+    for (size_t i = 0; i < cfg.pairs; i++) {
+        pairs.emplace_back(cfg);
+    }
 
-    bool x_closed = false;
+    ScenarioStats stats;
+    vector<TCPSegment> segments;
+    vector<uint64_t> loop_ns;
 
-    string string_received;
-    string_received.reserve(len);
+    auto loop = [&] {
+        for (auto &conn : pairs) {
+            auto &x = conn.x, &y = conn.y;
+            auto &bytes_to_send = conn.bytes_to_send;
 
-    const auto first_time = high_resolution_clock::now();
+            // write input into x
+            while (bytes_to_send.size() and x.remaining_outbound_capacity()) {
+                const auto want = min(x.remaining_outbound_capacity(), bytes_to_send.size());
+                const auto written = x.write(string(bytes_to_send.str().substr(0, want)));
+                if (want != written) {
+                    throw runtime_error("want = " + to_string(want) + ", written = " + to_string(written));
+                }
+                bytes_to_send.remove_prefix(written);
+            }
 
-    auto loop = [&] {
-        // write input into x
-        while (bytes_to_send.size() and x.remaining_outbound_capacity()) {
-            const auto want = min(x.remaining_outbound_capacity(), bytes_to_send.size());
-            const auto written = x.write(string(bytes_to_send.str().substr(0, want)));
-            if (want != written) {
-                throw runtime_error("want = " + to_string(want) + ", written = " + to_string(written));
+            if (bytes_to_send.size() == 0 and not conn.x_closed) {
+                x.end_input_stream();
+                conn.x_closed = true;
             }
-            bytes_to_send.remove_prefix(written);
-        }
 
-        if (bytes_to_send.size() == 0 and not x_closed) {
-            x.end_input_stream();
-            x_closed = true;
-        }
+            // exchange segments between x and y (only the x -> y direction is reordered)
+            move_segments(x, y, segments, cfg, true, rd, stats, &conn.seqnos_sent);
+            move_segments(y, x, segments, cfg, false, rd, stats, nullptr);
 
-        // exchange segments between x and y but in reverse order
-        vector<TCPSegment> segments;
-        move_segments(x, y, segments, reorder);
-        move_segments(y, x, segments, false);
+            // read output from y
+            const auto available_output = y.inbound_stream().buffer_size();
+            if (available_output > 0) {
+                conn.string_received.append(y.inbound_stream().read(available_output));
+            }
 
-        // read output from y
-        const auto available_output = y.inbound_stream().buffer_size();
-        if (available_output > 0) {
-            string_received.append(y.inbound_stream().read(available_output));
+            // time passes
+            x.tick(1000);
+            y.tick(1000);
         }
+    };
 
-        // time passes
-        x.tick(1000);
-        y.tick(1000);
+    const auto all_eof = [&] {
+        return all_of(pairs.begin(), pairs.end(), [](ConnectionPair &p) { return p.y.inbound_stream().eof(); });
     };
 
-    while (not y.inbound_stream().eof()) {
+    const auto first_time = high_resolution_clock::now();
+
+    while (not all_eof()) {
+        const auto loop_start = high_resolution_clock::now();
         loop();
+        loop_ns.push_back(duration_cast<nanoseconds>(high_resolution_clock::now() - loop_start).count());
     }
 
-    if (string_received != string_to_send) {
-        throw runtime_error("strings sent vs. received don't match");
+    for (const auto &conn : pairs) {
+        if (conn.string_received != conn.string_to_send) {
+            throw runtime_error("strings sent vs. received don't match");
+        }
     }
 
     const auto final_time = high_resolution_clock::now();
 
     const auto duration = duration_cast<nanoseconds>(final_time - first_time).count();
 
-    const auto gigabits_per_second = len * 8.0 / double(duration);
+    const auto gigabits_per_second = cfg.len * cfg.pairs * 8.0 / double(duration);
+    const auto segments_per_second = stats.segments * 1e9 / double(duration);
+
+    sort(loop_ns.begin(), loop_ns.end());
+    const auto percentile = [&](const double p) {
+        return loop_ns.empty() ? 0 : loop_ns.at(min(loop_ns.size() - 1, size_t(p * loop_ns.size())));
+    };
 
     cout << fixed << setprecision(2);
-    cout << "CPU-limited throughput" << (reorder ? " with reordering: " : "                : ") << gigabits_per_second
-         << " Gbit/s\n";
+    cout << "CPU-limited throughput " << cfg.description << ": " << gigabits_per_second << " Gbit/s, "
+         << segments_per_second << " segments/s, " << stats.retransmissions << " retransmissions, loop p50 "
+         << percentile(0.50) / 1000.0 << " us, p99 " << percentile(0.99) / 1000.0 << " us\n";
 
-    while (x.active() or y.active()) {
+    while (any_of(pairs.begin(), pairs.end(), [](ConnectionPair &p) { return p.x.active() or p.y.active(); })) {
         loop();
     }
 }
 
-int main() {
+int main(int argc, char **argv) {
     try {
-        main_loop(false);
-        main_loop(true);
+        for (const auto &cfg : get_config(argc, argv)) {
+            main_loop(cfg);
+        }
     } catch (const exception &e) {
         cerr << e.what() << "\n";
         return EXIT_FAILURE;
@@ -31,6 +31,8 @@ static void show_usage(const char *argv0, const char *msg) {
          << "   -Lu <loss>      Set uplink loss to <rate> (float in 0..1)       (no loss)\n"
          << "   -Ld <loss>      Set downlink loss to <rate> (float in 0..1)     (no loss)\n\n"
 
+         << "   -g              Send with UDP GSO, receive with UDP GRO         (off)\n\n"
+
          << "   -h              Show this message and quit.\n\n";
 
     if (msg != nullptr) {
@@ -84,6 +86,10 @@ static tuple<TCPConfig, FdAdapterConfig, bool> get_config(int argc, char **argv)
                 static_cast<LossRateDnT>(static_cast<float>(numeric_limits<LossRateDnT>::max()) * lossrate);
             curr += 2;
 
+        } else if (strncmp("-g", argv[curr], 3) == 0) {
+            c_filt.udp_gso = true;
+            curr += 1;
+
         } else if (strncmp("-h", argv[curr], 3) == 0) {
             show_usage(argv[0], nullptr);
             exit(0);
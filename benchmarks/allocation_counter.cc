@@ -0,0 +1,22 @@
+#include "benchmark_util.hh"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global allocation functions of the benchmark binary to count calls to operator new
+
+static std::atomic<uint64_t> allocations{0};
+
+uint64_t allocation_count() { return allocations.load(std::memory_order_relaxed); }
+
+void *operator new(const size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
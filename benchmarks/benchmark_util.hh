@@ -0,0 +1,84 @@
+#ifndef SPONGE_BENCHMARKS_BENCHMARK_UTIL_HH
+#define SPONGE_BENCHMARKS_BENCHMARK_UTIL_HH
+
+#include "arp_message.hh"
+#include "ethernet_frame.hh"
+#include "ipv4_datagram.hh"
+#include "tcp_segment.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+//! Number of calls to operator new so far (counted by allocation_counter.cc)
+uint64_t allocation_count();
+
+//! Silences the DEBUG lines that NetworkInterface and Router print to std::cerr while it is alive
+class QuietStderr {
+  public:
+    QuietStderr() { std::cerr.setstate(std::ios::failbit); }
+    ~QuietStderr() { std::cerr.clear(); }
+    QuietStderr(const QuietStderr &) = delete;
+    QuietStderr &operator=(const QuietStderr &) = delete;
+};
+
+//! A string of `len` pseudo-random bytes (the same bytes on every call)
+inline std::string random_bytes(const size_t len) {
+    auto rd = std::mt19937{0};
+    std::string ret(len, 0);
+    std::generate(ret.begin(), ret.end(), [&] { return rd(); });
+    return ret;
+}
+
+//! A TCP segment carrying `payload_len` bytes
+inline TCPSegment make_segment(const size_t payload_len) {
+    TCPSegment seg;
+    seg.header().sport = 3000;
+    seg.header().dport = 4000;
+    seg.header().seqno = WrappingInt32{1234};
+    seg.header().ack = true;
+    seg.header().ackno = WrappingInt32{5678};
+    seg.header().win = 64000;
+    seg.payload() = Buffer{random_bytes(payload_len)};
+    return seg;
+}
+
+//! An IPv4 datagram from `src` to `dst` carrying `payload_len` bytes
+inline InternetDatagram make_datagram(const uint32_t src, const uint32_t dst, const size_t payload_len) {
+    InternetDatagram dgram;
+    dgram.header().src = src;
+    dgram.header().dst = dst;
+    dgram.payload() = Buffer{random_bytes(payload_len)};
+    dgram.header().len = dgram.header().hlen * 4 + dgram.payload().size();
+    return dgram;
+}
+
+//! An Ethernet frame carrying `payload`
+inline EthernetFrame make_frame(const EthernetAddress &src,
+                                const EthernetAddress &dst,
+                                const uint16_t type,
+                                const BufferList &payload) {
+    EthernetFrame frame;
+    frame.header() = {dst, src, type};
+    frame.payload() = payload.concatenate();
+    return frame;
+}
+
+//! An ARP reply telling `target` that `sender_ip` is at `sender_eth`
+inline EthernetFrame make_arp_reply(const EthernetAddress &sender_eth,
+                                    const uint32_t sender_ip,
+                                    const EthernetAddress &target_eth,
+                                    const uint32_t target_ip) {
+    ARPMessage arp;
+    arp.opcode = ARPMessage::OPCODE_REPLY;
+    arp.sender_ethernet_address = sender_eth;
+    arp.sender_ip_address = sender_ip;
+    arp.target_ethernet_address = target_eth;
+    arp.target_ip_address = target_ip;
+    return make_frame(sender_eth, target_eth, EthernetHeader::TYPE_ARP, arp.serialize());
+}
+
+#endif  // SPONGE_BENCHMARKS_BENCHMARK_UTIL_HH
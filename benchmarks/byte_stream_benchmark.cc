@@ -0,0 +1,49 @@
+#include "benchmark_util.hh"
+#include "byte_stream.hh"
+
+#include <benchmark/benchmark.h>
+#include <string>
+
+using namespace std;
+
+static constexpr size_t CAPACITY = 64 * 1024;
+
+//! Fill the stream with `chunk`-sized writes, then drain it with `chunk`-sized reads
+static void BM_ByteStreamWriteRead(benchmark::State &state) {
+    const size_t chunk = state.range(0);
+    const bool chunked = state.range(1);
+    const string data = random_bytes(chunk);
+    ByteStream stream{CAPACITY, chunked};
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < CAPACITY / chunk; i++) {
+            stream.write(data);
+        }
+        while (stream.buffer_size() > 0) {
+            benchmark::DoNotOptimize(stream.read(chunk));
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * (CAPACITY / chunk) * chunk);
+}
+BENCHMARK(BM_ByteStreamWriteRead)->ArgNames({"chunk", "chunked"})->ArgsProduct({{1, 64, 1460, 16384}, {0, 1}});
+
+//! Same, but draining through the zero-copy peek_buffers()/pop_output() path
+static void BM_ByteStreamWritePeekPop(benchmark::State &state) {
+    const size_t chunk = state.range(0);
+    const bool chunked = state.range(1);
+    const string data = random_bytes(chunk);
+    ByteStream stream{CAPACITY, chunked};
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < CAPACITY / chunk; i++) {
+            stream.write(data);
+        }
+        while (stream.buffer_size() > 0) {
+            const auto views = stream.peek_buffers(chunk);
+            benchmark::DoNotOptimize(views.size());
+            stream.pop_output(views.size());
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * (CAPACITY / chunk) * chunk);
+}
+BENCHMARK(BM_ByteStreamWritePeekPop)->ArgNames({"chunk", "chunked"})->ArgsProduct({{64, 1460, 16384}, {0, 1}});
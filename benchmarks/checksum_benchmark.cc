@@ -0,0 +1,38 @@
+#include "benchmark_util.hh"
+#include "util.hh"
+
+#include <benchmark/benchmark.h>
+#include <string>
+
+using namespace std;
+
+static void BM_InternetChecksum(benchmark::State &state, const string &kernel) {
+    const string data = random_bytes(state.range(0));
+    if (not InternetChecksum::use_kernel(kernel)) {
+        state.SkipWithError("checksum kernel is not supported");
+        return;
+    }
+
+    for (auto _ : state) {
+        InternetChecksum check;
+        check.add(data);
+        benchmark::DoNotOptimize(check.value());
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+
+    // leave the fastest kernel selected for the other benchmarks
+    InternetChecksum::use_kernel(InternetChecksum::kernels().back());
+}
+
+//! One benchmark per checksum kernel the CPU supports, e.g. BM_InternetChecksum/avx2/1500
+static const bool checksum_benchmarks_registered = [] {
+    for (const auto &kernel : InternetChecksum::kernels()) {
+        benchmark::RegisterBenchmark(("BM_InternetChecksum/" + kernel).c_str(), BM_InternetChecksum, kernel)
+            ->Arg(20)
+            ->Arg(64)
+            ->Arg(576)
+            ->Arg(1500)
+            ->Arg(9000);
+    }
+    return true;
+}();
@@ -0,0 +1,45 @@
+#include "eventloop.hh"
+#include "file_descriptor.hh"
+#include "util.hh"
+
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+//! One wakeup with `fds` idle fds registered and one of them ready, like a server with many quiet
+//! connections; backend 0 is poll(2), backend 1 is epoll
+static void BM_EventLoopWait(benchmark::State &state) {
+    const auto backend = state.range(0) ? EventLoop::Backend::Epoll : EventLoop::Backend::Poll;
+    const size_t nfds = state.range(1);
+
+    EventLoop loop{backend};
+    vector<FileDescriptor> fds;
+    fds.reserve(nfds);  // the callbacks refer to the elements
+    try {
+        for (size_t i = 0; i < nfds; i++) {
+            fds.emplace_back(SystemCall("eventfd", ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)));
+            FileDescriptor &fd = fds.back();
+            loop.add_rule(fd, Direction::In, [&fd] { fd.read(sizeof(uint64_t)); });
+        }
+    } catch (const unix_error &e) {
+        state.SkipWithError(e.what());  // e.g. too many open files
+        return;
+    }
+
+    const uint64_t one = 1;
+    size_t next = 0;
+    for (auto _ : state) {
+        SystemCall("write", ::write(fds[next].fd_num(), &one, sizeof(one)));
+        next = (next + 1) % nfds;
+        benchmark::DoNotOptimize(loop.wait_next_event(0));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EventLoopWait)
+    ->ArgNames({"epoll", "fds"})
+    ->ArgsProduct({{0, 1}, {16, 1024, 16384}})
+    ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,54 @@
+#include "buffer.hh"
+#include "file_descriptor.hh"
+#include "io_uring.hh"
+#include "util.hh"
+
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <optional>
+#include <string>
+
+using namespace std;
+
+static constexpr size_t PACKET_LEN = 1500;
+
+//! `batch` packets written to /dev/null, one write(2) each (ring 0) or with one io_uring_enter (ring 1),
+//! to show the cost of the system calls themselves
+static void BM_BatchedWrite(benchmark::State &state) {
+    const bool use_ring = state.range(0);
+    const size_t batch = state.range(1);
+    if (use_ring and not IOUring::available()) {
+        state.SkipWithError("io_uring is not available");
+        return;
+    }
+
+    FileDescriptor devnull{SystemCall("open", ::open("/dev/null", O_WRONLY | O_CLOEXEC))};
+    const Buffer packet{string(PACKET_LEN, 'x')};
+    optional<IOUring> ring{};
+    if (use_ring) {
+        ring.emplace(batch);
+    }
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < batch; i++) {
+            if (ring) {
+                ring->write(devnull, packet);
+            } else {
+                devnull.write(packet.str());
+            }
+        }
+        if (ring) {
+            ring->submit();
+        }
+    }
+
+    const double syscalls = ring ? ring->submissions() : state.iterations() * batch;
+    state.counters["syscalls_per_MB"] = benchmark::Counter(
+        syscalls * 1e6 / (state.iterations() * batch * PACKET_LEN), benchmark::Counter::kDefaults);
+    state.SetItemsProcessed(state.iterations() * batch);
+    state.SetBytesProcessed(state.iterations() * batch * PACKET_LEN);
+}
+BENCHMARK(BM_BatchedWrite)
+    ->ArgNames({"ring", "batch"})
+    ->ArgsProduct({{0, 1}, {1, 8, 64}})
+    ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,91 @@
+#include "lpm_table.hh"
+
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+static constexpr size_t NDESTINATIONS = 1 << 20;
+
+struct Route {
+    uint32_t prefix;
+    uint8_t prefix_length;
+};
+
+//! A synthetic table with roughly the prefix-length mix of a full BGP table (mostly /24, few past /24)
+static vector<Route> make_routes(const size_t count) {
+    static constexpr uint8_t lengths[] = {24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 23, 23, 22, 22,
+                                          22, 21, 21, 20, 20, 19, 18, 17, 16, 16, 15, 14, 12, 8, 28, 32};
+    mt19937 rd{0};
+    vector<Route> routes;
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t prefix_length = lengths[rd() % size(lengths)];
+        routes.push_back({uint32_t(rd()) & (0xFFFFFFFF << (32 - prefix_length)), prefix_length});
+    }
+    return routes;
+}
+
+static LPMTable make_table(const vector<Route> &routes) {
+    LPMTable table;
+    for (size_t i = 0; i < routes.size(); i++) {
+        table.insert(routes[i].prefix, routes[i].prefix_length, i);
+    }
+    table.build();
+    return table;
+}
+
+static vector<uint32_t> make_destinations() {
+    mt19937 rd{1};
+    vector<uint32_t> dsts(NDESTINATIONS);
+    for (auto &dst : dsts) {
+        dst = rd();
+    }
+    return dsts;
+}
+
+static void BM_LPMTableBuild(benchmark::State &state) {
+    const auto routes = make_routes(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(make_table(routes).memory_usage());
+    }
+    state.SetItemsProcessed(state.iterations() * routes.size());
+}
+BENCHMARK(BM_LPMTableBuild)->ArgName("routes")->Arg(1000)->Arg(100000)->Arg(900000)->Unit(benchmark::kMillisecond);
+
+//! Random destinations against a synthetic table
+static void BM_LPMTableLookup(benchmark::State &state) {
+    const LPMTable table = make_table(make_routes(state.range(0)));
+    const auto dsts = make_destinations();
+
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(table.lookup(dsts[next++ % NDESTINATIONS]));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["trie_bytes"] = table.memory_usage();
+}
+BENCHMARK(BM_LPMTableLookup)->ArgName("routes")->Arg(1000)->Arg(100000)->Arg(900000);
+
+//! The linear scan Router used before, for comparison
+static void BM_LinearLookup(benchmark::State &state) {
+    const auto routes = make_routes(state.range(0));
+    const auto dsts = make_destinations();
+
+    size_t next = 0;
+    for (auto _ : state) {
+        const uint32_t dst = dsts[next++ % NDESTINATIONS];
+        uint8_t longest_prefix_match = 0;
+        size_t match = routes.size();
+        for (size_t i = 0; i < routes.size(); i++) {
+            const uint32_t netmask = routes[i].prefix_length == 0 ? 0 : 0xFFFFFFFF << (32 - routes[i].prefix_length);
+            if ((dst & netmask) == routes[i].prefix && routes[i].prefix_length >= longest_prefix_match) {
+                longest_prefix_match = routes[i].prefix_length;
+                match = i;
+            }
+        }
+        benchmark::DoNotOptimize(match);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LinearLookup)->ArgName("routes")->Arg(1000)->Arg(100000);
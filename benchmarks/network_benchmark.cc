@@ -0,0 +1,192 @@
+#include "benchmark_util.hh"
+#include "network_interface.hh"
+#include "router.hh"
+
+#include <benchmark/benchmark.h>
+#include <random>
+
+using namespace std;
+
+static constexpr size_t PAYLOAD_LEN = 1000;
+
+static const EthernetAddress LOCAL_ETH{0x02, 0, 0, 0, 0, 0x01};
+static const EthernetAddress REMOTE_ETH{0x02, 0, 0, 0, 0, 0x02};
+static const Address LOCAL_IP{"10.0.0.1"};
+static const Address REMOTE_IP{"10.0.0.2"};
+
+//! A NetworkInterface that already knows the Ethernet address of REMOTE_IP
+static NetworkInterface make_resolved_interface() {
+    QuietStderr quiet;
+    NetworkInterface iface{LOCAL_ETH, LOCAL_IP};
+    iface.recv_frame(make_arp_reply(REMOTE_ETH, REMOTE_IP.ipv4_numeric(), LOCAL_ETH, LOCAL_IP.ipv4_numeric()));
+    return iface;
+}
+
+static void BM_NetworkInterfaceSendDatagram(benchmark::State &state) {
+    NetworkInterface iface = make_resolved_interface();
+    const InternetDatagram dgram = make_datagram(LOCAL_IP.ipv4_numeric(), 0x08080808, PAYLOAD_LEN);
+
+    for (auto _ : state) {
+        iface.send_datagram(dgram, REMOTE_IP);
+        benchmark::DoNotOptimize(iface.frames_out().front());
+        iface.frames_out().pop();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_NetworkInterfaceSendDatagram);
+
+static void BM_NetworkInterfaceRecvFrame(benchmark::State &state) {
+    NetworkInterface iface = make_resolved_interface();
+    const EthernetFrame frame = make_frame(REMOTE_ETH,
+                                           LOCAL_ETH,
+                                           EthernetHeader::TYPE_IPv4,
+                                           make_datagram(0x08080808, LOCAL_IP.ipv4_numeric(), PAYLOAD_LEN).serialize());
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(iface.recv_frame(frame));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_NetworkInterfaceRecvFrame);
+
+//! A NetworkInterface that knows the Ethernet addresses of `neighbors` hosts, 10.128.0.0 onwards
+static NetworkInterface make_interface_with_neighbors(const size_t neighbors) {
+    QuietStderr quiet;
+    NetworkInterface iface{LOCAL_ETH, LOCAL_IP};
+    for (uint32_t i = 0; i < neighbors; i++) {
+        const EthernetAddress eth{0x02, 0, uint8_t(i >> 24), uint8_t(i >> 16), uint8_t(i >> 8), uint8_t(i)};
+        iface.recv_frame(make_arp_reply(eth, 0x0a800000 + i, LOCAL_ETH, LOCAL_IP.ipv4_numeric()));
+    }
+    while (not iface.frames_out().empty()) {
+        iface.frames_out().pop();
+    }
+    return iface;
+}
+
+//! Time passing with `neighbors` entries in the ARP cache, none of which expire yet
+static void BM_ARPCacheTick(benchmark::State &state) {
+    NetworkInterface iface = make_interface_with_neighbors(state.range(0));
+    for (auto _ : state) {
+        iface.tick(1);
+    }
+}
+// fewer ticks than the 30-second ARP timeout, so every tick measures the cost of nothing expiring
+BENCHMARK(BM_ARPCacheTick)->ArgName("neighbors")->Arg(1000)->Arg(100000)->Iterations(20000);
+
+//! Send datagrams to `neighbors` different next hops in turn, all already resolved
+static void BM_ARPCacheLookup(benchmark::State &state) {
+    const size_t neighbors = state.range(0);
+    NetworkInterface iface = make_interface_with_neighbors(neighbors);
+    const InternetDatagram dgram = make_datagram(LOCAL_IP.ipv4_numeric(), 0x08080808, PAYLOAD_LEN);
+
+    mt19937 rd{0};
+    vector<Address> next_hops;
+    for (size_t i = 0; i < 4096; i++) {
+        next_hops.push_back(Address::from_ipv4_numeric(0x0a800000 + rd() % neighbors));
+    }
+
+    size_t next = 0;
+    for (auto _ : state) {
+        iface.send_datagram(dgram, next_hops[next++ % next_hops.size()]);
+        iface.frames_out().pop();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ARPCacheLookup)->ArgName("neighbors")->Arg(1000)->Arg(100000);
+
+//! Route datagrams from interface 0 to interface 1 through a table of `routes` random prefixes,
+//! `batch` datagrams per call to route()
+static void BM_RouterRoute(benchmark::State &state) {
+    const size_t routes = state.range(0);
+    const size_t batch = state.range(1);
+    const Address next_hop{"10.0.1.2"};
+    const EthernetAddress next_hop_eth{0x02, 0, 0, 0, 0, 0x03};
+
+    Router router;
+    mt19937 rd{0};
+    {
+        QuietStderr quiet;
+        router.add_interface(AsyncNetworkInterface{REMOTE_ETH, Address{"10.0.0.2"}});
+        router.add_interface(AsyncNetworkInterface{LOCAL_ETH, Address{"10.0.1.1"}});
+        router.interface(1).recv_frame(
+            make_arp_reply(next_hop_eth, next_hop.ipv4_numeric(), LOCAL_ETH, Address{"10.0.1.1"}.ipv4_numeric()));
+
+        router.add_route(0, 0, next_hop, 1);
+        for (size_t i = 1; i < routes; i++) {
+            const uint8_t prefix_length = 8 + rd() % 17;
+            const uint32_t prefix = rd() & (0xFFFFFFFF << (32 - prefix_length));
+            router.add_route(prefix, prefix_length, next_hop, 1);
+        }
+    }
+
+    // destinations spread over the address space, so different routes match
+    vector<InternetDatagram> dgrams;
+    for (size_t i = 0; i < 256; i++) {
+        dgrams.push_back(make_datagram(0x0a000002, rd(), PAYLOAD_LEN));
+    }
+
+    size_t next = 0;
+    uint64_t allocations = 0;
+    for (auto _ : state) {
+        for (size_t i = 0; i < batch; i++) {
+            router.interface(0).datagrams_out().push(dgrams[next++ % dgrams.size()]);
+        }
+        const uint64_t before = allocation_count();
+        router.route();
+        allocations += allocation_count() - before;
+        auto &frames = router.interface(1).frames_out();
+        benchmark::DoNotOptimize(frames.size());
+        while (not frames.empty()) {
+            frames.pop();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+    state.counters["allocs_per_dgram"] = double(allocations) / (state.iterations() * batch);
+}
+BENCHMARK(BM_RouterRoute)->ArgNames({"routes", "batch"})->ArgsProduct({{1, 16, 256, 4096}, {1, 32}});
+
+//! Forward datagrams between `interfaces` interfaces in the multi-core mode: each iteration, every
+//! interface receives `batch` datagrams for the next interface's host, and the owner thread waits
+//! for all of them to come out. Wall-clock time, since the work happens on the worker threads.
+static void BM_RouterWorkers(benchmark::State &state) {
+    const size_t interfaces = state.range(0);
+    const size_t batch = 32;
+    const auto router_eth = [](const size_t i) { return EthernetAddress{0x02, 0, 0, 0, 0, uint8_t(i + 1)}; };
+    const auto host_eth = [](const size_t i) { return EthernetAddress{0x02, 0, 0, 0, 1, uint8_t(i + 1)}; };
+    const auto router_ip = [](const size_t i) { return uint32_t(0x0a000001 | (i << 8)); };
+    const auto host_ip = [](const size_t i) { return uint32_t(0x0a000002 | (i << 8)); };
+
+    Router router;
+    vector<EthernetFrame> frames;
+    {
+        QuietStderr quiet;
+        for (size_t i = 0; i < interfaces; i++) {
+            router.add_interface(AsyncNetworkInterface{router_eth(i), Address::from_ipv4_numeric(router_ip(i))});
+            router.add_route(router_ip(i) & 0xffffff00, 24, {}, i);
+            router.interface(i).recv_frame(make_arp_reply(host_eth(i), host_ip(i), router_eth(i), router_ip(i)));
+            frames.push_back(make_frame(host_eth(i),
+                                        router_eth(i),
+                                        EthernetHeader::TYPE_IPv4,
+                                        make_datagram(host_ip(i), host_ip((i + 1) % interfaces), PAYLOAD_LEN).serialize()));
+        }
+    }
+
+    router.start_workers();
+    for (auto _ : state) {
+        for (size_t n = 0; n < batch; n++) {
+            for (size_t i = 0; i < interfaces; i++) {
+                EthernetFrame frame = frames[i];
+                while (not router.push_frame(i, move(frame))) {
+                }
+            }
+        }
+        for (size_t i = 0; i < interfaces; i++) {
+            for (size_t n = 0; n < batch;) {
+                n += router.pop_frame(i).has_value();
+            }
+        }
+    }
+    router.stop_workers();
+    state.SetItemsProcessed(state.iterations() * batch * interfaces);
+}
+BENCHMARK(BM_RouterWorkers)->ArgName("interfaces")->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
@@ -0,0 +1,179 @@
+#include "benchmark_util.hh"
+#include "ipv4_datagram.hh"
+#include "packet_buffer.hh"
+#include "tcp_frame.hh"
+#include "tcp_segment.hh"
+
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static void BM_TCPSegmentSerialize(benchmark::State &state) {
+    const TCPSegment seg = make_segment(state.range(0));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(seg.serialize().concatenate());
+    }
+    state.SetBytesProcessed(state.iterations() * (TCPHeader::LENGTH + seg.payload().size()));
+}
+BENCHMARK(BM_TCPSegmentSerialize)->Arg(0)->Arg(64)->Arg(1000)->Arg(1460);
+
+static void BM_TCPSegmentParse(benchmark::State &state) {
+    const Buffer wire{make_segment(state.range(0)).serialize().concatenate()};
+
+    for (auto _ : state) {
+        TCPSegment seg;
+        if (seg.parse(wire) != ParseResult::NoError) {
+            state.SkipWithError("TCPSegment::parse failed");
+            break;
+        }
+        benchmark::DoNotOptimize(seg.payload().size());
+    }
+    state.SetBytesProcessed(state.iterations() * wire.size());
+}
+BENCHMARK(BM_TCPSegmentParse)->Arg(0)->Arg(64)->Arg(1000)->Arg(1460);
+
+static void BM_IPv4DatagramSerialize(benchmark::State &state) {
+    const InternetDatagram dgram = make_datagram(0x0a000001, 0x0a000002, state.range(0));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(dgram.serialize().concatenate());
+    }
+    state.SetBytesProcessed(state.iterations() * dgram.header().len);
+}
+BENCHMARK(BM_IPv4DatagramSerialize)->Arg(0)->Arg(64)->Arg(1000)->Arg(1480);
+
+static void BM_IPv4DatagramParse(benchmark::State &state) {
+    const Buffer wire{make_datagram(0x0a000001, 0x0a000002, state.range(0)).serialize().concatenate()};
+
+    for (auto _ : state) {
+        InternetDatagram dgram;
+        if (dgram.parse(wire) != ParseResult::NoError) {
+            state.SkipWithError("IPv4Datagram::parse failed");
+            break;
+        }
+        benchmark::DoNotOptimize(dgram.payload().size());
+    }
+    state.SetBytesProcessed(state.iterations() * wire.size());
+}
+BENCHMARK(BM_IPv4DatagramParse)->Arg(0)->Arg(64)->Arg(1000)->Arg(1480);
+
+//! Parse an Ethernet frame carrying a TCP segment, layer by layer or with the fused TCPFrame::parse
+static void BM_TCPFrameParse(benchmark::State &state) {
+    const bool fused = state.range(0);
+    const TCPSegment seg = make_segment(state.range(1));
+    InternetDatagram dgram = make_datagram(0x0a000001, 0x0a000002, 0);
+    dgram.header().len = dgram.header().hlen * 4 + seg.header().doff * 4 + seg.payload().size();
+    dgram.payload() = seg.serialize(dgram.header().pseudo_cksum());
+    const Buffer wire{
+        make_frame({0x02, 0, 0, 0, 0, 1}, {0x02, 0, 0, 0, 0, 2}, EthernetHeader::TYPE_IPv4, dgram.serialize())
+            .serialize()
+            .concatenate()};
+
+    for (auto _ : state) {
+        if (fused) {
+            TCPFrame frame;
+            if (frame.parse(wire) != ParseResult::NoError) {
+                state.SkipWithError("TCPFrame::parse failed");
+                break;
+            }
+            benchmark::DoNotOptimize(frame.segment().payload().size());
+        } else {
+            EthernetFrame frame;
+            InternetDatagram parsed_dgram;
+            TCPSegment parsed_seg;
+            if (frame.parse(wire) != ParseResult::NoError or
+                parsed_dgram.parse(frame.payload()) != ParseResult::NoError or
+                parsed_seg.parse(parsed_dgram.payload(), parsed_dgram.header().pseudo_cksum()) !=
+                    ParseResult::NoError) {
+                state.SkipWithError("layered parse failed");
+                break;
+            }
+            benchmark::DoNotOptimize(parsed_seg.payload().size());
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * wire.size());
+}
+BENCHMARK(BM_TCPFrameParse)->ArgNames({"fused", "payload"})->ArgsProduct({{0, 1}, {0, 1460}});
+
+//! TCPFrame::parse when the device has already checked the checksums
+static void BM_TCPFrameParseTrusted(benchmark::State &state) {
+    const TCPSegment seg = make_segment(state.range(0));
+    InternetDatagram dgram = make_datagram(0x0a000001, 0x0a000002, 0);
+    dgram.header().len = dgram.header().hlen * 4 + seg.header().doff * 4 + seg.payload().size();
+    dgram.payload() = seg.serialize(dgram.header().pseudo_cksum());
+    const Buffer wire{dgram.serialize().concatenate()};
+
+    for (auto _ : state) {
+        TCPFrame frame;
+        if (frame.parse_ipv4(wire, TCPFrame::Checksums::Trusted) != ParseResult::NoError) {
+            state.SkipWithError("TCPFrame::parse_ipv4 failed");
+            break;
+        }
+        benchmark::DoNotOptimize(frame.segment().payload().size());
+    }
+    state.SetBytesProcessed(state.iterations() * wire.size());
+}
+BENCHMARK(BM_TCPFrameParseTrusted)->Arg(0)->Arg(1460);
+
+//! Write an Ethernet + IPv4 + TCP header stack, as strings or into one preallocated area
+static void BM_HeaderStackSerialize(benchmark::State &state) {
+    const bool into = state.range(0);
+    const TCPSegment seg = make_segment(0);
+    const InternetDatagram dgram = make_datagram(0x0a000001, 0x0a000002, 0);
+    const EthernetHeader eth{{0x02, 0, 0, 0, 0, 1}, {0x02, 0, 0, 0, 0, 2}, EthernetHeader::TYPE_IPv4};
+
+    uint8_t headroom[EthernetHeader::LENGTH + IPv4Header::LENGTH + TCPHeader::LENGTH];
+    for (auto _ : state) {
+        if (into) {
+            eth.serialize_into(headroom);
+            dgram.header().serialize_into(headroom + EthernetHeader::LENGTH);
+            seg.header().serialize_into(headroom + EthernetHeader::LENGTH + IPv4Header::LENGTH);
+            benchmark::DoNotOptimize(headroom);
+        } else {
+            benchmark::DoNotOptimize(eth.serialize());
+            benchmark::DoNotOptimize(dgram.header().serialize());
+            benchmark::DoNotOptimize(seg.header().serialize());
+        }
+    }
+}
+BENCHMARK(BM_HeaderStackSerialize)->ArgName("into")->Arg(0)->Arg(1);
+
+//! Encapsulate a TCP segment in IPv4 and Ethernet, layer by layer as BufferLists or in place in a PacketBuffer.
+//! The last 64 frames stay alive, as if queued for the device, so pooled blocks are recycled as in steady state.
+static void BM_SegmentEncapsulate(benchmark::State &state) {
+    const bool pooled = state.range(0);
+    const TCPSegment seg = make_segment(state.range(1));
+    InternetDatagram dgram = make_datagram(0x0a000001, 0x0a000002, 0);
+    dgram.header().len = dgram.header().hlen * 4 + seg.header().doff * 4 + seg.payload().size();
+    const IPv4Header &ip = dgram.header();
+    const EthernetHeader eth{{0x02, 0, 0, 0, 0, 1}, {0x02, 0, 0, 0, 0, 2}, EthernetHeader::TYPE_IPv4};
+
+    vector<BufferList> in_flight(64);
+    vector<Buffer> in_flight_pooled(in_flight.size());
+    size_t next = 0;
+    uint64_t allocations = 0;
+    for (auto _ : state) {
+        const uint64_t before = allocation_count();
+        if (pooled) {
+            PacketBuffer pkt = seg.serialize_packet(ip.pseudo_cksum());
+            ip.prepend_to(pkt);
+            eth.prepend_to(pkt);
+            in_flight_pooled[next++ % in_flight.size()] = move(pkt);
+        } else {
+            InternetDatagram ip_dgram;
+            ip_dgram.header() = ip;
+            ip_dgram.payload() = seg.serialize(ip.pseudo_cksum());
+            EthernetFrame frame;
+            frame.header() = eth;
+            frame.payload() = ip_dgram.serialize();
+            in_flight[next++ % in_flight.size()] = frame.serialize();
+        }
+        allocations += allocation_count() - before;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["allocs_per_segment"] = double(allocations) / state.iterations();
+}
+BENCHMARK(BM_SegmentEncapsulate)->ArgNames({"pooled", "payload"})->ArgsProduct({{0, 1}, {0, 1000}});
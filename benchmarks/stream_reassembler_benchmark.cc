@@ -0,0 +1,83 @@
+#include "benchmark_util.hh"
+#include "stream_reassembler.hh"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+static constexpr size_t STREAM_LEN = 64 * 1024;
+
+//! Order in which the segments of the stream are delivered
+enum Pattern : int64_t { InOrder, Reversed, Random, Duplicated };
+
+//! Split the stream into `seg_len`-byte segments and order them according to `pattern`
+static vector<pair<size_t, string>> make_segments(const string &data, const size_t seg_len, const Pattern pattern) {
+    vector<pair<size_t, string>> segs;
+    for (size_t idx = 0; idx < data.size(); idx += seg_len) {
+        segs.emplace_back(idx, data.substr(idx, seg_len));
+    }
+
+    switch (pattern) {
+        case InOrder:
+            break;
+        case Reversed:
+            reverse(segs.begin(), segs.end());
+            break;
+        case Random:
+            shuffle(segs.begin(), segs.end(), mt19937{0});
+            break;
+        case Duplicated: {
+            // every segment arrives twice, the second copy overlapping half of the next segment
+            vector<pair<size_t, string>> dup;
+            for (const auto &[idx, seg] : segs) {
+                dup.emplace_back(idx, seg);
+                dup.emplace_back(idx + seg_len / 2, data.substr(idx + seg_len / 2, seg_len));
+            }
+            segs = move(dup);
+            break;
+        }
+    }
+    return segs;
+}
+
+static void BM_StreamReassembler(benchmark::State &state) {
+    const size_t seg_len = state.range(0);
+    const auto segs = make_segments(random_bytes(STREAM_LEN), seg_len, static_cast<Pattern>(state.range(1)));
+
+    for (auto _ : state) {
+        StreamReassembler reassembler{STREAM_LEN};
+        for (const auto &[idx, seg] : segs) {
+            reassembler.push_substring(seg, idx, false);
+        }
+        benchmark::DoNotOptimize(reassembler.stream_out().buffer_size());
+    }
+    state.SetBytesProcessed(state.iterations() * STREAM_LEN);
+}
+BENCHMARK(BM_StreamReassembler)
+    ->ArgNames({"seg_len", "pattern"})
+    ->ArgsProduct({{64, 1000}, {InOrder, Reversed, Random, Duplicated}});
+
+//! Same, with the segments delivered as Buffers (the zero-copy path a TCPReceiver would use)
+static void BM_StreamReassemblerBuffer(benchmark::State &state) {
+    const size_t seg_len = state.range(0);
+    vector<pair<size_t, Buffer>> segs;
+    for (auto &[idx, seg] : make_segments(random_bytes(STREAM_LEN), seg_len, static_cast<Pattern>(state.range(1)))) {
+        segs.emplace_back(idx, Buffer{move(seg)});
+    }
+
+    for (auto _ : state) {
+        StreamReassembler reassembler{STREAM_LEN};
+        for (const auto &[idx, seg] : segs) {
+            reassembler.push_substring(seg, idx, false);
+        }
+        benchmark::DoNotOptimize(reassembler.stream_out().buffer_size());
+    }
+    state.SetBytesProcessed(state.iterations() * STREAM_LEN);
+}
+BENCHMARK(BM_StreamReassemblerBuffer)
+    ->ArgNames({"seg_len", "pattern"})
+    ->ArgsProduct({{64, 1000}, {InOrder, Reversed, Random, Duplicated}});
@@ -0,0 +1,102 @@
+#include "address.hh"
+#include "benchmark_util.hh"
+#include "buffer.hh"
+#include "socket.hh"
+#include "util.hh"
+
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static constexpr size_t DATAGRAMS = 64;
+static constexpr size_t PAYLOAD_LEN = 1000;
+
+//! A batch of datagrams to a loopback socket (which drops what it has no room for), sent one sendmsg(2)
+//! each (mode 0), with one sendmmsg(2) (mode 1), or with one sendmmsg(2) of UDP GSO datagrams (mode 2)
+static void BM_UDPSendBatch(benchmark::State &state) {
+    const auto mode = state.range(0);
+
+    UDPSocket sender, receiver;
+    sender.bind(Address("127.0.0.1", 0));
+    receiver.bind(Address("127.0.0.1", 0));
+    const Address destination = receiver.local_address();
+    const vector<BufferList> payloads(DATAGRAMS, BufferList{string(PAYLOAD_LEN, 'x')});
+
+    try {
+        for (auto _ : state) {
+            if (mode == 0) {
+                for (const auto &payload : payloads) {
+                    sender.sendto(destination, payload);
+                }
+            } else {
+                sender.send_batch(destination, payloads, mode == 2);
+            }
+        }
+    } catch (const unix_error &e) {
+        state.SkipWithError(e.what());  // e.g. no UDP GSO
+        return;
+    }
+    state.SetItemsProcessed(state.iterations() * DATAGRAMS);
+    state.SetBytesProcessed(state.iterations() * DATAGRAMS * PAYLOAD_LEN);
+}
+BENCHMARK(BM_UDPSendBatch)->ArgName("mode")->DenseRange(0, 2)->Unit(benchmark::kMicrosecond);
+
+//! One datagram received, with the payload in a string sized for any datagram (pooled 0), or in a
+//! block from the PacketBuffer pool (pooled 1)
+static void BM_UDPRecv(benchmark::State &state) {
+    const bool pooled = state.range(0);
+
+    UDPSocket sender, receiver;
+    sender.bind(Address("127.0.0.1", 0));
+    receiver.bind(Address("127.0.0.1", 0));
+    const Address destination = receiver.local_address();
+    const string payload(PAYLOAD_LEN, 'x');
+
+    uint64_t allocations = 0;
+    for (auto _ : state) {
+        sender.sendto(destination, payload);
+        const uint64_t before = allocation_count();
+        if (pooled) {
+            UDPSocket::received_buffer dgram{{nullptr, 0}, {}};
+            receiver.recv(dgram);
+            benchmark::DoNotOptimize(dgram.payload.str().data());
+        } else {
+            // what TCPOverUDPSocketAdapter did: receive into a string, then hand it to a Buffer
+            auto dgram = receiver.recv();
+            const Buffer buf{move(dgram.payload)};
+            benchmark::DoNotOptimize(buf.str().data());
+        }
+        allocations += allocation_count() - before;
+    }
+    state.counters["allocs_per_dgram"] = double(allocations) / state.iterations();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_UDPRecv)->ArgName("pooled")->DenseRange(0, 1)->Unit(benchmark::kMicrosecond);
+
+//! recv_batch() into strings, with `waiting` small datagrams queued for each call, reusing the vector
+static void BM_UDPRecvBatch(benchmark::State &state) {
+    const size_t waiting = state.range(0);
+
+    UDPSocket sender, receiver;
+    sender.bind(Address("127.0.0.1", 0));
+    receiver.bind(Address("127.0.0.1", 0));
+    const Address destination = receiver.local_address();
+    const vector<BufferList> payloads(waiting, BufferList{string(40, 'x')});
+
+    vector<UDPSocket::received_datagram> batch;
+    uint64_t allocations = 0, calls = 0;
+    for (auto _ : state) {
+        sender.send_batch(destination, payloads);
+        for (size_t received = 0; received < waiting; received += batch.size(), calls++) {
+            const uint64_t before = allocation_count();
+            receiver.recv_batch(batch, UDPSocket::MAX_BATCH);
+            allocations += allocation_count() - before;
+        }
+    }
+    state.counters["allocs_per_call"] = double(allocations) / calls;
+    state.SetItemsProcessed(state.iterations() * waiting);
+}
+BENCHMARK(BM_UDPRecvBatch)->ArgName("waiting")->Arg(1)->Arg(64)->Unit(benchmark::kMicrosecond);
@@ -30,16 +30,33 @@ add_test(NAME t_strm_reassem_many        COMMAND fsm_stream_reassembler_many)
 add_test(NAME t_strm_reassem_overlapping COMMAND fsm_stream_reassembler_overlapping)
 add_test(NAME t_strm_reassem_win         COMMAND fsm_stream_reassembler_win)
 add_test(NAME t_strm_reassem_cap         COMMAND fsm_stream_reassembler_cap)
+add_test(NAME t_strm_reassem_memory      COMMAND fsm_stream_reassembler_memory)
 
 add_test(NAME t_byte_stream_construction COMMAND byte_stream_construction)
 add_test(NAME t_byte_stream_one_write    COMMAND byte_stream_one_write)
 add_test(NAME t_byte_stream_two_writes   COMMAND byte_stream_two_writes)
 add_test(NAME t_byte_stream_capacity     COMMAND byte_stream_capacity)
 add_test(NAME t_byte_stream_many_writes  COMMAND byte_stream_many_writes)
+add_test(NAME t_byte_stream_peek_views   COMMAND byte_stream_peek_views)
+add_test(NAME t_byte_stream_chunked      COMMAND byte_stream_chunked)
+
+add_test(NAME t_checksum_fuzz          COMMAND internet_checksum_fuzz)
+add_test(NAME t_ipv4_cksum_update      COMMAND ipv4_cksum_update)
+add_test(NAME t_serialize_into         COMMAND serialize_into)
+add_test(NAME t_ipv4_map               COMMAND ipv4_map)
+add_test(NAME t_packet_buffer          COMMAND packet_buffer)
+add_test(NAME t_tcp_frame              COMMAND tcp_frame)
+add_test(NAME t_eventloop_backends     COMMAND eventloop_backends)
+add_test(NAME t_eventloop_timers       COMMAND eventloop_timers)
+add_test(NAME t_io_uring               COMMAND io_uring)
+add_test(NAME t_udp_batch              COMMAND udp_batch)
+add_test(NAME t_lpm_table              COMMAND lpm_table)
+add_test(NAME t_router_workers         COMMAND router_workers)
 
 add_test(NAME t_webget               COMMAND "${PROJECT_SOURCE_DIR}/tests/webget_t.sh")
 
 add_test(NAME arp_network_interface    COMMAND net_interface)
+add_test(NAME arp_pending_datagrams    COMMAND net_interface_pending)
 
 add_test(NAME router_test    COMMAND network_simulator)
 
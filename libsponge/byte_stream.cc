@@ -1,5 +1,9 @@
 #include "byte_stream.hh"
 
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
 // Dummy implementation of a flow-controlled in-memory byte stream.
 
 // For Lab 0, please replace with a real implementation that passes the
@@ -12,18 +16,80 @@ void DUMMY_CODE(Targs &&.../* unused */) {}
 
 using namespace std;
 
-ByteStream::ByteStream(const size_t capacity)
-    : _capacity(capacity), _bytes_read(0), _bytes_write(0), _buffer(), _end(false), _error(false) {}
-
-size_t ByteStream::write(const string &data) {
-    const size_t remains = _capacity - (_bytes_write - _bytes_read);
+//! \param[in] capacity the maximum number of unread bytes the stream holds
+//! \param[in] chunked whether to keep refcounted chunks (`true`) or a ring buffer (`false`)
+ByteStream::ByteStream(const size_t capacity, const bool chunked)
+    : _capacity(capacity)
+    , _bytes_read(0)
+    , _bytes_write(0)
+    , _buffer(chunked ? 0 : capacity)
+    , _head(0)
+    , _chunked(chunked)
+    , _chunks()
+    , _copy_count(0)
+    , _end(false)
+    , _error(false) {}
+
+size_t ByteStream::write(const string &data) { return _copy_in(data); }
+
+//! \param[in] data bytes to be copied into the stream's storage
+//! \returns the number of bytes accepted into the stream
+size_t ByteStream::_copy_in(const string_view data) {
+    const size_t remains = _capacity - buffer_size();
     // `bytes` is the bytes can be written into the stream
     const size_t bytes = remains >= data.size() ? data.size() : remains;
+    if (bytes == 0) {
+        return 0;
+    }
+
+    if (_chunked) {
+        // the caller keeps `data`, so the chunk needs its own copy
+        _chunks.append(Buffer(string(data.substr(0, bytes))));
+    } else {
+        // the free region starts at the tail and may wrap around the end of `_buffer`
+        const size_t tail = (_head + buffer_size()) % _capacity;
+        const size_t first = min(bytes, _capacity - tail);
+        memcpy(_buffer.data() + tail, data.data(), first);
+        memcpy(_buffer.data(), data.data() + first, bytes - first);
+    }
+    _copy_count++;
+
+    _bytes_write += bytes;
+
+    return bytes;
+}
+
+size_t ByteStream::write(string &&data) {
+    if (not _chunked) {
+        return _copy_in(data);
+    }
 
-    for (const char &ch : data.substr(0, bytes)) {
-        _buffer.push_back(ch);
+    const size_t remains = _capacity - buffer_size();
+    const size_t bytes = remains >= data.size() ? data.size() : remains;
+    if (bytes == 0) {
+        return 0;
+    }
+
+    data.resize(bytes);
+    _chunks.append(Buffer(move(data)));
+    _bytes_write += bytes;
+
+    return bytes;
+}
+
+size_t ByteStream::write(Buffer data) {
+    if (not _chunked) {
+        return _copy_in(data);
+    }
+
+    const size_t remains = _capacity - buffer_size();
+    const size_t bytes = remains >= data.size() ? data.size() : remains;
+    if (bytes == 0) {
+        return 0;
     }
 
+    data.remove_suffix(data.size() - bytes);
+    _chunks.append(data);
     _bytes_write += bytes;
 
     return bytes;
@@ -31,18 +97,74 @@ size_t ByteStream::write(const string &data) {
 
 //! \param[in] len bytes will be copied from the output side of the buffer
 string ByteStream::peek_output(const size_t len) const {
-    const size_t peek_size = std::min(len, _buffer.size());
-    string peek = string(_buffer.begin(), _buffer.begin() + peek_size);
+    const size_t peek_size = min(len, buffer_size());
+
+    string peek;
+    peek.reserve(peek_size);
+    if (_chunked) {
+        for (const auto &buf : _chunks.buffers()) {
+            if (peek.size() == peek_size) {
+                break;
+            }
+            peek.append(buf.str().substr(0, peek_size - peek.size()));
+        }
+    } else {
+        const auto [first, second] = peek_views(peek_size);
+        peek.append(first);
+        peek.append(second);
+    }
+    if (peek_size > 0) {
+        _copy_count++;
+    }
+
     return peek;
 }
 
+//! \param[in] len bytes will be viewed from the output side of the buffer
+pair<string_view, string_view> ByteStream::peek_views(const size_t len) const {
+    if (_chunked) {
+        throw runtime_error("ByteStream::peek_views: use peek_buffers() on a chunked stream");
+    }
+
+    const size_t peek_size = min(len, buffer_size());
+    const size_t first = min(peek_size, _capacity - _head);
+    return {{_buffer.data() + _head, first}, {_buffer.data(), peek_size - first}};
+}
+
+//! \param[in] len bytes will be viewed from the output side of the buffer
+BufferViewList ByteStream::peek_buffers(const size_t len) const {
+    BufferViewList views;
+    if (_chunked) {
+        size_t remains = min(len, buffer_size());
+        for (const auto &buf : _chunks.buffers()) {
+            if (remains == 0) {
+                break;
+            }
+            const string_view view = buf.str().substr(0, remains);
+            views.append(view);
+            remains -= view.size();
+        }
+    } else {
+        const auto [first, second] = peek_views(len);
+        views.append(first);
+        views.append(second);
+    }
+
+    return views;
+}
+
 //! \param[in] len bytes will be removed from the output side of the buffer
 void ByteStream::pop_output(const size_t len) {
-    const size_t pop_size = std::min(len, _buffer.size());
-    _bytes_read += pop_size;
+    const size_t pop_size = min(len, buffer_size());
+    if (pop_size == 0) {
+        return;
+    }
 
-    for (size_t i = 0; i < pop_size; i++) {
-        _buffer.pop_front();
+    _bytes_read += pop_size;
+    if (_chunked) {
+        _chunks.remove_prefix(pop_size);
+    } else {
+        _head = (_head + pop_size) % _capacity;
     }
 }
 
@@ -56,13 +178,38 @@ std::string ByteStream::read(const size_t len) {
     return data;
 }
 
+//! \param[in] len bytes will be popped and returned
+//! \returns the popped bytes; in chunked mode, slices of the written chunks
+BufferList ByteStream::read_buffers(const size_t len) {
+    if (not _chunked) {
+        return BufferList(read(len));
+    }
+
+    BufferList ret;
+    size_t remains = min(len, buffer_size());
+    for (const auto &buf : _chunks.buffers()) {
+        if (remains == 0) {
+            break;
+        }
+        Buffer slice = buf;
+        if (slice.size() > remains) {
+            slice.remove_suffix(slice.size() - remains);
+        }
+        remains -= slice.size();
+        ret.append(slice);
+    }
+    pop_output(len);
+
+    return ret;
+}
+
 void ByteStream::end_input() { _end = true; }
 
 bool ByteStream::input_ended() const { return _end; }
 
-size_t ByteStream::buffer_size() const { return _buffer.size(); }
+size_t ByteStream::buffer_size() const { return _bytes_write - _bytes_read; }
 
-bool ByteStream::buffer_empty() const { return _buffer.empty(); }
+bool ByteStream::buffer_empty() const { return buffer_size() == 0; }
 
 bool ByteStream::eof() const { return _end && buffer_empty(); }
 
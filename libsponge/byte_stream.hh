@@ -1,8 +1,12 @@
 #ifndef SPONGE_LIBSPONGE_BYTE_STREAM_HH
 #define SPONGE_LIBSPONGE_BYTE_STREAM_HH
 
-#include <deque>
+#include "buffer.hh"
+
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 //! \brief An in-order byte stream.
 
@@ -22,16 +26,28 @@ class ByteStream {
     size_t _bytes_read;   // the bytes that are read
     size_t _bytes_write;  // the bytes that are written
 
-    // CANNOT use queue here!
-    std::deque<char> _buffer;  // the byte stream
+    // fixed-size ring buffer holding the unread bytes, allocated once in the constructor
+    std::vector<char> _buffer;  // the byte stream
+    size_t _head;               // index in `_buffer` of the next byte to be read
+
+    // in chunked mode, the unread bytes are kept as refcounted chunks instead of in `_buffer`
+    bool _chunked;
+    BufferList _chunks;
+
+    mutable size_t _copy_count;  // the number of times bytes were copied into or out of the stream's storage
 
     bool _end;  // flag indicating whether reached the end
 
     bool _error{};  //!< Flag indicating that the stream suffered an error.
 
+    // copy `data` into the ring buffer (or a new chunk); shared by all the write() overloads
+    size_t _copy_in(const std::string_view data);
+
   public:
     //! Construct a stream with room for `capacity` bytes.
-    ByteStream(const size_t capacity);
+    //! \param[in] chunked if `true`, keep written strings/Buffers as refcounted chunks instead of
+    //!                    copying them into a ring buffer
+    ByteStream(const size_t capacity, const bool chunked = false);
 
     //! \name "Input" interface for the writer
     //!@{
@@ -41,6 +57,24 @@ class ByteStream {
     //! \returns the number of bytes accepted into the stream
     size_t write(const std::string &data);
 
+    //! Write a string of bytes into the stream, taking ownership of it
+    //! (in chunked mode, without copying). Write as many as will fit.
+    //! \returns the number of bytes accepted into the stream
+    size_t write(std::string &&data);
+
+    //! Write a Buffer into the stream (in chunked mode, by sharing its storage).
+    //! Write as many as will fit.
+    //! \returns the number of bytes accepted into the stream
+    size_t write(Buffer data);
+
+    //! Write a view of bytes into the stream (always copied, since the view does not own them).
+    //! Write as many as will fit.
+    //! \returns the number of bytes accepted into the stream
+    size_t write(const std::string_view data) { return _copy_in(data); }
+
+    //! Write a C string into the stream (disambiguates between the overloads above)
+    size_t write(const char *data) { return _copy_in(data); }
+
     //! \returns the number of additional bytes that the stream has space for
     size_t remaining_capacity() const;
 
@@ -58,6 +92,16 @@ class ByteStream {
     //! \returns a string
     std::string peek_output(const size_t len) const;
 
+    //! Peek at next "len" bytes of the stream without copying them
+    //! \returns up to two views into the stream's storage (the second is empty unless the bytes wrap around);
+    //! the views are invalidated by the next write() or pop_output()
+    //! \note Throws an exception in chunked mode, where the bytes may span more than two chunks
+    std::pair<std::string_view, std::string_view> peek_views(const size_t len) const;
+
+    //! Peek at next "len" bytes of the stream without copying them
+    //! \returns the same views as peek_views(), e.g. for FileDescriptor::write
+    BufferViewList peek_buffers(const size_t len) const;
+
     //! Remove bytes from the buffer
     void pop_output(const size_t len);
 
@@ -65,6 +109,10 @@ class ByteStream {
     //! \returns a string
     std::string read(const size_t len);
 
+    //! Read (i.e., slice and then pop) the next "len" bytes of the stream
+    //! \returns a BufferList sharing the stream's chunks (in chunked mode, without copying)
+    BufferList read_buffers(const size_t len);
+
     //! \returns `true` if the stream input has ended
     bool input_ended() const;
 
@@ -89,6 +137,12 @@ class ByteStream {
 
     //! Total number of bytes popped
     size_t bytes_read() const;
+
+    //! Number of times bytes were copied into or out of the stream's storage
+    size_t copy_count() const { return _copy_count; }
+
+    //! \returns `true` if the stream keeps its bytes as refcounted chunks
+    bool chunked() const { return _chunked; }
     //!@}
 };
 
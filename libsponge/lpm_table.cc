@@ -0,0 +1,70 @@
+#include "lpm_table.hh"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+void LPMTable::insert(const uint32_t prefix, const uint8_t prefix_length, const uint32_t value) {
+    if (value > MAX_VALUE) {
+        throw runtime_error("LPMTable: value is too large");
+    }
+    _prefixes.push_back({prefix, prefix_length, value});
+    _built = false;
+}
+
+//! \details Prefixes are inserted shortest first (and in insertion order among equal lengths), so
+//! each one overwrites the entries of every shorter or earlier prefix it covers. A node is only
+//! created for a prefix longer than its parent's level, and all such prefixes come after the ones
+//! that end at the parent's level, so leaves are never written after a node was pushed below them.
+void LPMTable::build() {
+    vector<Prefix> sorted;
+    for (const auto &p : _prefixes) {
+        const uint32_t netmask = p.prefix_length == 0 ? 0 : 0xFFFFFFFF << (32 - p.prefix_length);
+        if (p.prefix_length <= 32 and (p.prefix & netmask) == p.prefix) {
+            sorted.push_back(p);
+        }
+    }
+    stable_sort(sorted.begin(), sorted.end(), [](const Prefix &a, const Prefix &b) {
+        return a.prefix_length < b.prefix_length;
+    });
+
+    _top.assign(size_t(1) << 16, 0);
+    _nodes.clear();
+
+    for (const auto &p : sorted) {
+        if (p.prefix_length <= 16) {
+            _fill(&_top[p.prefix >> 16], size_t(1) << (16 - p.prefix_length), p.value);
+            continue;
+        }
+
+        const size_t level1 = _child_of(_top[p.prefix >> 16]);
+        if (p.prefix_length <= 24) {
+            _fill(&_nodes[level1 * NODE_SIZE + ((p.prefix >> 8) & 0xff)], size_t(1) << (24 - p.prefix_length), p.value);
+            continue;
+        }
+
+        const size_t level2 = _child_of(_nodes[level1 * NODE_SIZE + ((p.prefix >> 8) & 0xff)]);
+        _fill(&_nodes[level2 * NODE_SIZE + (p.prefix & 0xff)], size_t(1) << (32 - p.prefix_length), p.value);
+    }
+
+    _built = true;
+}
+
+size_t LPMTable::_child_of(Entry &entry) {
+    if (entry & CHILD) {
+        return entry & ~CHILD;
+    }
+
+    // `entry` may point into _nodes, so read it before growing the vector
+    const Entry leaf = entry;
+    const size_t node = _nodes.size() / NODE_SIZE;
+    if (node >= CHILD) {
+        throw runtime_error("LPMTable: too many nodes");
+    }
+    entry = CHILD | node;
+    _nodes.resize(_nodes.size() + NODE_SIZE, leaf);
+    return node;
+}
+
+void LPMTable::_fill(Entry *first, const size_t count, const uint32_t value) { fill(first, first + count, value + 1); }
@@ -0,0 +1,91 @@
+#ifndef SPONGE_LIBSPONGE_LPM_TABLE_HH
+#define SPONGE_LIBSPONGE_LPM_TABLE_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+//! \brief A longest-prefix-match table for IPv4 addresses.
+
+//! Prefixes are added with insert() and compiled by build() into a multibit trie with strides of
+//! 16, 8 and 8 bits: a lookup reads at most three array entries. Each prefix is expanded to cover
+//! every entry of the level it ends in (controlled prefix expansion), and when a longer prefix
+//! needs a deeper node, the entry's route is copied into all of the new node's entries (leaf
+//! pushing), so a lookup never has to remember what it saw on the way down.
+//!
+//! Matching follows Router's original semantics: a prefix matches `addr` if the top
+//! `prefix_length` bits of `addr` equal `prefix` (so a prefix with bits set past its length never
+//! matches), longer prefixes win, and among equal prefixes the one inserted last wins.
+class LPMTable {
+  private:
+    //! An entry of the trie: 0 for no route, the route's value + 1, or CHILD | the index of a node
+    using Entry = uint32_t;
+    static constexpr Entry CHILD = 0x80000000;
+    static constexpr size_t NODE_SIZE = 256;
+
+    struct Prefix {
+        uint32_t prefix;
+        uint8_t prefix_length;
+        uint32_t value;
+    };
+    std::vector<Prefix> _prefixes{};  //!< in insertion order
+
+    std::vector<Entry> _top{};    //!< 2^16 entries indexed by the top 16 bits of the address
+    std::vector<Entry> _nodes{};  //!< nodes of 256 entries, indexed by the next 8 bits
+    bool _built{true};
+
+    //! The node that `entry` points to, creating it (filled with `entry`'s route) if it is a leaf
+    size_t _child_of(Entry &entry);
+
+    //! Set `count` entries starting at `first` to the leaf for `value`
+    static void _fill(Entry *first, const size_t count, const uint32_t value);
+
+  public:
+    //! Largest value that can be stored
+    static constexpr uint32_t MAX_VALUE = CHILD - 2;
+
+    //! \brief Add a prefix; takes effect at the next build()
+    //! \note Prefixes longer than 32 bits, or with bits set past their length, can never match
+    void insert(const uint32_t prefix, const uint8_t prefix_length, const uint32_t value);
+
+    //! \brief Compile the prefixes into the trie
+    void build();
+
+    //! Have all inserted prefixes been compiled?
+    bool built() const { return _built; }
+
+    //! \brief The value of the longest prefix matching `addr`, or empty if none does
+    //! \note Only reflects prefixes inserted before the last build()
+    std::optional<uint32_t> lookup(const uint32_t addr) const {
+        if (_top.empty()) {
+            return std::nullopt;
+        }
+        Entry entry = _top[addr >> 16];
+        if (entry & CHILD) {
+            entry = _nodes[(entry & ~CHILD) * NODE_SIZE + ((addr >> 8) & 0xff)];
+            if (entry & CHILD) {
+                entry = _nodes[(entry & ~CHILD) * NODE_SIZE + (addr & 0xff)];
+            }
+        }
+        if (entry == 0) {
+            return std::nullopt;
+        }
+        return entry - 1;
+    }
+
+    //! \brief Start loading the first-level entry for `addr`, for a lookup() a little later
+    void prefetch(const uint32_t addr) const {
+        if (not _top.empty()) {
+            __builtin_prefetch(&_top[addr >> 16]);
+        }
+    }
+
+    //! Number of prefixes inserted
+    size_t size() const { return _prefixes.size(); }
+
+    //! Bytes used by the compiled trie
+    size_t memory_usage() const { return (_top.size() + _nodes.size()) * sizeof(Entry); }
+};
+
+#endif  // SPONGE_LIBSPONGE_LPM_TABLE_HH
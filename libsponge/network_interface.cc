@@ -20,12 +20,11 @@ using namespace std;
 
 //! \param[in] ethernet_address Ethernet (what ARP calls "hardware") address of the interface
 //! \param[in] ip_address IP (what ARP calls "protocol") address of the interface
-NetworkInterface::NetworkInterface(const EthernetAddress &ethernet_address, const Address &ip_address)
-    : _ethernet_address(ethernet_address)
-    , _ip_address(ip_address)
-    , _arp_tbl()
-    , _waiting_queue()
-    , _waiting_arp_response() {
+//! \param[in] pending_limits bounds on the datagrams held while waiting for ARP replies
+NetworkInterface::NetworkInterface(const EthernetAddress &ethernet_address,
+                                   const Address &ip_address,
+                                   const PendingDatagramLimits &pending_limits)
+    : _ethernet_address(ethernet_address), _ip_address(ip_address), _pending_limits(pending_limits) {
     cerr << "DEBUG: Network interface has Ethernet address " << to_string(_ethernet_address) << " and IP address "
          << ip_address.ip() << "\n";
 }
@@ -34,49 +33,122 @@ NetworkInterface::NetworkInterface(const EthernetAddress &ethernet_address, cons
 //! \param[in] next_hop the IP address of the interface to send it to (typically a router or default gateway, but may also be another host if directly connected to the same network as the destination)
 //! (Note: the Address type can be converted to a uint32_t (raw 32-bit IP address) with the Address::ipv4_numeric() method.)
 void NetworkInterface::send_datagram(const InternetDatagram &dgram, const Address &next_hop) {
+    send_datagram(InternetDatagram(dgram), next_hop);
+}
+
+//! \param[in] dgram the IPv4 datagram to be sent, which is left empty
+//! \param[in] next_hop the IP address of the interface to send it to
+void NetworkInterface::send_datagram(InternetDatagram &&dgram, const Address &next_hop) {
     // convert IP address of next hop to raw 32-bit representation (used in ARP header)
     const uint32_t next_hop_ip = next_hop.ipv4_numeric();
 
     // next_hop_ip is in ARP table
-    auto arp_item = this->_arp_tbl.find(next_hop_ip);
-    if (arp_item != this->_arp_tbl.end()) {
-        EthernetFrame eth_frame;
+    const ARPItem *arp_item = this->_arp_tbl.find(next_hop_ip);
+    if (arp_item != nullptr) {
+        _send_ipv4_frame(move(dgram), arp_item->_eth_addr);
+    } else {
+        // do not send a second request if already sent in last 5 seconds
+        PendingNextHop *pending = this->_waiting_arp_response.find(next_hop_ip);
+        if (pending == nullptr) {
+            if (_waiting_arp_response.size() >= _pending_limits.next_hops) {
+                _pending_stats.dropped++;
+                return;
+            }
+            pending = &_send_arp_request(next_hop_ip);
+        }
 
-        eth_frame.header() = {arp_item->second._eth_addr, this->_ethernet_address, EthernetHeader::TYPE_IPv4};
+        // add the datagram to the ones waiting for this next hop
+        _hold_datagram(*pending, move(dgram));
+    }
+}
 
-        eth_frame.payload() = dgram.serialize();
+void NetworkInterface::_hold_datagram(PendingNextHop &pending, InternetDatagram &&dgram) {
+    const size_t bytes = dgram.header().hlen * 4 + dgram.payload().size();
+    if (pending._datagrams.size() >= _pending_limits.per_next_hop or
+        _pending_stats.bytes + bytes > _pending_limits.total_bytes) {
+        _pending_stats.dropped++;
+        return;
+    }
 
-        _frames_out.push(eth_frame);
-    } else {
-        // do not send a second request if already sent in last 5 seconds
-        if (this->_waiting_arp_response.find(next_hop_ip) == this->_waiting_arp_response.end()) {
-            // send an ARP request
-            ARPMessage arp_req;
+    pending._datagrams.push_back(move(dgram));
+    pending._bytes += bytes;
+    _pending_stats.datagrams++;
+    _pending_stats.bytes += bytes;
+}
+
+//! \param[in] ip the raw 32-bit IP address to resolve
+NetworkInterface::PendingNextHop &NetworkInterface::_send_arp_request(const uint32_t ip) {
+    ARPMessage arp_req;
+
+    arp_req.opcode = ARPMessage::OPCODE_REQUEST;
+
+    arp_req.sender_ethernet_address = this->_ethernet_address;
+    arp_req.sender_ip_address = this->_ip_address.ipv4_numeric();
 
-            arp_req.opcode = ARPMessage::OPCODE_REQUEST;
+    arp_req.target_ethernet_address = {};  // want to get
+    arp_req.target_ip_address = ip;
 
-            arp_req.sender_ethernet_address = this->_ethernet_address;
-            arp_req.sender_ip_address = this->_ip_address.ipv4_numeric();
+    // broadcast an ARP request
+    EthernetFrame &eth_frame = _frames_out.emplace();
+    eth_frame.header() = {ETHERNET_BROADCAST, this->_ethernet_address, EthernetHeader::TYPE_ARP};
+    eth_frame.payload() = arp_req.serialize();
+
+    // remember that a request for the IP has been sent in the last 5 seconds
+    PendingNextHop &pending = *this->_waiting_arp_response.insert(ip, PendingNextHop{}).first;
+    pending._resend_at = _now_ms + NetworkInterface::_ttl_wait_for_response;
+    pending._requests++;
+    _response_expiry.push({pending._resend_at, ip});
+    _pending_stats.next_hops = _waiting_arp_response.size();
+    return pending;
+}
+
+//! \param[in] ip the raw 32-bit IP address that did not answer
+void NetworkInterface::_give_up_next_hop(const uint32_t ip) {
+    const PendingNextHop *pending = this->_waiting_arp_response.find(ip);
+    _pending_stats.dropped += pending->_datagrams.size();
+    _pending_stats.datagrams -= pending->_datagrams.size();
+    _pending_stats.bytes -= pending->_bytes;
+    this->_waiting_arp_response.erase(ip);
+    _pending_stats.next_hops = _waiting_arp_response.size();
+}
 
-            arp_req.target_ethernet_address = {};  // want to get
-            arp_req.target_ip_address = next_hop_ip;
+//! \param[in] batch the datagrams to be sent, with the IP addresses of their next hops
+void NetworkInterface::send_datagrams(const vector<OutboundDatagram> &batch) {
+    send_datagrams(vector<OutboundDatagram>(batch));
+}
 
-            // broadcast an ARP request
-            EthernetFrame eth_frame;
-            eth_frame.header() = {ETHERNET_BROADCAST, this->_ethernet_address, EthernetHeader::TYPE_ARP};
-            eth_frame.payload() = arp_req.serialize();
-            _frames_out.push(eth_frame);
+//! \param[in] batch the datagrams to be sent, with the IP addresses of their next hops; the datagrams are left empty
+void NetworkInterface::send_datagrams(vector<OutboundDatagram> &&batch) {
+    // send_datagram() never changes `_arp_tbl`, so the looked-up entry stays valid
+    const ARPItem *arp_item = nullptr;
+    optional<uint32_t> looked_up_ip;
 
-            // add the datagram to waiting queue
-            this->_waiting_queue.push_back(NextHopDatagram{dgram, next_hop});
+    for (auto &out : batch) {
+        if (looked_up_ip != out.next_hop) {
+            arp_item = this->_arp_tbl.find(out.next_hop);
+            looked_up_ip = out.next_hop;
+        }
 
-            // add the IP to the map which contains those have sent an ARP request in last 5 seconds
-            this->_waiting_arp_response.insert(
-                pair<uint32_t, size_t>(next_hop_ip, NetworkInterface::_ttl_wait_for_response));
+        if (arp_item != nullptr) {
+            _send_ipv4_frame(move(out.dgram), arp_item->_eth_addr);
+        } else {
+            send_datagram(move(out.dgram), Address::from_ipv4_numeric(out.next_hop));
         }
     }
 }
 
+void NetworkInterface::_send_ipv4_frame(InternetDatagram &&dgram, const EthernetAddress &dst) {
+    EthernetFrame &eth_frame = _frames_out.emplace();
+
+    eth_frame.header() = {dst, this->_ethernet_address, EthernetHeader::TYPE_IPv4};
+
+    // the payload's Buffers move into the frame as they are, behind the header, which is serialized into a
+    // pooled block and goes in the slot a BufferList keeps free in front of its Buffer
+    Buffer header = dgram.serialize_header();
+    eth_frame.payload() = move(dgram.payload());
+    eth_frame.payload().prepend(move(header));
+}
+
 //! \param[in] frame the incoming Ethernet frame
 optional<InternetDatagram> NetworkInterface::recv_frame(const EthernetFrame &frame) {
     // filter those frames that it's not destined to our address
@@ -120,34 +192,36 @@ optional<InternetDatagram> NetworkInterface::recv_frame(const EthernetFrame &fra
                 arp_reply.target_ethernet_address = arp_msg.sender_ethernet_address;
 
                 // reply the sender
-                EthernetFrame eth_frame;
+                EthernetFrame &eth_frame = _frames_out.emplace();
                 eth_frame.header() = {
                     arp_msg.sender_ethernet_address, this->_ethernet_address, EthernetHeader::TYPE_ARP};
                 eth_frame.payload() = arp_reply.serialize();
-                _frames_out.push(eth_frame);
             }
 
             // if the ARP message is a reply from others
             // and the ethernet address matches ours,
             if (is_arp_request || is_arp_reply) {
                 // insert into `_arp_tbl`
-                this->_arp_tbl.insert(pair<uint32_t, ARPItem>(
-                    arp_msg.sender_ip_address, {arp_msg.sender_ethernet_address, NetworkInterface::_ttl_time_out}));
-
-                // we have found the missing ARP item through broadcasting, now send it
-                auto itr = this->_waiting_queue.begin();
-                while (itr != this->_waiting_queue.end()) {
-                    // find the datagram to be sent
-                    if (itr->_next_hop_addr.ipv4_numeric() == arp_msg.sender_ip_address) {
-                        this->send_datagram(itr->_ip_datagram, itr->_next_hop_addr);
-                        itr = _waiting_queue.erase(itr);
-                    } else {
-                        itr++;
-                    }
+                const uint64_t expires_at = _now_ms + NetworkInterface::_ttl_time_out;
+                if (this->_arp_tbl.insert(arp_msg.sender_ip_address, {arp_msg.sender_ethernet_address, expires_at})
+                        .second) {
+                    _arp_expiry.push({expires_at, arp_msg.sender_ip_address});
                 }
 
-                // remove the IP from the `map`: waiting for ARP response
-                this->_waiting_arp_response.erase(arp_msg.sender_ip_address);
+                // we have found the missing ARP item through broadcasting, now send what was waiting for it
+                PendingNextHop *pending = this->_waiting_arp_response.find(arp_msg.sender_ip_address);
+                if (pending != nullptr) {
+                    const EthernetAddress &dst = this->_arp_tbl.find(arp_msg.sender_ip_address)->_eth_addr;
+                    for (auto &dgram : pending->_datagrams) {
+                        _send_ipv4_frame(move(dgram), dst);
+                    }
+                    _pending_stats.datagrams -= pending->_datagrams.size();
+                    _pending_stats.bytes -= pending->_bytes;
+
+                    // remove the IP from the `map`: waiting for ARP response
+                    this->_waiting_arp_response.erase(arp_msg.sender_ip_address);
+                    _pending_stats.next_hops = _waiting_arp_response.size();
+                }
             }
             return nullopt;
         }
@@ -158,40 +232,32 @@ optional<InternetDatagram> NetworkInterface::recv_frame(const EthernetFrame &fra
 
 //! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
 void NetworkInterface::tick(const size_t ms_since_last_tick) {
+    _now_ms += ms_since_last_tick;
+
     // remove expired items from `arp_tbl`
-    for (auto itr = this->_arp_tbl.begin(); itr != this->_arp_tbl.end();) {
-        if (itr->second._ttl <= ms_since_last_tick) {
-            itr = this->_arp_tbl.erase(itr);
-        } else {
-            itr->second._ttl -= ms_since_last_tick;
-            itr++;
+    while (not _arp_expiry.empty() and _arp_expiry.front()._at <= _now_ms) {
+        const Deadline expired = _arp_expiry.front();
+        _arp_expiry.pop();
+
+        const ARPItem *arp_item = this->_arp_tbl.find(expired._ip);
+        if (arp_item != nullptr and arp_item->_expires_at == expired._at) {
+            this->_arp_tbl.erase(expired._ip);
         }
     }
 
-    // remove expired items from `waiting_arp_response_ip`
-    for (auto itr = this->_waiting_arp_response.begin(); itr != this->_waiting_arp_response.end();) {
-        if (itr->second <= ms_since_last_tick) {
-            // resend an ARP request
-            ARPMessage arp_req;
-
-            arp_req.opcode = ARPMessage::OPCODE_REQUEST;
+    // resend the ARP requests that have gone unanswered for too long, or give up on their next hops
+    while (not _response_expiry.empty() and _response_expiry.front()._at <= _now_ms) {
+        const Deadline expired = _response_expiry.front();
+        _response_expiry.pop();
 
-            arp_req.sender_ethernet_address = this->_ethernet_address;
-            arp_req.sender_ip_address = this->_ip_address.ipv4_numeric();
-
-            arp_req.target_ethernet_address = {};  // want to get
-            arp_req.target_ip_address = itr->first;
-
-            // broadcast an ARP request
-            EthernetFrame eth_frame;
-            eth_frame.header() = {ETHERNET_BROADCAST, this->_ethernet_address, EthernetHeader::TYPE_ARP};
-            eth_frame.payload() = arp_req.serialize();
-            _frames_out.push(eth_frame);
-
-            itr->second = NetworkInterface::_ttl_wait_for_response;
+        const PendingNextHop *pending = this->_waiting_arp_response.find(expired._ip);
+        if (pending == nullptr or pending->_resend_at != expired._at) {
+            continue;
+        }
+        if (pending->_requests >= _pending_limits.arp_requests) {
+            _give_up_next_hop(expired._ip);
         } else {
-            itr->second -= ms_since_last_tick;
-            itr++;
+            _send_arp_request(expired._ip);
         }
     }
 }
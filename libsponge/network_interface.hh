@@ -2,13 +2,22 @@
 #define SPONGE_LIBSPONGE_NETWORK_INTERFACE_HH
 
 #include "ethernet_frame.hh"
+#include "ipv4_map.hh"
 #include "tcp_over_ip.hh"
 #include "tun.hh"
 
-#include <list>
-#include <map>
+#include <cstdint>
 #include <optional>
 #include <queue>
+#include <vector>
+
+//! \brief Bounds on the datagrams a NetworkInterface holds while it waits for ARP replies
+struct PendingDatagramLimits {
+    size_t per_next_hop = 64;       //!< Datagrams held for any one next hop
+    size_t total_bytes = 1 << 20;  //!< Bytes of datagrams held for all next hops together
+    size_t next_hops = 1024;       //!< Next hops waited for at once; datagrams for others are dropped
+    unsigned arp_requests = 3;     //!< ARP requests sent for a next hop before its datagrams are dropped
+};
 
 //! \brief A "network interface" that connects IP (the internet layer, or network layer)
 //! with Ethernet (the network access layer, or link layer).
@@ -32,6 +41,15 @@
 //! request or reply, the network interface processes the frame
 //! and learns or replies as necessary.
 class NetworkInterface {
+  public:
+    //! Counters describing the datagrams waiting for ARP replies
+    struct PendingStats {
+        size_t datagrams{0};  //!< Datagrams waiting for their next hop to be resolved
+        size_t bytes{0};      //!< Total size of those datagrams
+        size_t dropped{0};    //!< Datagrams discarded because a PendingDatagramLimits bound was reached
+        size_t next_hops{0};  //!< Next hops with an unanswered ARP request
+    };
+
   private:
     //! Ethernet (known as hardware, network-access-layer, or link-layer) address of the interface
     EthernetAddress _ethernet_address;
@@ -48,42 +66,101 @@ class NetworkInterface {
     // ttl wait for response
     static constexpr size_t _ttl_wait_for_response = 5 * 1000;
 
+    //! Milliseconds passed to tick() since the interface was created
+    uint64_t _now_ms{0};
+
     // ARP item
     struct ARPItem {
-        EthernetAddress _eth_addr;
-        size_t _ttl;
+        EthernetAddress _eth_addr{};
+        uint64_t _expires_at{0};  //!< value of `_now_ms` at which the mapping is forgotten
     };
 
     // ARP table, mapping from ip address to ARP item
-    std::map<uint32_t, ARPItem> _arp_tbl;
+    IPv4Map<ARPItem> _arp_tbl{};
+
+    //! An ARP request that has not been answered yet, and the datagrams waiting for the answer
+    struct PendingNextHop {
+        uint64_t _resend_at{0};  //!< value of `_now_ms` at which to send the request again
+        unsigned _requests{0};   //!< ARP requests sent so far
+        std::vector<InternetDatagram> _datagrams{};
+        size_t _bytes{0};  //!< total size of `_datagrams`
+    };
 
-    struct NextHopDatagram {
-        InternetDatagram _ip_datagram;
-        Address _next_hop_addr;
+    // The ARP datagram being queried.
+    // If an ARP request is sent and no response is returned within `_ttl_wait_for_response`,
+    // the request is sent again, up to `_pending_limits.arp_requests` times in all
+    // mapping from ip -> request and the datagrams to send once it is answered
+    IPv4Map<PendingNextHop> _waiting_arp_response{};
+
+    PendingDatagramLimits _pending_limits;
+    PendingStats _pending_stats{};
+
+    //! A deadline set for an entry of `_arp_tbl` or `_waiting_arp_response`. It only applies if
+    //! the entry still exists and still holds the same deadline.
+    struct Deadline {
+        uint64_t _at;
+        uint32_t _ip;
     };
 
-    // IPDatagram queue waiting for ARP response
-    std::list<NextHopDatagram> _waiting_queue;
+    //! \brief Deadlines of the entries of `_arp_tbl` and `_waiting_arp_response`, earliest first.
 
-    // The ARP datagram being queried.
-    // If an ARP request is sent and no response is returned within `_ttl_time_out`,
-    // the waiting IP datagram is discarded
-    // mapping from ip -> ttl
-    std::map<uint32_t, size_t> _waiting_arp_response;
+    //! Every mapping is kept, and every request waited for, the same length of time, so deadlines
+    //! are set in increasing order and appending keeps each queue sorted: tick() only looks at the
+    //! deadlines that have passed, however many neighbours there are.
+    std::queue<Deadline> _arp_expiry{};
+    std::queue<Deadline> _response_expiry{};
+
+    //! Broadcast an ARP request for `ip` and (re)start waiting for the response
+    PendingNextHop &_send_arp_request(const uint32_t ip);
+
+    //! Hold `dgram` until its next hop is resolved, unless that would exceed `_pending_limits`
+    void _hold_datagram(PendingNextHop &pending, InternetDatagram &&dgram);
+
+    //! Stop waiting for `ip`, dropping the datagrams held for it
+    void _give_up_next_hop(const uint32_t ip);
+
+    //! Encapsulate `dgram` in a frame to `dst` and queue it for transmission; the frame takes over the payload
+    void _send_ipv4_frame(InternetDatagram &&dgram, const EthernetAddress &dst);
 
   public:
+    //! A datagram and the raw 32-bit IPv4 address of its next hop
+    struct OutboundDatagram {
+        InternetDatagram dgram{};
+        uint32_t next_hop{0};
+    };
+
     //! \brief Construct a network interface with given Ethernet (network-access-layer) and IP (internet-layer) addresses
-    NetworkInterface(const EthernetAddress &ethernet_address, const Address &ip_address);
+    NetworkInterface(const EthernetAddress &ethernet_address,
+                     const Address &ip_address,
+                     const PendingDatagramLimits &pending_limits = {});
 
     //! \brief Access queue of Ethernet frames awaiting transmission
     std::queue<EthernetFrame> &frames_out() { return _frames_out; }
 
+    //! \brief The interface's Ethernet address
+    const EthernetAddress &ethernet_address() const { return _ethernet_address; }
+
     //! \brief Sends an IPv4 datagram, encapsulated in an Ethernet frame (if it knows the Ethernet destination address).
 
     //! Will need to use [ARP](\ref rfc::rfc826) to look up the Ethernet destination address for the next hop
     //! ("Sending" is accomplished by pushing the frame onto the frames_out queue.)
+    //! Until the reply arrives, the datagram waits with the others for the same next hop, within the
+    //! bounds of PendingDatagramLimits; datagrams beyond them are dropped, as are those still waiting
+    //! when the last ARP request allowed for their next hop goes unanswered.
     void send_datagram(const InternetDatagram &dgram, const Address &next_hop);
 
+    //! \brief Sends an IPv4 datagram, taking over its payload instead of sharing it (see above)
+    void send_datagram(InternetDatagram &&dgram, const Address &next_hop);
+
+    //! \brief Sends a batch of datagrams, each to its own next hop.
+
+    //! Equivalent to calling send_datagram() on each in order, but consecutive datagrams for the
+    //! same next hop share one ARP table lookup.
+    void send_datagrams(const std::vector<OutboundDatagram> &batch);
+
+    //! \brief Sends a batch of datagrams, moving them out of `batch` (see above)
+    void send_datagrams(std::vector<OutboundDatagram> &&batch);
+
     //! \brief Receives an Ethernet frame and responds appropriately.
 
     //! If type is IPv4, returns the datagram.
@@ -93,6 +170,9 @@ class NetworkInterface {
 
     //! \brief Called periodically when time elapses
     void tick(const size_t ms_since_last_tick);
+
+    //! Counters describing the datagrams waiting for ARP replies
+    const PendingStats &pending_stats() const { return _pending_stats; }
 };
 
 #endif  // SPONGE_LIBSPONGE_NETWORK_INTERFACE_HH
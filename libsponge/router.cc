@@ -1,6 +1,12 @@
 #include "router.hh"
 
+#include "spsc_ring.hh"
+
+#include <atomic>
 #include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
 
 using namespace std;
 
@@ -18,6 +24,37 @@ using namespace std;
 template <typename... Targs>
 void DUMMY_CODE(Targs &&.../* unused */) {}
 
+struct Router::Workers {
+    //! Only read and replaced with std::atomic_load and std::atomic_store, so add_route() never blocks a worker
+    shared_ptr<const RoutingTable> table{};
+
+    //! Frames between the owner and each interface's thread
+    vector<unique_ptr<SPSCRing<EthernetFrame>>> rx{}, tx{};
+
+    //! fabric[from * n + to] carries datagrams from the thread of interface `from` to that of interface `to`
+    vector<unique_ptr<SPSCRing<NetworkInterface::OutboundDatagram>>> fabric{};
+
+    //! Milliseconds passed to tick_workers() that each interface has not been told about yet
+    unique_ptr<atomic<size_t>[]> pending_ms{};
+
+    atomic<bool> stop{false};
+    atomic<uint64_t> drops{0};
+    vector<thread> threads{};
+};
+
+Router::Router() : _workers() {}
+Router::~Router() { stop_workers(); }
+Router::Router(Router &&other) = default;
+Router &Router::operator=(Router &&other) = default;
+
+size_t Router::add_interface(AsyncNetworkInterface &&interface) {
+    if (_workers) {
+        throw runtime_error("Router: cannot add an interface while the workers are running");
+    }
+    _interfaces.push_back(std::move(interface));
+    return _interfaces.size() - 1;
+}
+
 //! \param[in] route_prefix The "up-to-32-bit" IPv4 address prefix to match the datagram's destination address against
 //! \param[in] prefix_length For this route to be applicable, how many high-order (most-significant) bits of the route_prefix will need to match the corresponding bits of the datagram's destination address?
 //! \param[in] next_hop The IP address of the next hop. Will be empty if the network is directly attached to the router (in which case, the next hop address should be the datagram's final destination).
@@ -29,47 +66,277 @@ void Router::add_route(const uint32_t route_prefix,
     cerr << "DEBUG: adding route " << Address::from_ipv4_numeric(route_prefix).ip() << "/" << int(prefix_length)
          << " => " << (next_hop.has_value() ? next_hop->ip() : "(direct)") << " on interface " << interface_num << "\n";
 
+    _insert_route(route_prefix, prefix_length, next_hop, interface_num);
+
+    if (_workers) {
+        _publish_routes();
+    }
+}
+
+//! \param[in] routes The routes, each as the arguments of add_route()
+void Router::add_routes(const vector<Route> &routes) {
+    for (const auto &route : routes) {
+        if (route.interface_num >= _interfaces.size()) {
+            throw runtime_error("Router: route to nonexistent interface " + to_string(route.interface_num));
+        }
+    }
+    _router_tbl.reserve(_router_tbl.size() + routes.size());
+    for (const auto &route : routes) {
+        _insert_route(route.route_prefix, route.prefix_length, route.next_hop, route.interface_num);
+    }
+
+    if (_workers and not routes.empty()) {
+        _publish_routes();
+    }
+}
+
+void Router::_insert_route(const uint32_t route_prefix,
+                           const uint8_t prefix_length,
+                           const optional<Address> &next_hop,
+                           const size_t interface_num) {
+    // the workers index their fabric with it, so it must never be out of range
+    if (interface_num >= _interfaces.size()) {
+        throw runtime_error("Router: route to nonexistent interface " + to_string(interface_num));
+    }
+    this->_lpm.insert(route_prefix, prefix_length, _router_tbl.size());
     this->_router_tbl.push_back(RouterItem{route_prefix, prefix_length, next_hop, interface_num});
 }
 
+void Router::_publish_routes() {
+    if (not _lpm.built()) {
+        _lpm.build();
+    }
+    shared_ptr<const RoutingTable> table = make_shared<RoutingTable>(RoutingTable{_router_tbl, _lpm});
+    atomic_store(&_workers->table, move(table));
+}
+
 //! \param[in] dgram The datagram to be routed
-void Router::route_one_datagram(InternetDatagram &dgram) {
-    uint32_t dst_ip_addr = dgram.header().dst;
-    uint32_t netmask;
-    uint8_t longest_prefix_match = 0;
-    size_t matches_interface_index = UINT32_MAX;
+//! \param[in] match The result of looking up the datagram's destination in `_lpm`
+bool Router::_forward(InternetDatagram &dgram, const optional<uint32_t> match) {
+    // no match or the packet is time out
+    if (not match.has_value() || as_const(dgram).header().ttl <= 1) {
+        return false;
+    }
 
-    for (auto entry : this->_router_tbl) {
-        netmask = entry._prefix_length == 0 ? 0 : 0xFFFFFFFF << (32 - entry._prefix_length);
+    // adjust the checksum for the new TTL instead of recomputing it when the datagram is serialized
+    dgram.set_ttl(dgram.header().ttl - 1);
+    return true;
+}
 
-        // the destination ip address & netmask matches router prefix
-        if ((dst_ip_addr & netmask) == entry._route_prefix && entry._prefix_length >= longest_prefix_match) {
-            longest_prefix_match = entry._prefix_length;
-            matches_interface_index = entry._interface_index;
-        }
+void Router::_route_batch() {
+    // start loading every destination's table entry before the first lookup needs one
+    for (const auto &dgram : _batch) {
+        _lpm.prefetch(dgram.header().dst);
     }
 
-    // no match or the packet is time out
-    if (matches_interface_index == UINT32_MAX || dgram.header().ttl <= 1) {
-        return;
+    for (auto &dgram : _batch) {
+        const uint32_t dst_ip_addr = as_const(dgram).header().dst;
+        const auto match = _lpm.lookup(dst_ip_addr);
+        if (not _forward(dgram, match)) {
+            continue;
+        }
+
+        const RouterItem &route = _router_tbl[match.value()];
+        const uint32_t next_hop = route._next_hop.has_value() ? route._next_hop->ipv4_numeric() : dst_ip_addr;
+        _egress.at(route._interface_index).push_back({move(dgram), next_hop});
     }
 
-    dgram.header().ttl--;
-    if (this->_router_tbl.at(matches_interface_index)._next_hop.has_value()) {
-        interface(matches_interface_index)
-            .send_datagram(dgram, _router_tbl.at(matches_interface_index)._next_hop.value());
-    } else {  // direct
-        interface(matches_interface_index).send_datagram(dgram, Address::from_ipv4_numeric(dst_ip_addr));
+    for (size_t i = 0; i < _egress.size(); i++) {
+        if (not _egress[i].empty()) {
+            // moving the vector in and clearing it afterwards keeps its capacity for the next batch
+            interface(i).send_datagrams(move(_egress[i]));
+            _egress[i].clear();
+        }
     }
 }
 
 void Router::route() {
-    // Go through all the interfaces, and route every incoming datagram to its proper outgoing interface.
+    if (_workers) {
+        throw runtime_error("Router: route() cannot be used while the workers are running");
+    }
+    if (not _lpm.built()) {
+        _lpm.build();
+    }
+    _egress.resize(_interfaces.size());
+
+    // Go through all the interfaces, and route every incoming datagram to its proper outgoing interface,
+    // up to ROUTE_BATCH_SIZE datagrams at a time.
     for (auto &interface : _interfaces) {
         auto &queue = interface.datagrams_out();
         while (not queue.empty()) {
-            route_one_datagram(queue.front());
-            queue.pop();
+            _batch.clear();
+            while (not queue.empty() and _batch.size() < ROUTE_BATCH_SIZE) {
+                _batch.push_back(move(queue.front()));
+                queue.pop();
+            }
+            _route_batch();
+        }
+    }
+}
+
+//! \param[in] queue_capacity The capacity of each queue between two threads, and between the owner and each thread
+void Router::start_workers(const size_t queue_capacity) {
+    if (_workers) {
+        throw runtime_error("Router: workers are already running");
+    }
+
+    const size_t n = _interfaces.size();
+    _workers = make_unique<Workers>();
+    for (size_t i = 0; i < n; i++) {
+        _workers->rx.push_back(make_unique<SPSCRing<EthernetFrame>>(queue_capacity));
+        _workers->tx.push_back(make_unique<SPSCRing<EthernetFrame>>(queue_capacity));
+    }
+    for (size_t i = 0; i < n * n; i++) {
+        _workers->fabric.push_back(make_unique<SPSCRing<NetworkInterface::OutboundDatagram>>(queue_capacity));
+    }
+    _workers->pending_ms = make_unique<atomic<size_t>[]>(n);
+    _publish_routes();
+
+    for (size_t i = 0; i < n; i++) {
+        _workers->threads.emplace_back(&Router::_worker_loop, this, i);
+    }
+}
+
+void Router::stop_workers() {
+    if (not _workers) {
+        return;
+    }
+
+    Workers &w = *_workers;
+    w.stop.store(true, memory_order_release);
+    for (auto &thread : w.threads) {
+        thread.join();
+    }
+
+    // finish what the threads left in their queues, in the order they would have
+    const size_t n = _interfaces.size();
+    for (size_t i = 0; i < n; i++) {
+        if (const size_t ms = w.pending_ms[i].exchange(0); ms > 0) {
+            _interfaces[i].tick(ms);
+        }
+        while (auto frame = w.rx[i]->pop()) {
+            _interfaces[i].recv_frame(frame.value());
+        }
+    }
+    for (size_t to = 0; to < n; to++) {
+        for (size_t from = 0; from < n; from++) {
+            while (auto out = w.fabric[from * n + to]->pop()) {
+                _interfaces[to].send_datagram(move(out->dgram), Address::from_ipv4_numeric(out->next_hop));
+            }
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        // frames already handed to the owner's queue were sent before those still in the interface
+        queue<EthernetFrame> sent;
+        while (auto frame = w.tx[i]->pop()) {
+            sent.push(move(frame.value()));
+        }
+        auto &frames = _interfaces[i].frames_out();
+        while (not frames.empty()) {
+            sent.push(move(frames.front()));
+            frames.pop();
+        }
+        frames.swap(sent);
+    }
+
+    _fabric_drops += w.drops.load();
+    _workers.reset();
+}
+
+//! \param[in] N The index of the interface that receives the frame
+//! \param[in] frame The frame, which is left untouched if the interface's input queue is full
+bool Router::push_frame(const size_t N, EthernetFrame &&frame) {
+    if (not _workers) {
+        throw runtime_error("Router: push_frame() requires the workers to be running");
+    }
+    return _workers->rx.at(N)->push(move(frame));
+}
+
+//! \param[in] N The index of the interface that sent the frame
+optional<EthernetFrame> Router::pop_frame(const size_t N) {
+    if (not _workers) {
+        throw runtime_error("Router: pop_frame() requires the workers to be running");
+    }
+    return _workers->tx.at(N)->pop();
+}
+
+//! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
+void Router::tick_workers(const size_t ms_since_last_tick) {
+    if (not _workers) {
+        throw runtime_error("Router: tick_workers() requires the workers to be running");
+    }
+    for (size_t i = 0; i < _interfaces.size(); i++) {
+        _workers->pending_ms[i].fetch_add(ms_since_last_tick, memory_order_relaxed);
+    }
+}
+
+uint64_t Router::fabric_drops() const { return _fabric_drops + (_workers ? _workers->drops.load() : 0); }
+
+//! \param[in] N The index of the interface this thread owns
+void Router::_worker_loop(const size_t N) {
+    Workers &w = *_workers;
+    AsyncNetworkInterface &interface = _interfaces[N];
+    const size_t n = _interfaces.size();
+    vector<NetworkInterface::OutboundDatagram> inbound;
+
+    while (not w.stop.load(memory_order_acquire)) {
+        bool idle = true;
+
+        if (const size_t ms = w.pending_ms[N].exchange(0, memory_order_relaxed); ms > 0) {
+            interface.tick(ms);
+        }
+
+        // frames from the link, a batch at a time so the other stages keep up
+        for (size_t i = 0; i < ROUTE_BATCH_SIZE; i++) {
+            auto frame = w.rx[N]->pop();
+            if (not frame.has_value()) {
+                break;
+            }
+            interface.recv_frame(frame.value());
+            idle = false;
+        }
+
+        // route what they carried, against the newest published table
+        auto &received = interface.datagrams_out();
+        if (not received.empty()) {
+            const shared_ptr<const RoutingTable> table = atomic_load(&w.table);
+            while (not received.empty()) {
+                auto &dgram = received.front();
+                const uint32_t dst_ip_addr = as_const(dgram).header().dst;
+                const auto match = table->lpm.lookup(dst_ip_addr);
+                if (_forward(dgram, match)) {
+                    const RouterItem &route = table->routes[match.value()];
+                    const uint32_t next_hop =
+                        route._next_hop.has_value() ? route._next_hop->ipv4_numeric() : dst_ip_addr;
+                    if (not w.fabric[N * n + route._interface_index]->push({move(dgram), next_hop})) {
+                        w.drops.fetch_add(1, memory_order_relaxed);
+                    }
+                }
+                received.pop();
+            }
+        }
+
+        // datagrams other threads routed to this interface
+        for (size_t from = 0; from < n; from++) {
+            while (auto out = w.fabric[from * n + N]->pop()) {
+                inbound.push_back(move(out.value()));
+            }
+        }
+        if (not inbound.empty()) {
+            interface.send_datagrams(move(inbound));
+            inbound.clear();
+            idle = false;
+        }
+
+        // frames for the link; any that do not fit wait in the interface for the owner to catch up
+        auto &frames = interface.frames_out();
+        while (not frames.empty() and w.tx[N]->push(move(frames.front()))) {
+            frames.pop();
+            idle = false;
+        }
+
+        if (idle) {
+            this_thread::yield();
         }
     }
 }
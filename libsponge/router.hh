@@ -1,8 +1,11 @@
 #ifndef SPONGE_LIBSPONGE_ROUTER_HH
 #define SPONGE_LIBSPONGE_ROUTER_HH
 
+#include "lpm_table.hh"
 #include "network_interface.hh"
 
+#include <cstdint>
+#include <memory>
 #include <optional>
 #include <queue>
 
@@ -44,11 +47,6 @@ class Router {
     //! The router's collection of network interfaces
     std::vector<AsyncNetworkInterface> _interfaces{};
 
-    //! Send a single datagram from the appropriate outbound interface to the next hop,
-    //! as specified by the route with the longest prefix_length that matches the
-    //! datagram's destination address.
-    void route_one_datagram(InternetDatagram &dgram);
-
     // `add_route` arguments list is an item for router table
     struct RouterItem {
         const uint32_t _route_prefix;
@@ -58,26 +56,121 @@ class Router {
     };
     std::vector<RouterItem> _router_tbl{};
 
+    //! Maps a destination address to the index in `_router_tbl` of the route to use
+    LPMTable _lpm{};
+
+    //! Datagrams route() drains from an interface before forwarding them together
+    static constexpr size_t ROUTE_BATCH_SIZE = 32;
+
+    //! route()'s scratch space: one batch of drained datagrams, and the forwarded ones grouped by interface
+    std::vector<InternetDatagram> _batch{};
+    std::vector<std::vector<NetworkInterface::OutboundDatagram>> _egress{};
+
+    //! Decrement the TTL of `dgram` if it has a route.
+    //! \returns false if the datagram should be dropped
+    static bool _forward(InternetDatagram &dgram, const std::optional<uint32_t> match);
+
+    //! Forward every datagram in `_batch`, one bulk send per outbound interface
+    void _route_batch();
+
+    //! A read-only copy of the routing table, shared by the worker threads
+    struct RoutingTable {
+        std::vector<RouterItem> routes;
+        LPMTable lpm;
+    };
+
+    //! Threads, queues and the published routing table of the multi-core mode
+    struct Workers;
+    std::unique_ptr<Workers> _workers;
+
+    //! Datagrams the workers dropped before they were last stopped
+    uint64_t _fabric_drops{0};
+
+    //! Give the workers a copy of the current routing table
+    void _publish_routes();
+
+    //! Check a route's interface and add it to `_router_tbl` and `_lpm`, without publishing it
+    void _insert_route(const uint32_t route_prefix,
+                       const uint8_t prefix_length,
+                       const std::optional<Address> &next_hop,
+                       const size_t interface_num);
+
+    //! Body of the thread that owns interface `N`
+    void _worker_loop(const size_t N);
+
   public:
+    Router();
+    ~Router();
+
+    //! \note A router must not be moved while its workers are running
+    Router(Router &&other);
+    Router &operator=(Router &&other);
+
     //! Add an interface to the router
     //! \param[in] interface an already-constructed network interface
     //! \returns The index of the interface after it has been added to the router
-    size_t add_interface(AsyncNetworkInterface &&interface) {
-        _interfaces.push_back(std::move(interface));
-        return _interfaces.size() - 1;
-    }
+    size_t add_interface(AsyncNetworkInterface &&interface);
 
     //! Access an interface by index
     AsyncNetworkInterface &interface(const size_t N) { return _interfaces.at(N); }
 
     //! Add a route (a forwarding rule)
+    //! \throws std::runtime_error if `interface_num` is not the index of an interface
     void add_route(const uint32_t route_prefix,
                    const uint8_t prefix_length,
                    const std::optional<Address> next_hop,
                    const size_t interface_num);
 
+    //! The arguments of add_route(), for add_routes()
+    struct Route {
+        uint32_t route_prefix;
+        uint8_t prefix_length;
+        std::optional<Address> next_hop;
+        size_t interface_num;
+    };
+
+    //! \brief Add many routes at once
+    //! While the workers run, the table is published once for the whole set rather than once per route.
+    //! \throws std::runtime_error if a route's interface does not exist, in which case no route is added
+    void add_routes(const std::vector<Route> &routes);
+
     //! Route packets between the interfaces
     void route();
+
+    //! \name Multi-core mode
+    //! start_workers() gives every interface a thread of its own, which receives the interface's
+    //! frames, looks up their routes in a copy of the routing table and hands the datagrams to the
+    //! egress interface's thread over a bounded queue. Until stop_workers(), the owner must not use
+    //! interface() or route(), but exchange frames with push_frame() and pop_frame() and pass time
+    //! with tick_workers(). add_route() may still be called: it publishes a new copy of the table,
+    //! which takes effect for frames pushed after it returns. To load many routes, use add_routes(),
+    //! which copies the table only once.
+    //!@{
+
+    //! \brief Start one thread per interface
+    //! \param[in] queue_capacity the capacity of each queue between two threads
+    void start_workers(const size_t queue_capacity = 1024);
+
+    //! \brief Stop the threads. Frames and datagrams still queued between them are handed to their
+    //! interfaces, which the owner may use directly again.
+    void stop_workers();
+
+    //! Are the worker threads running?
+    bool workers_running() const { return _workers != nullptr; }
+
+    //! \brief Give a frame to interface `N` as if it had been received on its link
+    //! \returns false if the interface's input queue is full (the frame is not consumed)
+    bool push_frame(const size_t N, EthernetFrame &&frame);
+
+    //! A frame sent by interface `N`, if any
+    std::optional<EthernetFrame> pop_frame(const size_t N);
+
+    //! Tell every interface that time has passed
+    void tick_workers(const size_t ms_since_last_tick);
+
+    //! Datagrams dropped because the queue to their egress interface was full
+    uint64_t fabric_drops() const;
+    //!@}
 };
 
 #endif  // SPONGE_LIBSPONGE_ROUTER_HH
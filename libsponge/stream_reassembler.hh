@@ -1,30 +1,79 @@
 #ifndef SPONGE_LIBSPONGE_STREAM_REASSEMBLER_HH
 #define SPONGE_LIBSPONGE_STREAM_REASSEMBLER_HH
 
+#include "buffer.hh"
 #include "byte_stream.hh"
 
 #include <cstdint>
 #include <map>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 //! \brief A class that assembles a series of excerpts from a byte stream (possibly out of order,
 //! possibly overlapping) into an in-order byte stream.
 class StreamReassembler {
+  public:
+    //! Counters describing what the reassembler is holding and what it has thrown away
+    struct Stats {
+        size_t segments_held{0};  //!< Disjoint runs of bytes waiting to be assembled
+        size_t bytes_held{0};     //!< Same as unassembled_bytes()
+        size_t bytes_dropped{0};  //!< Bytes discarded because they were outside the window or over the memory limit
+        size_t coalesce_ops{0};   //!< Times a stored run was merged with a new or neighbouring one
+        size_t memory_usage{0};   //!< Same as memory_usage()
+    };
+
   private:
+    //! Estimated heap cost of one red-black tree node holding `T`: the value plus parent/left/right links and colour
+    template <typename T>
+    static constexpr size_t _node_size = sizeof(T) + 4 * sizeof(void *);
+
+    static constexpr size_t FILLED_NODE_SIZE = _node_size<std::pair<const uint64_t, uint64_t>>;
+    static constexpr size_t HELD_NODE_SIZE = _node_size<std::pair<const uint64_t, Buffer>>;
+
     // Your code here -- add private members as necessary.
-    std::map<size_t, std::string> _unassemble_strs;
+    std::vector<char> _ring;               // 按 `index % _capacity` 存放窗口内尚未写入 _output 的字节
+    std::map<uint64_t, uint64_t> _filled;  // 已填充的区间 [first, second)，互不重叠且互不相邻
+    std::map<uint64_t, Buffer> _held;      // 以 Buffer 形式传入、未拷贝进 _ring 的片段，互不重叠
+    size_t _held_bytes;                    // _held 中所有切片的总长度
     size_t _next_assembled_idx;
     size_t _unassembled_bytes_num;
     size_t _eof_idx;
 
+    size_t _memory_limit;   // memory_usage() 的上限，0 表示不限制
+    size_t _bytes_dropped;  // 因超出窗口或内存上限而丢弃的字节数
+    size_t _coalesce_ops;   // _filled 中区间被合并的次数
+
     ByteStream _output;  //!< The reassembled in-order byte stream
     size_t _capacity;    //!< The maximum number of bytes
 
+    // 将 [index, index + len) 截断到窗口内并检查内存上限，返回可以接受的区间 [start, end)
+    std::pair<uint64_t, uint64_t> _admit(const uint64_t index, const size_t len);
+
+    // 将 data 中对应 [start, end) 的字节拷贝进 _ring
+    void _copy_to_ring(const std::string_view data, const uint64_t index, const uint64_t start, const uint64_t end);
+
+    // 将 [start, end) 中尚未填充的部分作为 data 的切片存入 _held
+    void _hold_gaps(const Buffer &data, const uint64_t index, const uint64_t start, const uint64_t end);
+
+    // 将 [start, end) 登记为已填充，返回其中新增的字节数
+    size_t _mark_filled(const uint64_t start, const uint64_t end);
+
+    // 将从 _next_assembled_idx 开始的连续字节批量写入 _output
+    void _assemble();
+
+    // 将 _ring 中 [start, start + len) 的字节写入 _output，返回实际写入的字节数
+    size_t _write_from_ring(const uint64_t start, const size_t len);
+
   public:
     //! \brief Construct a `StreamReassembler` that will store up to `capacity` bytes.
     //! \note This capacity limits both the bytes that have been reassembled,
     //! and those that have not yet been reassembled.
-    StreamReassembler(const size_t capacity);
+    //! \param memory_limit if nonzero, a strict bound on memory_usage(). Out-of-order segments
+    //! that would push it past the limit are dropped, and Buffer payloads are copied
+    //! rather than held. The limit must be at least `capacity`.
+    StreamReassembler(const size_t capacity, const size_t memory_limit = 0);
 
     //! \brief Receive a substring and write any newly contiguous bytes into the stream.
     //!
@@ -36,6 +85,12 @@ class StreamReassembler {
     //! \param eof the last byte of `data` will be the last byte in the entire stream
     void push_substring(const std::string &data, const uint64_t index, const bool eof);
 
+    //! \brief Receive a substring held in a Buffer, e.g. a TCPSegment payload.
+    //!
+    //! Same as above, except that out-of-order bytes are kept as trimmed slices of `data`
+    //! (sharing its storage) rather than copied, so the only copy is the one into the stream.
+    void push_substring(const Buffer &data, const uint64_t index, const bool eof);
+
     //! \name Access the reassembled byte stream
     //!@{
     const ByteStream &stream_out() const { return _output; }
@@ -48,6 +103,13 @@ class StreamReassembler {
     //! should only be counted once for the purpose of this function.
     size_t unassembled_bytes() const;
 
+    //! \brief Estimated heap use of the reassembler, excluding the output stream.
+    //! This counts the ring, the tree nodes that track stored runs, and any held payload bytes.
+    size_t memory_usage() const;
+
+    //! Counters for sizing `capacity` and `memory_limit`
+    Stats stats() const;
+
     //! \brief Is the internal state empty (other than the output stream)?
     //! \returns `true` if no substrings are waiting to be assembled
     bool empty() const;
@@ -45,31 +45,34 @@ bool ARPMessage::supported() const {
 }
 
 string ARPMessage::serialize() const {
+    string ret(LENGTH, 0);
+    serialize_into(reinterpret_cast<uint8_t *>(ret.data()));
+    return ret;
+}
+
+void ARPMessage::serialize_into(uint8_t *out) const {
     if (not supported()) {
         throw runtime_error(
             "ARPMessage::serialize(): unsupported field combination (must be Ethernet/IP, and request or reply)");
     }
 
-    string ret;
-    NetUnparser::u16(ret, hardware_type);
-    NetUnparser::u16(ret, protocol_type);
-    NetUnparser::u8(ret, hardware_address_size);
-    NetUnparser::u8(ret, protocol_address_size);
-    NetUnparser::u16(ret, opcode);
+    out = NetUnparser::u16(out, hardware_type);
+    out = NetUnparser::u16(out, protocol_type);
+    out = NetUnparser::u8(out, hardware_address_size);
+    out = NetUnparser::u8(out, protocol_address_size);
+    out = NetUnparser::u16(out, opcode);
 
     /* write sender addresses */
     for (auto &byte : sender_ethernet_address) {
-        NetUnparser::u8(ret, byte);
+        out = NetUnparser::u8(out, byte);
     }
-    NetUnparser::u32(ret, sender_ip_address);
+    out = NetUnparser::u32(out, sender_ip_address);
 
     /* write target addresses */
     for (auto &byte : target_ethernet_address) {
-        NetUnparser::u8(ret, byte);
+        out = NetUnparser::u8(out, byte);
     }
-    NetUnparser::u32(ret, target_ip_address);
-
-    return ret;
+    NetUnparser::u32(out, target_ip_address);
 }
 
 string ARPMessage::to_string() const {
@@ -17,8 +17,7 @@ ParseResult EthernetFrame::parse(const Buffer buffer) {
 }
 
 BufferList EthernetFrame::serialize() const {
-    BufferList ret;
-    ret.append(_header.serialize());
-    ret.append(_payload);
+    BufferList ret = _payload;
+    ret.prepend(_header.serialize());
     return ret;
 }
@@ -2,6 +2,7 @@
 
 #include "util.hh"
 
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
 
@@ -28,26 +29,35 @@ ParseResult EthernetHeader::parse(NetParser &p) {
     return p.get_error();
 }
 
+void EthernetHeader::parse_from(const uint8_t *in) {
+    copy(in, in + dst.size(), dst.begin());
+    copy(in + dst.size(), in + dst.size() + src.size(), src.begin());
+    type = NetParser::u16(in + 12);
+}
+
 string EthernetHeader::serialize() const {
-    string ret;
-    ret.reserve(LENGTH);
+    string ret(LENGTH, 0);
+    serialize_into(reinterpret_cast<uint8_t *>(ret.data()));
+    return ret;
+}
 
+void EthernetHeader::serialize_into(uint8_t *out) const {
     /* write destination address */
     for (auto &byte : dst) {
-        NetUnparser::u8(ret, byte);
+        out = NetUnparser::u8(out, byte);
     }
 
     /* write source address */
     for (auto &byte : src) {
-        NetUnparser::u8(ret, byte);
+        out = NetUnparser::u8(out, byte);
     }
 
     /* write the frame's type (e.g. IPv4, ARP or something else) */
-    NetUnparser::u16(ret, type);
-
-    return ret;
+    NetUnparser::u16(out, type);
 }
 
+void EthernetHeader::prepend_to(PacketBuffer &pkt) const { serialize_into(pkt.prepend(LENGTH)); }
+
 //! \returns A string with a textual representation of an Ethernet address
 string to_string(const EthernetAddress address) {
     stringstream ss{};
@@ -1,6 +1,7 @@
 #ifndef SPONGE_LIBSPONGE_ETHERNET_HEADER_HH
 #define SPONGE_LIBSPONGE_ETHERNET_HEADER_HH
 
+#include "packet_buffer.hh"
 #include "parser.hh"
 
 #include <array>
@@ -30,9 +31,18 @@ struct EthernetHeader {
     //! Parse the Ethernet fields from the provided NetParser
     ParseResult parse(NetParser &p);
 
+    //! Read the Ethernet fields from the LENGTH bytes at `in`, which the caller has checked are there
+    void parse_from(const uint8_t *in);
+
     //! Serialize the Ethernet fields to a string
     std::string serialize() const;
 
+    //! Serialize the Ethernet fields into the LENGTH bytes at `out`, without allocating
+    void serialize_into(uint8_t *out) const;
+
+    //! Serialize the Ethernet fields in front of the frame's payload, in the headroom of `pkt`
+    void prepend_to(PacketBuffer &pkt) const;
+
     //! Return a string containing a header in human-readable format
     std::string to_string() const;
 };
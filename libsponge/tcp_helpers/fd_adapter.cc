@@ -17,10 +17,19 @@ using namespace std;
 //! and the TCP segment read from the wire includes a SYN, this function clears the
 //! `_listen` flag and calls calls connect() on the underlying UDP socket, with
 //! the result that future outgoing segments go to the sender of the SYN segment.
+//!
+//! The payload is received into a block from the PacketBuffer pool, which the segment's payload
+//! goes on sharing. A datagram longer than PacketBuffer::BLOCK_SIZE is copied into a block of its own
+//! (see oversized()).
 //! \returns a std::optional<TCPSegment> that is empty if the segment was invalid or unrelated
 optional<TCPSegment> TCPOverUDPSocketAdapter::read() {
-    auto datagram = _sock.recv();
+    UDPSocket::received_buffer datagram{{nullptr, 0}, {}};
+    _sock.recv(datagram);
+    return _unwrap(datagram);
+}
 
+//! \param[in] datagram is a UDP datagram received on the socket; its payload is moved into the segment
+optional<TCPSegment> TCPOverUDPSocketAdapter::_unwrap(UDPSocket::received_buffer &datagram) {
     // is it for us?
     if (not listening() and (datagram.source_address != config().destination)) {
         return {};
@@ -53,5 +62,50 @@ void TCPOverUDPSocketAdapter::write(TCPSegment &seg) {
     _sock.sendto(config().destination, seg.serialize(0));
 }
 
+//! \param[in] seg is the TCP segment to write
+//! \param[in] ring is where the UDP datagram is queued, until IOUring::submit
+void TCPOverUDPSocketAdapter::write(TCPSegment &seg, IOUring &ring) {
+    seg.header().sport = config().source.port();
+    seg.header().dport = config().destination.port();
+    ring.sendto(_sock, config().destination, seg.serialize(0));
+}
+
+//! \details Like read(), but for every datagram that is already waiting (up to UDPSocket::MAX_BATCH).
+//! Once a SYN has been accepted in listening mode, the rest of the batch is filtered as for an open connection.
+//! \param[out] segments is cleared, then filled with the valid and related segments, in the order received
+void TCPOverUDPSocketAdapter::read_batch(vector<TCPSegment> &segments) {
+    if (config().udp_gso and not _gro) {
+        _sock.set_gro(true);
+        _gro = true;
+    }
+
+    // a datagram coalesced by GRO can be as long as any UDP datagram, so it needs a large block
+    segments.clear();
+    if (_gro) {
+        _sock.recv_batch(_received, GRO_BATCH, PacketBuffer::LARGE_BLOCK_SIZE);
+    } else {
+        _sock.recv_batch(_received, UDPSocket::MAX_BATCH, PacketBuffer::BLOCK_SIZE);
+    }
+    for (auto &datagram : _received) {
+        auto seg = _unwrap(datagram);
+        if (seg) {
+            segments.push_back(move(seg.value()));
+        }
+    }
+}
+
+//! \param[in,out] segments are the TCP segments to write; it is empty on return
+void TCPOverUDPSocketAdapter::write_batch(queue<TCPSegment> &segments) {
+    _to_send.clear();
+    while (not segments.empty()) {
+        TCPSegment &seg = segments.front();
+        seg.header().sport = config().source.port();
+        seg.header().dport = config().destination.port();
+        _to_send.push_back(seg.serialize(0));
+        segments.pop();
+    }
+    _sock.send_batch(config().destination, _to_send, config().udp_gso);
+}
+
 //! Specialize LossyFdAdapter to TCPOverUDPSocketAdapter
 template class LossyFdAdapter<TCPOverUDPSocketAdapter>;
@@ -2,6 +2,7 @@
 #define SPONGE_LIBSPONGE_FD_ADAPTER_HH
 
 #include "file_descriptor.hh"
+#include "io_uring.hh"
 #include "lossy_fd_adapter.hh"
 #include "socket.hh"
 #include "tcp_config.hh"
@@ -9,7 +10,9 @@
 #include "tcp_segment.hh"
 
 #include <optional>
+#include <queue>
 #include <utility>
+#include <vector>
 
 //! \brief Basic functionality for file descriptor adaptors
 //! \details See TCPOverUDPSocketAdapter and TCPOverIPv4OverTunFdAdapter for more information.
@@ -47,6 +50,17 @@ class TCPOverUDPSocketAdapter : public FdAdapterBase {
   private:
     UDPSocket _sock;
 
+    //! With GRO, read_batch() receives into this many slots rather than UDPSocket::MAX_BATCH, since each takes a
+    //! PacketBuffer::LARGE_BLOCK_SIZE block and can hold a run of up to 64 datagrams
+    static constexpr size_t GRO_BATCH = 8;
+
+    std::vector<UDPSocket::received_buffer> _received{};  //!< reused by read_batch()
+    std::vector<BufferList> _to_send{};                   //!< reused by write_batch()
+    bool _gro{false};                                     //!< has UDP GRO been enabled on _sock?
+
+    //! The TCP segment in `datagram`, if it is valid and related to the current connection
+    std::optional<TCPSegment> _unwrap(UDPSocket::received_buffer &datagram);
+
   public:
     //! Construct from a UDPSocket sliced into a FileDescriptor
     explicit TCPOverUDPSocketAdapter(UDPSocket &&sock) : _sock(std::move(sock)) {}
@@ -57,6 +71,21 @@ class TCPOverUDPSocketAdapter : public FdAdapterBase {
     //! Writes a TCP segment into a UDP payload
     void write(TCPSegment &seg);
 
+    //! Queues a TCP segment in a UDP payload on `ring`
+    void write(TCPSegment &seg, IOUring &ring);
+
+    //! Replaces `segments` with the TCP segments related to the current connection from the UDP payloads
+    //! that one [recvmmsg(2)](\ref man2::recvmmsg) returns
+    void read_batch(std::vector<TCPSegment> &segments);
+
+    //! Writes (and pops) every segment in `segments`, each in a UDP payload, with one
+    //! [sendmmsg(2)](\ref man2::sendmmsg)
+    void write_batch(std::queue<TCPSegment> &segments);
+
+    //! Datagrams too long for a PacketBuffer::BLOCK_SIZE block, which read() and read_batch() copied into a
+    //! block of their own (see UDPSocket::oversized())
+    size_t oversized() const { return _sock.oversized(); }
+
     //! Access the underlying UDP socket
     operator UDPSocket &() { return _sock; }
 
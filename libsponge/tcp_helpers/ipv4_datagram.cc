@@ -1,18 +1,64 @@
 #include "ipv4_datagram.hh"
 
+#include "packet_buffer.hh"
 #include "parser.hh"
 #include "util.hh"
 
+#include <algorithm>
 #include <stdexcept>
 #include <string>
 
 using namespace std;
 
+//! Whether every field of `a` and `b`, including the checksum, is the same
+static bool same_fields(const IPv4Header &a, const IPv4Header &b) {
+    return a.ver == b.ver and a.hlen == b.hlen and a.tos == b.tos and a.len == b.len and a.id == b.id and
+           a.df == b.df and a.mf == b.mf and a.offset == b.offset and a.ttl == b.ttl and a.proto == b.proto and
+           a.cksum == b.cksum and a.src == b.src and a.dst == b.dst;
+}
+
+bool IPv4Datagram::_header_cksum_valid() const {
+    return _checked_header.has_value() and same_fields(_checked_header.value(), _header);
+}
+
+void IPv4Datagram::set_ttl(const uint8_t ttl) {
+    if (_header_cksum_valid()) {
+        _header.set_ttl(ttl);
+        _checked_header = _header;
+    } else {
+        _header.ttl = ttl;
+    }
+}
+
+void IPv4Datagram::set_src(const uint32_t src) {
+    if (_header_cksum_valid()) {
+        _header.set_src(src);
+        _checked_header = _header;
+    } else {
+        _header.src = src;
+    }
+}
+
+void IPv4Datagram::set_dst(const uint32_t dst) {
+    if (_header_cksum_valid()) {
+        _header.set_dst(dst);
+        _checked_header = _header;
+    } else {
+        _header.dst = dst;
+    }
+}
+
 ParseResult IPv4Datagram::parse(const Buffer buffer) {
     NetParser p{buffer};
-    _header.parse(p);
+    const ParseResult header_result = _header.parse(p);
     _payload = p.buffer();
 
+    // options are not kept, so a header with options must be checksummed again when serialized
+    _checked_header.reset();
+    if (header_result == ParseResult::NoError and _header.hlen * 4 == IPv4Header::LENGTH) {
+        _checked_header = _header;
+    }
+
     if (_payload.size() != _header.payload_length()) {
         return ParseResult::PacketTooShort;
     }
@@ -21,21 +67,37 @@ ParseResult IPv4Datagram::parse(const Buffer buffer) {
 }
 
 BufferList IPv4Datagram::serialize() const {
+    BufferList ret = _payload;
+    ret.prepend(serialize_header());
+    return ret;
+}
+
+//! \details The header is written into a block from the PacketBuffer pool, so in steady state this allocates nothing
+Buffer IPv4Datagram::serialize_header() const {
     if (_payload.size() != _header.payload_length()) {
         throw runtime_error("IPv4Datagram::serialize: payload is wrong size");
     }
 
+    const size_t header_len = 4 * _header.hlen;
+    PacketBuffer pkt{header_len};
+    uint8_t *const out = pkt.append(header_len);
+    fill(out, out + header_len, 0);  // options are not kept, and the block may have been used before
+
+    if (_header_cksum_valid()) {
+        _header.serialize_into(out);
+        return Buffer{move(pkt)};
+    }
+
     IPv4Header header_out = _header;
     header_out.cksum = 0;
-    const string header_zero_checksum = header_out.serialize();
+    header_out.serialize_into(out);
 
-    // calculate checksum -- taken over header only
+    // calculate checksum -- taken over header only -- and fill it in (bytes 10 and 11)
     InternetChecksum check;
-    check.add(header_zero_checksum);
-    header_out.cksum = check.value();
+    check.add(pkt.str());
+    const uint16_t cksum = check.value();
+    out[10] = cksum >> 8;
+    out[11] = cksum & 0xff;
 
-    BufferList ret;
-    ret.append(header_out.serialize());
-    ret.append(_payload);
-    return ret;
+    return Buffer{move(pkt)};
 }
@@ -4,27 +4,51 @@
 #include "buffer.hh"
 #include "ipv4_header.hh"
 
+#include <cstdint>
+#include <optional>
+
 //! \brief [IPv4](\ref rfc::rfc791) Internet datagram
 class IPv4Datagram {
   private:
     IPv4Header _header{};
     BufferList _payload{};
 
+    //! The header as it was when `cksum` was last known to be correct (e.g. as parsed). serialize() reuses
+    //! `_header.cksum` as long as no field has changed since, however the header was accessed.
+    std::optional<IPv4Header> _checked_header{};
+
+    //! Whether `_header.cksum` is correct for `_header`
+    bool _header_cksum_valid() const;
+
   public:
     //! \brief Parse the segment from a string
     ParseResult parse(const Buffer buffer);
 
     //! \brief Serialize the segment to a string
+    //! \note The header checksum is recomputed unless it is known to be correct
     BufferList serialize() const;
 
+    //! \brief Serialize only the header, for callers that put the payload after it themselves
+    //! \note The header checksum is recomputed unless it is known to be correct
+    Buffer serialize_header() const;
+
     //! \name Accessors
     //!@{
     const IPv4Header &header() const { return _header; }
+
+    //! \note If a field changes through this reference, serialize() notices and recomputes the checksum
     IPv4Header &header() { return _header; }
 
     const BufferList &payload() const { return _payload; }
     BufferList &payload() { return _payload; }
     //!@}
+
+    //! \name Change one header field, adjusting the checksum in place if it is correct (as for a forwarded datagram)
+    //!@{
+    void set_ttl(const uint8_t ttl);
+    void set_src(const uint32_t src);
+    void set_dst(const uint32_t dst);
+    //!@}
 };
 
 using InternetDatagram = IPv4Datagram;
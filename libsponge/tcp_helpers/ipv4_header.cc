@@ -2,6 +2,7 @@
 
 #include "util.hh"
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <iomanip>
 #include <sstream>
@@ -76,6 +77,32 @@ ParseResult IPv4Header::parse(NetParser &p) {
 
 //! Serialize the IPv4Header to a string (does not recompute the checksum)
 string IPv4Header::serialize() const {
+    string ret(4 * hlen, 0);
+    serialize_into(reinterpret_cast<uint8_t *>(ret.data()));
+    return ret;
+}
+
+void IPv4Header::parse_from(const uint8_t *in) {
+    ver = in[0] >> 4;              // version
+    hlen = in[0] & 0x0f;           // header length
+    tos = in[1];                   // type of service
+    len = NetParser::u16(in + 2);  // length
+    id = NetParser::u16(in + 4);   // id
+
+    const uint16_t fo_val = NetParser::u16(in + 6);
+    df = static_cast<bool>(fo_val & 0x4000);  // don't fragment
+    mf = static_cast<bool>(fo_val & 0x2000);  // more fragments
+    offset = fo_val & 0x1fff;                 // offset
+
+    ttl = in[8];                      // ttl
+    proto = in[9];                    // proto
+    cksum = NetParser::u16(in + 10);  // checksum
+    src = NetParser::u32(in + 12);    // source address
+    dst = NetParser::u32(in + 16);    // destination address
+}
+
+//! Serialize the IPv4Header into a buffer (does not recompute the checksum)
+void IPv4Header::serialize_into(uint8_t *out) const {
     // sanity checks
     if (ver != 4) {
         throw runtime_error("wrong IP version");
@@ -84,29 +111,62 @@ string IPv4Header::serialize() const {
         throw runtime_error("IP header too short");
     }
 
-    string ret;
-    ret.reserve(4 * hlen);
-
     const uint8_t first_byte = (ver << 4) | (hlen & 0xf);
-    NetUnparser::u8(ret, first_byte);  // version and header length
-    NetUnparser::u8(ret, tos);         // type of service
-    NetUnparser::u16(ret, len);        // length
-    NetUnparser::u16(ret, id);         // id
+    out = NetUnparser::u8(out, first_byte);  // version and header length
+    out = NetUnparser::u8(out, tos);         // type of service
+    out = NetUnparser::u16(out, len);        // length
+    out = NetUnparser::u16(out, id);         // id
 
     const uint16_t fo_val = (df ? 0x4000 : 0) | (mf ? 0x2000 : 0) | (offset & 0x1fff);
-    NetUnparser::u16(ret, fo_val);  // flags and offset
+    out = NetUnparser::u16(out, fo_val);  // flags and offset
 
-    NetUnparser::u8(ret, ttl);    // time to live
-    NetUnparser::u8(ret, proto);  // protocol number
+    out = NetUnparser::u8(out, ttl);    // time to live
+    out = NetUnparser::u8(out, proto);  // protocol number
 
-    NetUnparser::u16(ret, cksum);  // checksum
+    out = NetUnparser::u16(out, cksum);  // checksum
 
-    NetUnparser::u32(ret, src);  // src address
-    NetUnparser::u32(ret, dst);  // dst address
+    out = NetUnparser::u32(out, src);  // src address
+    out = NetUnparser::u32(out, dst);  // dst address
 
-    ret.resize(4 * hlen);  // expand header to advertised size
+    fill(out, out + 4 * hlen - IPv4Header::LENGTH, 0);  // expand header to advertised size
+}
 
-    return ret;
+//! \param[in,out] pkt holds the payload on entry, and the whole datagram on return
+void IPv4Header::prepend_to(PacketBuffer &pkt) const {
+    if (pkt.size() != payload_length()) {
+        throw runtime_error("IPv4Header::prepend_to: payload is wrong size");
+    }
+
+    const size_t header_len = 4 * hlen;
+    uint8_t *const out = pkt.prepend(header_len);
+    IPv4Header header_out = *this;
+    header_out.cksum = 0;
+    header_out.serialize_into(out);
+
+    // calculate checksum -- taken over header only -- and fill it in (bytes 10 and 11)
+    InternetChecksum check;
+    check.add(pkt.str().substr(0, header_len));
+    const uint16_t cksum_out = check.value();
+    out[10] = cksum_out >> 8;
+    out[11] = cksum_out & 0xff;
+}
+
+//! \details TTL is the high byte of the 16-bit word it shares with the protocol number
+void IPv4Header::set_ttl(const uint8_t new_ttl) {
+    cksum = InternetChecksum::adjust(cksum, (ttl << 8) | proto, (new_ttl << 8) | proto);
+    ttl = new_ttl;
+}
+
+void IPv4Header::set_src(const uint32_t new_src) {
+    cksum = InternetChecksum::adjust(cksum, src >> 16, new_src >> 16);
+    cksum = InternetChecksum::adjust(cksum, src & 0xffff, new_src & 0xffff);
+    src = new_src;
+}
+
+void IPv4Header::set_dst(const uint32_t new_dst) {
+    cksum = InternetChecksum::adjust(cksum, dst >> 16, new_dst >> 16);
+    cksum = InternetChecksum::adjust(cksum, dst & 0xffff, new_dst & 0xffff);
+    dst = new_dst;
 }
 
 uint16_t IPv4Header::payload_length() const { return len - 4 * hlen; }
@@ -1,6 +1,7 @@
 #ifndef SPONGE_LIBSPONGE_IPV4_HEADER_HH
 #define SPONGE_LIBSPONGE_IPV4_HEADER_HH
 
+#include "packet_buffer.hh"
 #include "parser.hh"
 
 //! \brief [IPv4](\ref rfc::rfc791) Internet datagram header
@@ -46,12 +47,32 @@ struct IPv4Header {
     uint32_t dst = 0;           //!< dst address
     //!@}
 
+    //! \name Change one field and adjust `cksum` to match ([RFC 1624](\ref rfc::rfc1624))
+    //! \note `cksum` stays correct only if it was correct before, e.g. because the header was parsed
+    //!@{
+    void set_ttl(const uint8_t new_ttl);
+    void set_src(const uint32_t new_src);
+    void set_dst(const uint32_t new_dst);
+    //!@}
+
     //! Parse the IP fields from the provided NetParser
     ParseResult parse(NetParser &p);
 
+    //! \brief Read the IP fields from the LENGTH bytes at `in`, which the caller has checked are there
+    //! \note Nothing is validated, and options are not skipped
+    void parse_from(const uint8_t *in);
+
     //! Serialize the IP fields
     std::string serialize() const;
 
+    //! \brief Serialize the IP fields into the `4 * hlen` bytes at `out` (LENGTH without options), without allocating
+    //! \note Options are written as zeros, as by serialize()
+    void serialize_into(uint8_t *out) const;
+
+    //! \brief Serialize the IP fields in front of the datagram's payload, in the headroom of `pkt`
+    //! \note The checksum is computed, as by IPv4Datagram::serialize(); `len` must match the payload
+    void prepend_to(PacketBuffer &pkt) const;
+
     //! Length of the payload
     uint16_t payload_length() const;
 
@@ -2,13 +2,17 @@
 #define SPONGE_LIBSPONGE_LOSSY_FD_ADAPTER_HH
 
 #include "file_descriptor.hh"
+#include "io_uring.hh"
 #include "tcp_config.hh"
 #include "tcp_segment.hh"
 #include "util.hh"
 
+#include <algorithm>
 #include <optional>
+#include <queue>
 #include <random>
 #include <utility>
+#include <vector>
 
 //! An adapter class that adds random dropping behavior to an FD adapter
 template <typename AdapterT>
@@ -56,6 +60,43 @@ class LossyFdAdapter {
         return _adapter.write(seg);
     }
 
+    //! \brief Queue a write on `ring` with the underlying AdapterT instance, potentially dropping the datagram
+    //! \param[in] seg is the packet to either write or drop
+    //! \param[in] ring is where the write is queued
+    void write(TCPSegment &seg, IOUring &ring) {
+        if (_should_drop(true)) {
+            return;
+        }
+        return _adapter.write(seg, ring);
+    }
+
+    //! \brief Read a batch with the underlying AdapterT instance (if it reads batches), potentially dropping
+    //! some of the segments
+    //! \param[out] segments is replaced by the segments read and not dropped
+    template <typename A = AdapterT>
+    auto read_batch(std::vector<TCPSegment> &segments) -> decltype(std::declval<A &>().read_batch(segments)) {
+        _adapter.read_batch(segments);
+        segments.erase(std::remove_if(segments.begin(), segments.end(), [&](const TCPSegment &) {
+                           return _should_drop(false);
+                       }),
+                       segments.end());
+    }
+
+    //! \brief Write a batch with the underlying AdapterT instance (if it writes batches), potentially dropping
+    //! some of the segments
+    //! \param[in,out] segments is the segments to either write or drop; it is empty on return
+    template <typename A = AdapterT>
+    auto write_batch(std::queue<TCPSegment> &segments) -> decltype(std::declval<A &>().write_batch(segments)) {
+        // rotate the queue once, keeping only the segments that survive
+        for (size_t n = segments.size(); n > 0; n--) {
+            if (not _should_drop(true)) {
+                segments.push(std::move(segments.front()));
+            }
+            segments.pop();
+        }
+        _adapter.write_batch(segments);
+    }
+
     //! \name
     //! Passthrough functions to the underlying AdapterT instance
 
@@ -0,0 +1,98 @@
+#include "tcp_frame.hh"
+
+#include "ethernet_frame.hh"
+#include "ipv4_datagram.hh"
+#include "parser.hh"
+#include "util.hh"
+
+using namespace std;
+
+//! Does the 20-byte IPv4 header at `in` have the right checksum, i.e. do its 16-bit words add up to 0xffff?
+static bool ip_header_cksum_ok(const uint8_t *in) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < IPv4Header::LENGTH; i += 2) {
+        sum += NetParser::u16(in + i);
+    }
+    while (sum > 0xffff) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return sum == 0xffff;
+}
+
+ParseResult TCPFrame::parse(const Buffer &buffer, const Checksums checksums) {
+    if (_parse_fast(buffer, EthernetHeader::LENGTH, checksums)) {
+        return ParseResult::NoError;
+    }
+
+    EthernetFrame frame;
+    if (const auto result = frame.parse(buffer); result != ParseResult::NoError) {
+        return result;
+    }
+    _ethernet_header = frame.header();
+    if (_ethernet_header.type != EthernetHeader::TYPE_IPv4) {
+        return ParseResult::Unsupported;
+    }
+    return _parse_layered(frame.payload(), checksums);
+}
+
+ParseResult TCPFrame::parse_ipv4(const Buffer &buffer, const Checksums checksums) {
+    if (_parse_fast(buffer, 0, checksums)) {
+        return ParseResult::NoError;
+    }
+    return _parse_layered(buffer, checksums);
+}
+
+//! \details Checks everything the layered parsers check, reading the headers once and the segment once:
+//! a correct IPv4 header adds up to 0xffff, which is zero in ones' complement arithmetic, so it can
+//! be left in the sum that checks the TCP segment, and one pass over the whole datagram does.
+bool TCPFrame::_parse_fast(const Buffer &buffer, const size_t ip_offset, const Checksums checksums) {
+    const size_t tcp_offset = ip_offset + IPv4Header::LENGTH;
+    const size_t payload_offset = tcp_offset + TCPHeader::LENGTH;
+
+    const string_view frame = buffer.str();
+    if (frame.size() < payload_offset) {
+        return false;
+    }
+    const uint8_t *const in = reinterpret_cast<const uint8_t *>(frame.data());
+    const uint8_t *const ip = in + ip_offset;
+
+    // IPv4 with a 20-byte header and exactly the frame's payload, carrying TCP with a 20-byte header
+    if ((ip_offset > 0 and NetParser::u16(in + 12) != EthernetHeader::TYPE_IPv4) or ip[0] != 0x45 or
+        NetParser::u16(ip + 2) != frame.size() - ip_offset or ip[9] != IPv4Header::PROTO_TCP or
+        size_t(in[tcp_offset + 12] >> 4) != TCPHeader::LENGTH / 4) {
+        return false;
+    }
+
+    _ip_header.parse_from(ip);
+    if (checksums == Checksums::Verify) {
+        if (not ip_header_cksum_ok(ip)) {
+            return false;
+        }
+        InternetChecksum check(_ip_header.pseudo_cksum());
+        check.add(frame.substr(ip_offset));
+        if (check.value()) {
+            return false;
+        }
+    }
+
+    if (ip_offset > 0) {
+        _ethernet_header.parse_from(in);
+    }
+    _segment.header().parse_from(in + tcp_offset);
+    _segment.payload() = buffer;
+    _segment.payload().remove_prefix(payload_offset);
+    return true;
+}
+
+ParseResult TCPFrame::_parse_layered(const Buffer &datagram, const Checksums checksums) {
+    IPv4Datagram dgram;
+    if (const auto result = dgram.parse(datagram); result != ParseResult::NoError) {
+        return result;
+    }
+    _ip_header = dgram.header();
+    if (_ip_header.proto != IPv4Header::PROTO_TCP) {
+        return ParseResult::Unsupported;
+    }
+
+    return _segment.parse(dgram.payload(), _ip_header.pseudo_cksum(), checksums == Checksums::Verify);
+}
@@ -0,0 +1,59 @@
+#ifndef SPONGE_LIBSPONGE_TCP_FRAME_HH
+#define SPONGE_LIBSPONGE_TCP_FRAME_HH
+
+#include "buffer.hh"
+#include "ethernet_header.hh"
+#include "ipv4_header.hh"
+#include "tcp_segment.hh"
+
+#include <cstddef>
+
+//! \brief A TCP segment in an IPv4 datagram (in an Ethernet frame, or straight from a TUN device), parsed in one pass
+
+//! Receiving a segment layer by layer means an EthernetFrame::parse(), an IPv4Datagram::parse()
+//! and a TCPSegment::parse(), each with its own NetParser and copy of the Buffer. When neither
+//! the IPv4 nor the TCP header has options, every field is at a fixed offset, so parse() reads
+//! all the headers straight out of the frame instead, and copies the Buffer once, for the payload.
+//! Anything else (options, or any error) is handed to the layered parsers, so the result is
+//! always the one they would give.
+class TCPFrame {
+  public:
+    //! How the IPv4 header and TCP checksums are treated
+    enum class Checksums {
+        Verify,  //!< check them
+        Trusted  //!< don't: the device has already checked them (e.g. checksum offload on a TUN device)
+    };
+
+  private:
+    EthernetHeader _ethernet_header{};
+    IPv4Header _ip_header{};
+    TCPSegment _segment{};
+
+    //! \brief Fixed-offset parse of a datagram, starting at `ip_offset`, without IPv4 or TCP options
+    //! \returns false if the datagram is not of that form, or is invalid
+    bool _parse_fast(const Buffer &buffer, const size_t ip_offset, const Checksums checksums);
+
+    //! Parse with IPv4Datagram::parse() and TCPSegment::parse()
+    ParseResult _parse_layered(const Buffer &datagram, const Checksums checksums);
+
+  public:
+    //! \brief Parse an Ethernet frame from a string
+    //! \returns the first error the layered parsers would give, or ParseResult::Unsupported if the
+    //! frame doesn't carry IPv4 or the datagram doesn't carry TCP
+    ParseResult parse(const Buffer &buffer, const Checksums checksums = Checksums::Verify);
+
+    //! \brief Parse an IPv4 datagram without a link-layer header (e.g. from a TUN device), like parse()
+    //! \note ethernet_header() is left as it was
+    ParseResult parse_ipv4(const Buffer &buffer, const Checksums checksums = Checksums::Verify);
+
+    //! \name Accessors
+    //!@{
+    const EthernetHeader &ethernet_header() const { return _ethernet_header; }
+    const IPv4Header &ip_header() const { return _ip_header; }
+
+    const TCPSegment &segment() const { return _segment; }
+    TCPSegment &segment() { return _segment; }
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_TCP_FRAME_HH
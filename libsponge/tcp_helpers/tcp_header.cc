@@ -1,5 +1,6 @@
 #include "tcp_header.hh"
 
+#include <algorithm>
 #include <sstream>
 
 using namespace std;
@@ -47,34 +48,57 @@ ParseResult TCPHeader::parse(NetParser &p) {
     return ParseResult::NoError;
 }
 
+//! Fill in the fields from the TCPHeader::LENGTH bytes at `in`, which the caller has checked are there
+void TCPHeader::parse_from(const uint8_t *in) {
+    sport = NetParser::u16(in);                     // source port
+    dport = NetParser::u16(in + 2);                 // destination port
+    seqno = WrappingInt32{NetParser::u32(in + 4)};  // sequence number
+    ackno = WrappingInt32{NetParser::u32(in + 8)};  // ack number
+    doff = in[12] >> 4;                             // data offset
+
+    const uint8_t fl_b = in[13];  // byte including flags
+    urg = static_cast<bool>(fl_b & 0b0010'0000);
+    ack = static_cast<bool>(fl_b & 0b0001'0000);
+    psh = static_cast<bool>(fl_b & 0b0000'1000);
+    rst = static_cast<bool>(fl_b & 0b0000'0100);
+    syn = static_cast<bool>(fl_b & 0b0000'0010);
+    fin = static_cast<bool>(fl_b & 0b0000'0001);
+
+    win = NetParser::u16(in + 14);    // window size
+    cksum = NetParser::u16(in + 16);  // checksum
+    uptr = NetParser::u16(in + 18);   // urgent pointer
+}
+
 //! Serialize the TCPHeader to a string (does not recompute the checksum)
 string TCPHeader::serialize() const {
+    string ret(4 * doff, 0);
+    serialize_into(reinterpret_cast<uint8_t *>(ret.data()));
+    return ret;
+}
+
+//! Serialize the TCPHeader into a buffer (does not recompute the checksum)
+void TCPHeader::serialize_into(uint8_t *out) const {
     // sanity check
     if (doff < 5) {
         throw runtime_error("TCP header too short");
     }
 
-    string ret;
-    ret.reserve(4 * doff);
-
-    NetUnparser::u16(ret, sport);              // source port
-    NetUnparser::u16(ret, dport);              // destination port
-    NetUnparser::u32(ret, seqno.raw_value());  // sequence number
-    NetUnparser::u32(ret, ackno.raw_value());  // ack number
-    NetUnparser::u8(ret, doff << 4);           // data offset
+    out = NetUnparser::u16(out, sport);              // source port
+    out = NetUnparser::u16(out, dport);              // destination port
+    out = NetUnparser::u32(out, seqno.raw_value());  // sequence number
+    out = NetUnparser::u32(out, ackno.raw_value());  // ack number
+    out = NetUnparser::u8(out, doff << 4);           // data offset
 
     const uint8_t fl_b = (urg ? 0b0010'0000 : 0) | (ack ? 0b0001'0000 : 0) | (psh ? 0b0000'1000 : 0) |
                          (rst ? 0b0000'0100 : 0) | (syn ? 0b0000'0010 : 0) | (fin ? 0b0000'0001 : 0);
-    NetUnparser::u8(ret, fl_b);  // flags
-    NetUnparser::u16(ret, win);  // window size
-
-    NetUnparser::u16(ret, cksum);  // checksum
+    out = NetUnparser::u8(out, fl_b);  // flags
+    out = NetUnparser::u16(out, win);  // window size
 
-    NetUnparser::u16(ret, uptr);  // urgent pointer
+    out = NetUnparser::u16(out, cksum);  // checksum
 
-    ret.resize(4 * doff);  // expand header to advertised size
+    out = NetUnparser::u16(out, uptr);  // urgent pointer
 
-    return ret;
+    fill(out, out + 4 * doff - TCPHeader::LENGTH, 0);  // expand header to advertised size
 }
 
 //! \returns A string with the header's contents
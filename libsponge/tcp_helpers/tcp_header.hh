@@ -53,9 +53,17 @@ struct TCPHeader {
     //! Parse the TCP fields from the provided NetParser
     ParseResult parse(NetParser &p);
 
+    //! \brief Read the TCP fields from the LENGTH bytes at `in`, which the caller has checked are there
+    //! \note Nothing is validated, and options are not skipped
+    void parse_from(const uint8_t *in);
+
     //! Serialize the TCP fields
     std::string serialize() const;
 
+    //! \brief Serialize the TCP fields into the `4 * doff` bytes at `out` (LENGTH without options), without allocating
+    //! \note Options are written as zeros, as by serialize()
+    void serialize_into(uint8_t *out) const;
+
     //! Return a string containing a header in human-readable format
     std::string to_string() const;
 
@@ -24,28 +24,46 @@ using namespace std;
 //! from the TCP header; it uses this information to filter future reads.
 //! \returns a std::optional<TCPSegment> that is empty if the segment was invalid or unrelated
 optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram &ip_dgram) {
-    // is the IPv4 datagram for us?
-    // Note: it's valid to bind to address "0" (INADDR_ANY) and reply from actual address contacted
-    if (not listening() and (ip_dgram.header().dst != config().source.ipv4_numeric())) {
+    if (not _datagram_for_us(ip_dgram.header())) {
         return {};
     }
 
-    // is the IPv4 datagram from our peer?
-    if (not listening() and (ip_dgram.header().src != config().destination.ipv4_numeric())) {
+    // is the payload a valid TCP segment?
+    TCPSegment tcp_seg;
+    if (ParseResult::NoError != tcp_seg.parse(ip_dgram.payload(), ip_dgram.header().pseudo_cksum())) {
         return {};
     }
 
-    // does the IPv4 datagram claim that its payload is a TCP segment?
-    if (ip_dgram.header().proto != IPv4Header::PROTO_TCP) {
+    return _segment_for_us(ip_dgram.header(), move(tcp_seg));
+}
+
+//! \param[in] ip_header the header of the IPv4 datagram that carried `tcp_seg`
+//! \param[in] tcp_seg a segment that has already been parsed, e.g. by TCPFrame::parse()
+//! \returns a std::optional<TCPSegment> that is empty if the segment was unrelated
+optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const IPv4Header &ip_header, TCPSegment &&tcp_seg) {
+    if (not _datagram_for_us(ip_header)) {
         return {};
     }
+    return _segment_for_us(ip_header, move(tcp_seg));
+}
 
-    // is the payload a valid TCP segment?
-    TCPSegment tcp_seg;
-    if (ParseResult::NoError != tcp_seg.parse(ip_dgram.payload(), ip_dgram.header().pseudo_cksum())) {
-        return {};
+bool TCPOverIPv4Adapter::_datagram_for_us(const IPv4Header &ip_header) const {
+    // is the IPv4 datagram for us?
+    // Note: it's valid to bind to address "0" (INADDR_ANY) and reply from actual address contacted
+    if (not listening() and (ip_header.dst != config().source.ipv4_numeric())) {
+        return false;
     }
 
+    // is the IPv4 datagram from our peer?
+    if (not listening() and (ip_header.src != config().destination.ipv4_numeric())) {
+        return false;
+    }
+
+    // does the IPv4 datagram claim that its payload is a TCP segment?
+    return ip_header.proto == IPv4Header::PROTO_TCP;
+}
+
+optional<TCPSegment> TCPOverIPv4Adapter::_segment_for_us(const IPv4Header &ip_header, TCPSegment &&tcp_seg) {
     // is the TCP segment for us?
     if (tcp_seg.header().dport != config().source.port()) {
         return {};
@@ -54,8 +72,8 @@ optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram
     // should we target this source addr/port (and use its destination addr as our source) in reply?
     if (listening()) {
         if (tcp_seg.header().syn and not tcp_seg.header().rst) {
-            config_mutable().source = {inet_ntoa({htobe32(ip_dgram.header().dst)}), config().source.port()};
-            config_mutable().destination = {inet_ntoa({htobe32(ip_dgram.header().src)}), tcp_seg.header().sport};
+            config_mutable().source = {inet_ntoa({htobe32(ip_header.dst)}), config().source.port()};
+            config_mutable().destination = {inet_ntoa({htobe32(ip_header.src)}), tcp_seg.header().sport};
             set_listening(false);
         } else {
             return {};
@@ -67,24 +85,40 @@ optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram
         return {};
     }
 
-    return tcp_seg;
+    return move(tcp_seg);
 }
 
-//! Takes a TCP segment, sets port numbers as necessary, and wraps it in an IPv4 datagram
-//! \param[in] seg is the TCP segment to convert
-InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip(TCPSegment &seg) {
+IPv4Header TCPOverIPv4Adapter::_address_tcp_in_ip(TCPSegment &seg) {
     // set the port numbers in the TCP segment
     seg.header().sport = config().source.port();
     seg.header().dport = config().destination.port();
 
-    // create an Internet Datagram and set its addresses and length
+    // set the addresses and length of the Internet Datagram
+    IPv4Header ip_header;
+    ip_header.src = config().source.ipv4_numeric();
+    ip_header.dst = config().destination.ipv4_numeric();
+    ip_header.len = ip_header.hlen * 4 + seg.header().doff * 4 + seg.payload().size();
+    return ip_header;
+}
+
+//! Takes a TCP segment, sets port numbers as necessary, and wraps it in an IPv4 datagram
+//! \param[in] seg is the TCP segment to convert
+InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip(TCPSegment &seg) {
+    // create an Internet Datagram
     InternetDatagram ip_dgram;
-    ip_dgram.header().src = config().source.ipv4_numeric();
-    ip_dgram.header().dst = config().destination.ipv4_numeric();
-    ip_dgram.header().len = ip_dgram.header().hlen * 4 + seg.header().doff * 4 + seg.payload().size();
+    ip_dgram.header() = _address_tcp_in_ip(seg);
 
     // set payload, calculating TCP checksum using information from IP header
     ip_dgram.payload() = seg.serialize(ip_dgram.header().pseudo_cksum());
 
     return ip_dgram;
 }
+
+//! \details The TCP and IP headers are written in place in front of the payload, so the datagram costs no
+//! allocation once this thread's PacketBuffer pool is warm.
+PacketBuffer TCPOverIPv4Adapter::wrap_tcp_in_ip_packet(TCPSegment &seg) {
+    const IPv4Header ip_header = _address_tcp_in_ip(seg);
+    PacketBuffer pkt = seg.serialize_packet(ip_header.pseudo_cksum());
+    ip_header.prepend_to(pkt);
+    return pkt;
+}
@@ -4,16 +4,33 @@
 #include "buffer.hh"
 #include "fd_adapter.hh"
 #include "ipv4_datagram.hh"
+#include "packet_buffer.hh"
 #include "tcp_segment.hh"
 
 #include <optional>
 
 //! \brief A converter from TCP segments to serialized IPv4 datagrams
 class TCPOverIPv4Adapter : public FdAdapterBase {
+  private:
+    //! Address the segment to the peer, and make the header of an IPv4 datagram to carry it
+    IPv4Header _address_tcp_in_ip(TCPSegment &seg);
+
+    //! Is the datagram a TCP segment for this connection (as far as its IPv4 header tells)?
+    bool _datagram_for_us(const IPv4Header &ip_header) const;
+
+    //! Check the segment's ports (or, when listening, take them from a SYN)
+    std::optional<TCPSegment> _segment_for_us(const IPv4Header &ip_header, TCPSegment &&tcp_seg);
+
   public:
     std::optional<TCPSegment> unwrap_tcp_in_ip(const InternetDatagram &ip_dgram);
 
+    //! \brief Like unwrap_tcp_in_ip(const InternetDatagram &), for a segment that has already been parsed
+    std::optional<TCPSegment> unwrap_tcp_in_ip(const IPv4Header &ip_header, TCPSegment &&tcp_seg);
+
     InternetDatagram wrap_tcp_in_ip(TCPSegment &seg);
+
+    //! \brief Like wrap_tcp_in_ip(), but serialized into a pooled PacketBuffer, with headroom left for a link layer
+    PacketBuffer wrap_tcp_in_ip_packet(TCPSegment &seg);
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_OVER_IP_HH
@@ -3,17 +3,21 @@
 #include "parser.hh"
 #include "util.hh"
 
+#include <string>
 #include <variant>
 
 using namespace std;
 
 //! \param[in] buffer string/Buffer to be parsed
 //! \param[in] datagram_layer_checksum pseudo-checksum from the lower-layer protocol
-ParseResult TCPSegment::parse(const Buffer buffer, const uint32_t datagram_layer_checksum) {
-    InternetChecksum check(datagram_layer_checksum);
-    check.add(buffer);
-    if (check.value()) {
-        return ParseResult::BadChecksum;
+//! \param[in] verify_checksum whether to check the segment's checksum
+ParseResult TCPSegment::parse(const Buffer buffer, const uint32_t datagram_layer_checksum, const bool verify_checksum) {
+    if (verify_checksum) {
+        InternetChecksum check(datagram_layer_checksum);
+        check.add(buffer);
+        if (check.value()) {
+            return ParseResult::BadChecksum;
+        }
     }
 
     NetParser p{buffer};
@@ -30,16 +34,40 @@ size_t TCPSegment::length_in_sequence_space() const {
 BufferList TCPSegment::serialize(const uint32_t datagram_layer_checksum) const {
     TCPHeader header_out = _header;
     header_out.cksum = 0;
+    string header_bytes = header_out.serialize();
 
-    // calculate checksum -- taken over entire segment
+    // calculate checksum -- taken over entire segment -- and fill it in (bytes 16 and 17)
     InternetChecksum check(datagram_layer_checksum);
-    check.add(header_out.serialize());
+    check.add(header_bytes);
     check.add(_payload);
-    header_out.cksum = check.value();
+    const uint16_t cksum = check.value();
+    header_bytes[16] = cksum >> 8;
+    header_bytes[17] = cksum & 0xff;
 
-    BufferList ret;
-    ret.append(header_out.serialize());
-    ret.append(_payload);
+    BufferList ret = _payload;
+    ret.prepend(move(header_bytes));
 
     return ret;
 }
+
+//! \param[in] datagram_layer_checksum pseudo-checksum from the lower-layer protocol
+//! \details The payload is copied into the packet once; the header is written in place in front of it.
+PacketBuffer TCPSegment::serialize_packet(const uint32_t datagram_layer_checksum) const {
+    const size_t header_len = 4 * _header.doff;
+    PacketBuffer pkt(_payload.size(), PacketBuffer::HEADROOM - TCPHeader::LENGTH + header_len);
+    pkt.append(_payload);
+
+    uint8_t *const header_bytes = pkt.prepend(header_len);
+    TCPHeader header_out = _header;
+    header_out.cksum = 0;
+    header_out.serialize_into(header_bytes);
+
+    // calculate checksum -- taken over entire segment -- and fill it in (bytes 16 and 17)
+    InternetChecksum check(datagram_layer_checksum);
+    check.add(pkt.str());
+    const uint16_t cksum = check.value();
+    header_bytes[16] = cksum >> 8;
+    header_bytes[17] = cksum & 0xff;
+
+    return pkt;
+}
@@ -2,6 +2,7 @@
 #define SPONGE_LIBSPONGE_TCP_SEGMENT_HH
 
 #include "buffer.hh"
+#include "packet_buffer.hh"
 #include "tcp_header.hh"
 
 #include <cstdint>
@@ -14,11 +15,17 @@ class TCPSegment {
 
   public:
     //! \brief Parse the segment from a string
-    ParseResult parse(const Buffer buffer, const uint32_t datagram_layer_checksum = 0);
+    //! \note `verify_checksum` is false when something else (e.g. the kernel) has already checked the segment
+    ParseResult parse(const Buffer buffer,
+                      const uint32_t datagram_layer_checksum = 0,
+                      const bool verify_checksum = true);
 
     //! \brief Serialize the segment to a string
     BufferList serialize(const uint32_t datagram_layer_checksum = 0) const;
 
+    //! \brief Serialize the segment to a pooled PacketBuffer, leaving headroom for the lower layers' headers
+    PacketBuffer serialize_packet(const uint32_t datagram_layer_checksum = 0) const;
+
     //! \name Accessors
     //!@{
     const TCPHeader &header() const { return _header; }
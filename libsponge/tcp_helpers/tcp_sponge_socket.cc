@@ -5,38 +5,95 @@
 #include "tun.hh"
 #include "util.hh"
 
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <exception>
 #include <iostream>
+#include <queue>
 #include <stdexcept>
 #include <string>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
+#include <type_traits>
 #include <unistd.h>
 #include <utility>
 
 using namespace std;
 
-static constexpr size_t TCP_TICK_MS = 10;
+//! While TCP has segments in flight or lingers in TIME_WAIT, it is ticked this often
+static constexpr auto TCP_TICK = chrono::milliseconds{10};
+
+//! Otherwise no TCP timer is running, and TCP is ticked only this often
+static constexpr auto TCP_IDLE_TICK = chrono::milliseconds{1000};
+
+//! Whether AdaptT reads and writes whole batches of segments, with one system call each
+//! (like TCPOverUDPSocketAdapter::read_batch and TCPOverUDPSocketAdapter::write_batch)
+template <typename AdaptT, typename = void>
+struct IsBatchedAdapter : false_type {};
+
+template <typename AdaptT>
+struct IsBatchedAdapter<AdaptT, void_t<decltype(declval<AdaptT &>().write_batch(declval<queue<TCPSegment> &>()))>>
+    : true_type {};
 
 //! \param[in] condition is a function returning true if loop should continue
 template <typename AdaptT>
 void TCPSpongeSocket<AdaptT>::_tcp_loop(const function<bool()> &condition) {
-    auto base_time = timestamp_ms();
+    _last_tick = EventLoop::Clock::now();
     while (condition()) {
-        auto ret = _eventloop.wait_next_event(TCP_TICK_MS);
+        _schedule_tick();
+        auto ret = _eventloop.wait_next_event(-1);
         if (ret == EventLoop::Result::Exit or _abort) {
             break;
         }
+    }
+
+    if (_tick_timer) {
+        _eventloop.cancel_timer(_tick_timer.value());
+        _tick_timer.reset();
+    }
+}
 
-        if (_tcp.value().active()) {
-            const auto next_time = timestamp_ms();
-            _tcp.value().tick(next_time - base_time);
-            _datagram_adapter.tick(next_time - base_time);
-            base_time = next_time;
+//! Instead of waking every TCP_TICK, the event loop sleeps until TCP next needs to know the time.
+//! The lab's TCPConnection doesn't say when its retransmission or linger timer expires, so while
+//! either could be running TCP is ticked every TCP_TICK, and otherwise every TCP_IDLE_TICK.
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::_schedule_tick() {
+    if (not _tcp.value().active()) {
+        if (_tick_timer) {
+            _eventloop.cancel_timer(_tick_timer.value());
+            _tick_timer.reset();
         }
+        return;
+    }
+
+    const bool timing = _tcp->bytes_in_flight() > 0 or
+                        (_tcp->inbound_stream().input_ended() and _tcp->state() == TCPState::State::TIME_WAIT);
+    const auto due = _last_tick + (timing ? TCP_TICK : TCP_IDLE_TICK);
+    if (not _tick_timer) {
+        _tick_timer = _eventloop.add_timer(due, [&] {
+            _tick_timer.reset();
+            _tick();
+        });
+    } else if (due < _tick_due) {
+        _eventloop.rearm_timer(_tick_timer.value(), due);
+    } else {
+        return;
+    }
+    _tick_due = due;
+}
+
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::_tick() {
+    if (not _tcp.value().active()) {
+        return;
     }
+    const auto elapsed = chrono::duration_cast<chrono::milliseconds>(EventLoop::Clock::now() - _last_tick);
+    _tcp.value().tick(elapsed.count());
+    _datagram_adapter.tick(elapsed.count());
+    _last_tick += elapsed;  // the fraction of a millisecond left over counts towards the next tick
 }
 
 //! \param[in] data_socket_pair is a pair of connected AF_UNIX SOCK_STREAM sockets
@@ -46,13 +103,23 @@ TCPSpongeSocket<AdaptT>::TCPSpongeSocket(pair<FileDescriptor, FileDescriptor> da
                                          AdaptT &&datagram_interface)
     : LocalStreamSocket(move(data_socket_pair.first))
     , _thread_data(move(data_socket_pair.second))
-    , _datagram_adapter(move(datagram_interface)) {
+    , _datagram_adapter(move(datagram_interface))
+    , _abort_event(SystemCall("eventfd", ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))) {
     _thread_data.set_blocking(false);
 }
 
 template <typename AdaptT>
 void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
     _tcp.emplace(config);
+    if (not IsBatchedAdapter<AdaptT>::value and IOUring::available()) {
+        // available() only proved that a one-entry ring could be set up once; this one can still fail
+        // (e.g. ENOMEM, or RLIMIT_MEMLOCK on older kernels), and then the segments are written directly
+        try {
+            _ring.emplace();
+        } catch (const exception &e) {
+            cerr << "DEBUG: io_uring not used: " << e.what() << "\n";
+        }
+    }
 
     // Set up the event loop
 
@@ -72,14 +139,38 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
     // 4) Outbound segment generated by TCP (needs to be
     //    given to underlying datagram socket)
 
+    // whether rule 3 has bytes, or the end of the stream, to hand to the owner
+    const auto inbound_pending = [this] {
+        return (not _tcp->inbound_stream().buffer_empty()) or
+               ((_tcp->inbound_stream().eof() or _tcp->inbound_stream().error()) and not _inbound_shutdown);
+    };
+
+    // rule 0: wake up as soon as the owner aborts, so _tcp_loop sees `_abort` and stops.
+    // It is interested only while another rule is, so the loop still exits when nothing is left to do.
+    _eventloop.add_rule(
+        _abort_event,
+        Direction::In,
+        [&] { _abort_event.read(sizeof(uint64_t)); },
+        [this, inbound_pending] { return _tcp->active() or inbound_pending() or not _tcp->segments_out().empty(); });
+
     // rule 1: read from filtered packet stream and dump into TCPConnection
     _eventloop.add_rule(
         _datagram_adapter,
         Direction::In,
         [&] {
-            auto seg = _datagram_adapter.read();
-            if (seg) {
-                _tcp->segment_received(move(seg.value()));
+            if constexpr (IsBatchedAdapter<AdaptT>::value) {
+                _datagram_adapter.read_batch(_segments_in);
+                for (auto &seg : _segments_in) {
+                    if (not _tcp->active()) {
+                        break;
+                    }
+                    _tcp->segment_received(move(seg));
+                }
+            } else {
+                auto seg = _datagram_adapter.read();
+                if (seg) {
+                    _tcp->segment_received(move(seg.value()));
+                }
             }
 
             // debugging output:
@@ -128,9 +219,9 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
             // Write from the inbound_stream into
             // the pipe, handling the possibility of a partial
             // write (i.e., only pop what was actually written).
+            // The views point into the stream's storage, so nothing is copied before writev().
             const size_t amount_to_write = min(size_t(65536), inbound.buffer_size());
-            const std::string buffer = inbound.peek_output(amount_to_write);
-            const auto bytes_written = _thread_data.write(move(buffer), false);
+            const auto bytes_written = _thread_data.write(inbound.peek_buffers(amount_to_write), false);
             inbound.pop_output(bytes_written);
 
             if (inbound.eof() or inbound.error()) {
@@ -145,19 +236,29 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
                 }
             }
         },
-        [&] {
-            return (not _tcp->inbound_stream().buffer_empty()) or
-                   ((_tcp->inbound_stream().eof() or _tcp->inbound_stream().error()) and not _inbound_shutdown);
-        });
+        inbound_pending);
 
     // rule 4: read outbound segments from TCPConnection and send as datagrams
     _eventloop.add_rule(
         _datagram_adapter,
         Direction::Out,
         [&] {
-            while (not _tcp->segments_out().empty()) {
-                _datagram_adapter.write(_tcp->segments_out().front());
-                _tcp->segments_out().pop();
+            if constexpr (IsBatchedAdapter<AdaptT>::value) {
+                _datagram_adapter.write_batch(_tcp->segments_out());
+            } else {
+                // a single segment is cheaper to write directly than through the ring
+                const bool batch = _ring and _tcp->segments_out().size() > 1;
+                while (not _tcp->segments_out().empty()) {
+                    if (batch) {
+                        _datagram_adapter.write(_tcp->segments_out().front(), *_ring);
+                    } else {
+                        _datagram_adapter.write(_tcp->segments_out().front());
+                    }
+                    _tcp->segments_out().pop();
+                }
+                if (batch) {
+                    _ring->submit();
+                }
             }
         },
         [&] { return not _tcp->segments_out().empty(); });
@@ -184,6 +285,8 @@ TCPSpongeSocket<AdaptT>::~TCPSpongeSocket() {
             cerr << "Warning: unclean shutdown of TCPSpongeSocket\n";
             // force the other side to exit
             _abort.store(true);
+            const uint64_t wake = 1;
+            SystemCall("write", ::write(_abort_event.fd_num(), &wake, sizeof(wake)));
             _tcp_thread.join();
         }
     } catch (const exception &e) {
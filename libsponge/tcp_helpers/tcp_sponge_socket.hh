@@ -5,6 +5,7 @@
 #include "eventloop.hh"
 #include "fd_adapter.hh"
 #include "file_descriptor.hh"
+#include "io_uring.hh"
 #include "network_interface.hh"
 #include "tcp_config.hh"
 #include "tcp_connection.hh"
@@ -37,9 +38,29 @@ class TCPSpongeSocket : public LocalStreamSocket {
     //! eventloop that handles all the events (new inbound datagram, new outbound bytes, new inbound bytes)
     EventLoop _eventloop{};
 
+    //! Batches a round of several outbound datagrams into one system call, where io_uring is available
+    std::optional<IOUring> _ring{};
+
+    //! Segments from the last batch read, for adapters that read batches
+    std::vector<TCPSegment> _segments_in{};
+
     //! Process events while specified condition is true
     void _tcp_loop(const std::function<bool()> &condition);
 
+    //! \name Telling the TCPConnection (and the adapter) how much time has passed
+    //!@{
+
+    EventLoop::Clock::time_point _last_tick{};        //!< When TCP was last ticked
+    std::optional<EventLoop::TimerId> _tick_timer{};  //!< Timer for the next tick, if armed
+    EventLoop::Clock::time_point _tick_due{};         //!< When _tick_timer is due
+
+    //! Arm _tick_timer for when TCP next needs to know the time, unless it is already due sooner
+    void _schedule_tick();
+
+    //! Tick TCP and the adapter with the time since _last_tick
+    void _tick();
+    //!@}
+
     //! Main loop of TCPConnection thread
     void _tcp_main();
 
@@ -51,6 +72,9 @@ class TCPSpongeSocket : public LocalStreamSocket {
 
     std::atomic_bool _abort{false};  //!< Flag used by the owner to force the TCPConnection thread to shut down
 
+    //! eventfd the owner signals after setting `_abort`, so the TCPConnection thread notices it at once
+    FileDescriptor _abort_event;
+
     bool _inbound_shutdown{false};  //!< Has TCPSpongeSocket shut down the incoming data to the owner?
 
     bool _outbound_shutdown{false};  //!< Has the owner shut down the outbound data to the TCP connection?
@@ -18,8 +18,25 @@ TCPOverIPv4OverEthernetAdapter::TCPOverIPv4OverEthernetAdapter(TapFD &&tap,
 
 optional<TCPSegment> TCPOverIPv4OverEthernetAdapter::read() {
     // Read Ethernet frame from the raw device
+    const Buffer raw_frame{_tap.read_packet().data};
+
+    // Most frames carry TCP segments: parse all three layers in one go, and skip the NetworkInterface
+    TCPFrame tcp_frame;
+    const ParseResult result = tcp_frame.parse(raw_frame);
+    if (result == ParseResult::NoError) {
+        const EthernetAddress &dst = tcp_frame.ethernet_header().dst;
+        if (dst != _interface.ethernet_address() and dst != ETHERNET_BROADCAST) {
+            return {};
+        }
+        return unwrap_tcp_in_ip(tcp_frame.ip_header(), move(tcp_frame.segment()));
+    }
+    if (result != ParseResult::Unsupported) {
+        return {};
+    }
+
+    // Anything else (e.g. ARP) is for the NetworkInterface
     EthernetFrame frame;
-    if (frame.parse(_tap.read()) != ParseResult::NoError) {
+    if (frame.parse(raw_frame) != ParseResult::NoError) {
         return {};
     }
 
@@ -48,6 +65,13 @@ void TCPOverIPv4OverEthernetAdapter::write(TCPSegment &seg) {
     send_pending();
 }
 
+//! \param[in] seg the TCPSegment to send
+//! \param[in] ring is where the frame (and any ARP request) is queued, until IOUring::submit
+void TCPOverIPv4OverEthernetAdapter::write(TCPSegment &seg, IOUring &ring) {
+    _interface.send_datagram(wrap_tcp_in_ip(seg), _next_hop);
+    send_pending(ring);
+}
+
 void TCPOverIPv4OverEthernetAdapter::send_pending() {
     while (not _interface.frames_out().empty()) {
         _tap.write(_interface.frames_out().front().serialize());
@@ -55,5 +79,12 @@ void TCPOverIPv4OverEthernetAdapter::send_pending() {
     }
 }
 
+void TCPOverIPv4OverEthernetAdapter::send_pending(IOUring &ring) {
+    while (not _interface.frames_out().empty()) {
+        ring.write(_tap, _interface.frames_out().front().serialize());
+        _interface.frames_out().pop();
+    }
+}
+
 //! Specialize LossyFdAdapter to TCPOverIPv4OverTunFdAdapter
 template class LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>;
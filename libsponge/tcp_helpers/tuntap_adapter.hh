@@ -3,6 +3,7 @@
 
 #include "ethernet_header.hh"
 #include "network_interface.hh"
+#include "tcp_frame.hh"
 #include "tun.hh"
 
 #include <optional>
@@ -19,16 +20,25 @@ class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter {
     explicit TCPOverIPv4OverTunFdAdapter(TunFD &&tun) : _tun(std::move(tun)) {}
 
     //! Attempts to read and parse an IPv4 datagram containing a TCP segment related to the current connection
+    //! \note Checksums are not verified again if the TUN device has checksum offload and the kernel vouches for them
     std::optional<TCPSegment> read() {
-        InternetDatagram ip_dgram;
-        if (ip_dgram.parse(_tun.read()) != ParseResult::NoError) {
+        TunFD::Packet packet = _tun.read_packet();
+        TCPFrame frame;
+        const auto checksums = packet.checksums_valid ? TCPFrame::Checksums::Trusted : TCPFrame::Checksums::Verify;
+        if (frame.parse_ipv4(packet.data, checksums) != ParseResult::NoError) {
             return {};
         }
-        return unwrap_tcp_in_ip(ip_dgram);
+        return unwrap_tcp_in_ip(frame.ip_header(), std::move(frame.segment()));
     }
 
     //! Creates an IPv4 datagram from a TCP segment and writes it to the TUN device
-    void write(TCPSegment &seg) { _tun.write(wrap_tcp_in_ip(seg).serialize()); }
+    void write(TCPSegment &seg) { _tun.write_packet(wrap_tcp_in_ip_packet(seg)); }
+
+    //! Creates an IPv4 datagram from a TCP segment and queues it on `ring` for the TUN device
+    void write(TCPSegment &seg, IOUring &ring) { _tun.write_packet(wrap_tcp_in_ip_packet(seg), ring); }
+
+    //! Whether the TUN device has checksum offload, so that the kernel can vouch for incoming checksums
+    bool checksum_offload() const { return _tun.checksum_offload(); }
 
     //! Access the underlying TUN device
     operator TunFD &() { return _tun; }
@@ -49,7 +59,8 @@ class TCPOverIPv4OverEthernetAdapter : public TCPOverIPv4Adapter {
 
     Address _next_hop;  //!< IP address of the next hop
 
-    void send_pending();  //!< Sends any pending Ethernet frames
+    void send_pending();                //!< Sends any pending Ethernet frames
+    void send_pending(IOUring &ring);  //!< Queues any pending Ethernet frames on `ring`
 
   public:
     //! Construct from a TapFD
@@ -63,6 +74,9 @@ class TCPOverIPv4OverEthernetAdapter : public TCPOverIPv4Adapter {
     //! Sends a TCP segment (in an IPv4 datagram, in an Ethernet frame).
     void write(TCPSegment &seg);
 
+    //! Queues a TCP segment (in an IPv4 datagram, in an Ethernet frame) on `ring`.
+    void write(TCPSegment &seg, IOUring &ring);
+
     //! Called periodically when time elapses
     void tick(const size_t ms_since_last_tick);
 
@@ -26,6 +26,9 @@ class TCPSender {
     //! retransmission timer for the connection
     unsigned int _initial_retransmission_timeout;
 
+    //! largest payload to put in one segment
+    size_t _max_payload_size;
+
     //! outgoing stream of bytes that have not yet been sent
     ByteStream _stream;
 
@@ -36,7 +39,8 @@ class TCPSender {
     //! Initialize a TCPSender
     TCPSender(const size_t capacity = TCPConfig::DEFAULT_CAPACITY,
               const uint16_t retx_timeout = TCPConfig::TIMEOUT_DFLT,
-              const std::optional<WrappingInt32> fixed_isn = {});
+              const std::optional<WrappingInt32> fixed_isn = {},
+              const size_t max_payload_size = TCPConfig::MAX_PAYLOAD_SIZE);
 
     //! \name "Input" interface for the writer
     //!@{
@@ -7,23 +7,54 @@ void Buffer::remove_prefix(const size_t n) {
         throw out_of_range("Buffer::remove_prefix");
     }
     _starting_offset += n;
-    if (_storage and _starting_offset == _storage->size()) {
+    if (_storage and _starting_offset + _ending_offset == _storage->size()) {
+        _storage.reset();
+    }
+}
+
+void Buffer::remove_suffix(const size_t n) {
+    if (n > str().size()) {
+        throw out_of_range("Buffer::remove_suffix");
+    }
+    _ending_offset += n;
+    if (_storage and _starting_offset + _ending_offset == _storage->size()) {
         _storage.reset();
     }
 }
 
 void BufferList::append(const BufferList &other) {
-    for (const auto &buf : other._buffers) {
+    for (const auto &buf : other.buffers()) {
         _buffers.push_back(buf);
     }
 }
 
+void BufferList::append(BufferList &&other) {
+    if (_buffers.size() == _first) {
+        _buffers = std::move(other._buffers);
+        _first = other._first;
+    } else {
+        for (size_t i = other._first; i < other._buffers.size(); i++) {
+            _buffers.push_back(std::move(other._buffers[i]));
+        }
+    }
+    other._buffers.clear();
+    other._first = 0;
+}
+
+void BufferList::prepend(Buffer buffer) {
+    if (_first > 0) {
+        _buffers[--_first] = std::move(buffer);
+    } else {
+        _buffers.insert(_buffers.begin(), std::move(buffer));
+    }
+}
+
 BufferList::operator Buffer() const {
-    switch (_buffers.size()) {
+    switch (buffers().size()) {
         case 0:
             return {};
         case 1:
-            return _buffers[0];
+            return buffers()[0];
         default: {
             throw runtime_error(
                 "BufferList: please use concatenate() to combine a multi-Buffer BufferList into one Buffer");
@@ -34,7 +65,7 @@ BufferList::operator Buffer() const {
 string BufferList::concatenate() const {
     std::string ret;
     ret.reserve(size());
-    for (const auto &buf : _buffers) {
+    for (const auto &buf : buffers()) {
         ret.append(buf);
     }
     return ret;
@@ -42,24 +73,36 @@ string BufferList::concatenate() const {
 
 size_t BufferList::size() const {
     size_t ret = 0;
-    for (const auto &buf : _buffers) {
+    for (const auto &buf : buffers()) {
         ret += buf.size();
     }
     return ret;
 }
 
+void BufferList::_pop_front() {
+    _buffers[_first++] = {};
+    if (_first == _buffers.size()) {
+        _buffers.clear();
+        _first = 0;
+    } else if (_first * 2 >= _buffers.size()) {
+        _buffers.erase(_buffers.begin(), _buffers.begin() + _first);
+        _first = 0;
+    }
+}
+
 void BufferList::remove_prefix(size_t n) {
     while (n > 0) {
-        if (_buffers.empty()) {
+        if (_first == _buffers.size()) {
             throw std::out_of_range("BufferList::remove_prefix");
         }
 
-        if (n < _buffers.front().str().size()) {
-            _buffers.front().remove_prefix(n);
+        Buffer &front = _buffers[_first];
+        if (n < front.str().size()) {
+            front.remove_prefix(n);
             n = 0;
         } else {
-            n -= _buffers.front().str().size();
-            _buffers.pop_front();
+            n -= front.str().size();
+            _pop_front();
         }
     }
 }
@@ -70,6 +113,12 @@ BufferViewList::BufferViewList(const BufferList &buffers) {
     }
 }
 
+void BufferViewList::append(std::string_view str) {
+    if (not str.empty()) {
+        _views.push_back(str);
+    }
+}
+
 void BufferViewList::remove_prefix(size_t n) {
     while (n > 0) {
         if (_views.empty()) {
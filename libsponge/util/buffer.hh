@@ -9,13 +9,17 @@
 #include <string>
 #include <string_view>
 #include <sys/uio.h>
+#include <utility>
 #include <vector>
 
+class PacketBuffer;
+
 //! \brief A reference-counted read-only string that can discard bytes from the front
 class Buffer {
   private:
     std::shared_ptr<std::string> _storage{};
     size_t _starting_offset{};
+    size_t _ending_offset{};
 
   public:
     Buffer() = default;
@@ -23,13 +27,16 @@ class Buffer {
     //! \brief Construct by taking ownership of a string
     Buffer(std::string &&str) noexcept : _storage(std::make_shared<std::string>(std::move(str))) {}
 
+    //! \brief Construct by taking over the block of a PacketBuffer, which is left empty
+    Buffer(PacketBuffer &&pkt) noexcept;
+
     //! \name Expose contents as a std::string_view
     //!@{
     std::string_view str() const {
         if (not _storage) {
             return {};
         }
-        return {_storage->data() + _starting_offset, _storage->size() - _starting_offset};
+        return {_storage->data() + _starting_offset, _storage->size() - _starting_offset - _ending_offset};
     }
 
     operator std::string_view() const { return str(); }
@@ -47,6 +54,10 @@ class Buffer {
     //! \brief Discard the first `n` bytes of the string (does not require a copy or move)
     //! \note Doesn't free any memory until the whole string has been discarded in all copies of the Buffer.
     void remove_prefix(const size_t n);
+
+    //! \brief Discard the last `n` bytes of the string (does not require a copy or move)
+    //! \note Doesn't free any memory until the whole string has been discarded in all copies of the Buffer.
+    void remove_suffix(const size_t n);
 };
 
 //! \brief A reference-counted discontiguous string that can discard bytes from the front
@@ -56,30 +67,71 @@ class Buffer {
 //! the TCPSegment in an IPv4Datagram) without copying the payload.
 class BufferList {
   private:
-    std::deque<Buffer> _buffers{};
+    //! The Buffers, from `_buffers[_first]` on; those before it have been discarded by remove_prefix(), or
+    //! are kept free for prepend(). A vector rather than a deque, so an empty BufferList allocates nothing
+    //! and moving one is cheap.
+    std::vector<Buffer> _buffers{};
+    size_t _first{0};
+
+    //! Discard the first Buffer, reclaiming the discarded slots once they are half of the vector
+    void _pop_front();
 
   public:
+    //! \brief A read-only view of the Buffers of a BufferList, valid until the list is modified
+    class Buffers {
+        const std::vector<Buffer> &_buffers;
+        const size_t _first;
+
+      public:
+        Buffers(const std::vector<Buffer> &buffers, const size_t first) : _buffers(buffers), _first(first) {}
+
+        std::vector<Buffer>::const_iterator begin() const { return _buffers.begin() + _first; }
+        std::vector<Buffer>::const_iterator end() const { return _buffers.end(); }
+        size_t size() const { return _buffers.size() - _first; }
+        bool empty() const { return size() == 0; }
+        const Buffer &operator[](const size_t n) const { return _buffers[_first + n]; }
+    };
+
     //! \name Constructors
     //!@{
 
     BufferList() = default;
 
     //! \brief Construct from a Buffer
-    BufferList(Buffer buffer) : _buffers{buffer} {}
+    //! \details Room for one more Buffer is kept in front of it, so the header that usually gets prepended
+    //! to a payload (see prepend()) goes in without reallocating, and the list stays one allocation.
+    BufferList(Buffer buffer) : _buffers(2), _first(1) { _buffers[1] = std::move(buffer); }
 
-    //! \brief Construct by taking ownership of a std::string
-    BufferList(std::string &&str) noexcept {
-        Buffer buf{std::move(str)};
-        append(buf);
+    //! \brief Construct by taking ownership of a std::string (with room in front, as above)
+    BufferList(std::string &&str) noexcept : BufferList(Buffer{std::move(str)}) {}
+
+    BufferList(const BufferList &other) = default;
+    BufferList &operator=(const BufferList &other) = default;
+
+    //! \brief Take the Buffers of `other`, leaving it empty
+    BufferList(BufferList &&other) noexcept
+        : _buffers(std::move(other._buffers)), _first(std::exchange(other._first, 0)) {}
+
+    BufferList &operator=(BufferList &&other) noexcept {
+        _buffers = std::move(other._buffers);
+        _first = std::exchange(other._first, 0);
+        other._buffers.clear();
+        return *this;
     }
     //!@}
 
     //! \brief Access the underlying queue of Buffers
-    const std::deque<Buffer> &buffers() const { return _buffers; }
+    Buffers buffers() const { return {_buffers, _first}; }
 
     //! \brief Append a BufferList
     void append(const BufferList &other);
 
+    //! \brief Append a BufferList, taking its Buffers instead of sharing them
+    void append(BufferList &&other);
+
+    //! \brief Insert a Buffer before the others, e.g. the header of an enclosing protocol
+    void prepend(Buffer buffer);
+
     //! \brief Transform to a Buffer
     //! \note Throws an exception unless BufferList is contiguous
     operator Buffer() const;
@@ -102,6 +154,8 @@ class BufferViewList {
     //! \name Constructors
     //!@{
 
+    BufferViewList() = default;
+
     //! \brief Construct from a std::string
     BufferViewList(const std::string &str) : BufferViewList(std::string_view(str)) {}
 
@@ -115,6 +169,9 @@ class BufferViewList {
     BufferViewList(std::string_view str) { _views.push_back({const_cast<char *>(str.data()), str.size()}); }
     //!@}
 
+    //! \brief Append a view to the end of the list (empty views are ignored)
+    void append(std::string_view str);
+
     //! \brief Discard the first `n` bytes of the string (does not require a copy or move)
     void remove_prefix(size_t n);
 
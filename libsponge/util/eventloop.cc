@@ -2,7 +2,9 @@
 
 #include "util.hh"
 
+#include <algorithm>
 #include <cerrno>
+#include <climits>
 #include <stdexcept>
 #include <system_error>
 #include <utility>
@@ -10,45 +12,189 @@
 
 using namespace std;
 
+//! Most ready fds that one call to [epoll_wait(2)](\ref man2::epoll_wait) reports; the rest stay ready for the next
+static constexpr size_t MAX_READY_EVENTS = 1024;
+
 unsigned int EventLoop::Rule::service_count() const {
     return direction == Direction::In ? fd.read_count() : fd.write_count();
 }
 
+bool EventLoop::Rule::defunct() const { return (direction == Direction::In and fd.eof()) or fd.closed(); }
+
+//! The epoll event that corresponds to `direction`
+static uint32_t epoll_event_for(const Direction direction) {
+    return direction == Direction::In ? EPOLLIN : EPOLLOUT;
+}
+
+//! `timeout` for [ppoll(2)](\ref man2::ppoll) and epoll_pwait2(2), stored in `ts`, or nullptr to wait for ever
+static const timespec *as_timespec(const optional<EventLoop::Clock::duration> &timeout, timespec &ts) {
+    if (not timeout) {
+        return nullptr;
+    }
+    const auto secs = chrono::duration_cast<chrono::seconds>(*timeout);
+    ts.tv_sec = secs.count();
+    ts.tv_nsec = chrono::duration_cast<chrono::nanoseconds>(*timeout - secs).count();
+    return &ts;
+}
+
+//! `timeout` for [epoll_wait(2)](\ref man2::epoll_wait), rounded up so as not to wake before a timer is due
+static int as_milliseconds(const optional<EventLoop::Clock::duration> &timeout) {
+    if (not timeout) {
+        return -1;
+    }
+    return min(chrono::ceil<chrono::milliseconds>(*timeout).count(), chrono::milliseconds::rep{INT_MAX});
+}
+
+EventLoop::EventLoop(const Backend backend) : _backend(backend) {
+    if (_backend == Backend::Epoll) {
+        _epoll.emplace(SystemCall("epoll_create1", ::epoll_create1(EPOLL_CLOEXEC)));
+    }
+}
+
 //! \param[in] fd is the FileDescriptor to be polled
 //! \param[in] direction indicates whether to poll for reading (Direction::In) or writing (Direction::Out)
 //! \param[in] callback is called when `fd` is ready.
 //! \param[in] interest is called by EventLoop::wait_next_event. If it returns `true`, `fd` will
 //!                     be polled, otherwise `fd` will be ignored only for this execution of `wait_next_event.
+//!                     If empty, `fd` is always polled.
 //! \param[in] cancel is called when the rule is cancelled (e.g. on hangup, EOF, or closure).
+//!
+//! With Backend::Epoll, `fd` is registered with the kernel here, and it is an error to add a second
+//! rule for the same fd number and `direction` while the first one is still installed.
 void EventLoop::add_rule(const FileDescriptor &fd,
                          const Direction direction,
                          const CallbackT &callback,
                          const InterestT &interest,
                          const CallbackT &cancel) {
-    _rules.push_back({fd.duplicate(), direction, callback, interest, cancel});
+    if (_backend == Backend::Poll) {
+        _rules.push_back({fd.duplicate(), direction, callback, interest, cancel});
+        return;
+    }
+
+    const int fd_num = fd.fd_num();
+
+    // rules whose fd was closed still hold its number, which the kernel may have handed out again:
+    // take them off the registration now, and cancel them on the next wait
+    if (const auto existing = _registrations.find(fd_num); existing != _registrations.end()) {
+        for (const auto rule : array{existing->second.rules}) {  // copied, since _detach() may erase the entry
+            if (rule and (*rule)->fd.closed()) {
+                _detach(*rule);
+                if (find(_unchecked.begin(), _unchecked.end(), *rule) == _unchecked.end()) {
+                    _unchecked.push_back(*rule);
+                }
+            }
+        }
+    }
+
+    Registration &registration = _registrations[fd_num];
+    if (registration.rules[_index(direction)]) {
+        throw runtime_error("EventLoop: fd " + to_string(fd_num) + " already has a rule for this direction");
+    }
+
+    if (not registration.rules[0] and not registration.rules[1]) {
+        epoll_event event{};
+        event.data.fd = fd_num;
+        if (::epoll_ctl(_epoll->fd_num(), EPOLL_CTL_ADD, fd_num, &event) < 0) {
+            if (errno != EPERM) {
+                _registrations.erase(fd_num);
+                throw unix_error("epoll_ctl");
+            }
+            // regular files and directories can't be watched, but poll(2) says they are always ready
+            registration.always_ready = true;
+            _always_ready.push_back(fd_num);
+        }
+    }
+
+    auto &rules = interest ? _rules : _static_rules;
+    const auto rule = rules.insert(rules.end(), {fd.duplicate(), direction, callback, interest, cancel});
+    registration.rules[_index(direction)] = rule;
+
+    // a rule with an interest callback is registered for its direction by the next wait, if interested
+    if (not interest) {
+        _set_polled(*rule, true);
+        _unchecked.push_back(rule);
+    }
 }
 
-//! \param[in] timeout_ms is the timeout value passed to [poll(2)](\ref man2::poll); `wait_next_event`
-//!                       returns Result::Timeout if no fd is ready after the timeout expires.
-//! \returns Eventloop::Result indicating success, timeout, or no more Rule objects to poll.
+void EventLoop::_set_polled(Rule &rule, const bool polled) {
+    if (rule.polled == polled) {
+        return;
+    }
+    rule.polled = polled;
+    if (polled) {
+        _polled++;
+    } else {
+        _polled--;
+    }
+
+    const int fd_num = rule.fd.fd_num();
+    Registration &registration = _registrations.at(fd_num);
+    if (polled) {
+        registration.events |= epoll_event_for(rule.direction);
+    } else {
+        registration.events &= ~epoll_event_for(rule.direction);
+    }
+
+    if (not registration.always_ready and not rule.fd.closed()) {
+        epoll_event event{};
+        event.events = registration.events;
+        event.data.fd = fd_num;
+        SystemCall("epoll_ctl", ::epoll_ctl(_epoll->fd_num(), EPOLL_CTL_MOD, fd_num, &event));
+    }
+}
+
+void EventLoop::_detach(const RuleIterator rule) {
+    const int fd_num = rule->fd.fd_num();
+    const auto registration = _registrations.find(fd_num);
+    if (registration == _registrations.end() or registration->second.rules[_index(rule->direction)] != rule) {
+        return;
+    }
+
+    _set_polled(*rule, false);
+    auto &rules = registration->second.rules;
+    rules[_index(rule->direction)].reset();
+    if (rules[0] or rules[1]) {
+        return;
+    }
+
+    if (registration->second.always_ready) {
+        _always_ready.erase(find(_always_ready.begin(), _always_ready.end(), fd_num));
+    } else if (not rule->fd.closed()) {  // closing the fd already took it out of the epoll set
+        SystemCall("epoll_ctl", ::epoll_ctl(_epoll->fd_num(), EPOLL_CTL_DEL, fd_num, nullptr));
+    }
+    _registrations.erase(registration);
+}
+
+EventLoop::RuleIterator EventLoop::_cancel(const RuleIterator rule) {
+    rule->cancel();
+    _detach(rule);
+    _unchecked.erase(remove(_unchecked.begin(), _unchecked.end(), rule), _unchecked.end());
+    return (rule->interest ? _rules : _static_rules).erase(rule);
+}
+
+//! \param[in] timeout_ms is the longest time to wait for an fd (negative to wait indefinitely); `wait_next_event`
+//!                       returns Result::Timeout if no fd is ready and no timer is due after the timeout expires.
+//! \returns Eventloop::Result indicating success, timeout, or no more Rule objects or timers to wait for.
 //!
 //! For each Rule, this function first calls Rule::interest; if `true`, Rule::fd is added to the
 //! list of file descriptors to be polled for readability (if Rule::direction == Direction::In) or
 //! writability (if Rule::direction == Direction::Out) unless Rule::fd has reached EOF, in which case
 //! the Rule is canceled (i.e., deleted from EventLoop::_rules).
 //!
-//! Next, this function calls [poll(2)](\ref man2::poll) with timeout value `timeout_ms`.
+//! Next, this function calls [poll(2)](\ref man2::poll) with timeout value `timeout_ms`, or less if
+//! a timer is due sooner.
 //!
 //! Then, for each ready file descriptor, this function calls Rule::callback. If fd reaches EOF or
 //! if the Rule was registered using EventLoop::add_cancelable_rule and Rule::callback returns true,
-//! this Rule is canceled.
+//! this Rule is canceled. Finally, it calls the callback of each timer whose deadline has passed.
 //!
 //! If an error occurs during polling, this function throws a std::runtime_error.
 //!
-//! If a [signal(7)](\ref man7::signal) was caught during polling or if EventLoop::_rules becomes empty,
-//! this function returns Result::Exit.
+//! If a [signal(7)](\ref man7::signal) was caught during polling or if EventLoop::_rules becomes empty
+//! and no timer is pending, this function returns Result::Exit.
 //!
-//! If a timeout occurred while polling (i.e., no fd became ready), this function returns Result::Timeout.
+//! If a timeout occurred while polling (i.e., no fd became ready and no timer was due), this function
+//! returns Result::Timeout.
 //!
 //! Otherwise, this function returns Result::Success.
 //!
@@ -59,6 +205,27 @@ void EventLoop::add_rule(const FileDescriptor &fd,
 //! will result in a busy loop (poll returns on a ready file descriptor; file descriptor is not read or
 //! written, so it is still ready; the next call to poll will immediately return).
 EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
+    const auto timeout = _timeout(timeout_ms);
+    const Result result = _backend == Backend::Epoll ? _wait_epoll(timeout) : _wait_poll(timeout);
+    if (result == Result::Exit) {
+        return result;
+    }
+    return _run_timers() ? Result::Success : result;
+}
+
+optional<EventLoop::Clock::duration> EventLoop::_timeout(const int timeout_ms) const {
+    optional<Clock::duration> timeout{};
+    if (timeout_ms >= 0) {
+        timeout = chrono::milliseconds{timeout_ms};
+    }
+    if (not _timers.empty()) {
+        const auto until_timer = max(Clock::duration::zero(), _timers.begin()->first.first - Clock::now());
+        timeout = timeout ? min(*timeout, until_timer) : until_timer;
+    }
+    return timeout;
+}
+
+EventLoop::Result EventLoop::_wait_poll(const optional<Clock::duration> &timeout) {
     vector<pollfd> pollfds{};
     pollfds.reserve(_rules.size());
     bool something_to_poll = false;
@@ -79,7 +246,7 @@ EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
             continue;
         }
 
-        if (this_rule.interest()) {
+        if (this_rule.interested()) {
             pollfds.push_back({this_rule.fd.fd_num(), static_cast<short>(this_rule.direction), 0});
             something_to_poll = true;
         } else {
@@ -88,14 +255,15 @@ EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
         ++it;
     }
 
-    // quit if there is nothing left to poll
-    if (not something_to_poll) {
+    // quit if there is nothing left to poll or wait for
+    if (not something_to_poll and _timers.empty()) {
         return Result::Exit;
     }
 
     // call poll -- wait until one of the fds satisfies one of the rules (writeable/readable)
     try {
-        if (0 == SystemCall("poll", ::poll(pollfds.data(), pollfds.size(), timeout_ms))) {
+        timespec ts{};
+        if (0 == SystemCall("ppoll", ::ppoll(pollfds.data(), pollfds.size(), as_timespec(timeout, ts), nullptr))) {
             return Result::Timeout;
         }
     } catch (unix_error const &e) {
@@ -132,7 +300,7 @@ EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
             this_rule.callback();
 
             // only check for busy wait if we're not canceling or exiting
-            if (count_before == this_rule.service_count() and this_rule.interest()) {
+            if (count_before == this_rule.service_count() and this_rule.interested()) {
                 throw runtime_error(
                     "EventLoop: busy wait detected: callback did not read/write fd and is still interested");
             }
@@ -143,3 +311,172 @@ EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
 
     return Result::Success;
 }
+
+//! Registrations persist between calls, so this only visits the rules that have an `interest`
+//! callback (to update their registration if the answer changed), rules added since the last
+//! call (in case their fd is already at EOF or closed), and the rules whose fd is ready.
+EventLoop::Result EventLoop::_wait_epoll(const optional<Clock::duration> &timeout) {
+    for (const auto rule : exchange(_unchecked, {})) {
+        if (rule->defunct()) {
+            _cancel(rule);
+        }
+    }
+
+    for (auto it = _rules.begin(); it != _rules.end();) {  // NOTE: it gets erased or incremented in loop body
+        if (it->defunct()) {
+            it = _cancel(it);
+            continue;
+        }
+        _set_polled(*it, it->interest());
+        ++it;
+    }
+
+    // quit if there is nothing left to poll or wait for
+    if (_polled == 0 and _timers.empty()) {
+        return Result::Exit;
+    }
+
+    // an fd that epoll can't watch is ready, so don't wait at all if it is polled
+    const bool always_ready = any_of(
+        _always_ready.begin(), _always_ready.end(), [&](const int fd_num) { return _registrations.at(fd_num).events; });
+
+    _ready.resize(clamp(_registrations.size(), size_t{1}, MAX_READY_EVENTS));
+    int ready_count = 0;
+    try {
+        ready_count = _epoll_wait(always_ready ? Clock::duration::zero() : timeout);
+    } catch (unix_error const &e) {
+        if (e.code().value() == EINTR) {
+            return Result::Exit;
+        }
+        throw;
+    }
+
+    if (ready_count == 0 and not always_ready) {
+        return Result::Timeout;
+    }
+
+    for (int i = 0; i < ready_count; i++) {
+        _dispatch(_ready[i].data.fd, _ready[i].events);
+    }
+    if (always_ready) {
+        for (const int fd_num : vector<int>{_always_ready}) {  // copied, since callbacks may cancel rules
+            _dispatch(fd_num, EPOLLIN | EPOLLOUT);
+        }
+    }
+
+    return Result::Success;
+}
+
+void EventLoop::_dispatch(const int fd_num, const uint32_t revents) {
+    if (revents & EPOLLERR) {
+        throw runtime_error("EventLoop: error on polled file descriptor");
+    }
+
+    for (const Direction direction : {Direction::In, Direction::Out}) {
+        // look the rule up afresh: the previous callback may have canceled or added rules
+        const auto registration = _registrations.find(fd_num);
+        if (registration == _registrations.end()) {
+            return;
+        }
+        const auto &slot = registration->second.rules[_index(direction)];
+        if (not slot or not(*slot)->polled) {
+            continue;
+        }
+
+        const RuleIterator it = *slot;
+        const auto &this_rule = *it;
+        const auto ready = static_cast<bool>(revents & epoll_event_for(direction));
+        if ((revents & EPOLLHUP) and not ready) {
+            // as with poll(2): a hangup and nothing to read or room to write means the fd is defunct
+            _cancel(it);
+            continue;
+        }
+
+        if (ready) {
+            const auto count_before = this_rule.service_count();
+            this_rule.callback();
+
+            // callbacks never delete rules (add_rule() only detaches them), so this_rule is still valid
+            if (count_before == this_rule.service_count() and this_rule.interested()) {
+                throw runtime_error(
+                    "EventLoop: busy wait detected: callback did not read/write fd and is still interested");
+            }
+            if (this_rule.defunct()) {
+                _cancel(it);
+            }
+        }
+    }
+}
+
+int EventLoop::_epoll_wait(const optional<Clock::duration> &timeout) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 35))
+    if (_have_epoll_pwait2) {
+        timespec ts{};
+        const int ret =
+            ::epoll_pwait2(_epoll->fd_num(), _ready.data(), _ready.size(), as_timespec(timeout, ts), nullptr);
+        if (ret >= 0 or errno != ENOSYS) {
+            return SystemCall("epoll_pwait2", ret);
+        }
+        _have_epoll_pwait2 = false;  // before Linux 5.11
+    }
+#endif
+    return SystemCall("epoll_wait",
+                      ::epoll_wait(_epoll->fd_num(), _ready.data(), _ready.size(), as_milliseconds(timeout)));
+}
+
+//! \param[in] deadline is when the timer is due
+//! \param[in] callback is called once, after `deadline`, by EventLoop::wait_next_event
+EventLoop::TimerId EventLoop::add_timer(const Clock::time_point deadline, const CallbackT &callback) {
+    const TimerId id = _next_timer_id++;
+    _timers.emplace(make_pair(deadline, id), callback);
+    _timer_deadlines.emplace(id, deadline);
+    return id;
+}
+
+bool EventLoop::rearm_timer(const TimerId id, const Clock::time_point deadline) {
+    const auto pending = _timer_deadlines.find(id);
+    if (pending == _timer_deadlines.end()) {
+        return false;
+    }
+    auto timer = _timers.extract({pending->second, id});
+    timer.key() = {deadline, id};
+    _timers.insert(move(timer));
+    pending->second = deadline;
+    return true;
+}
+
+bool EventLoop::cancel_timer(const TimerId id) {
+    const auto pending = _timer_deadlines.find(id);
+    if (pending == _timer_deadlines.end()) {
+        return false;
+    }
+    _timers.erase({pending->second, id});
+    _timer_deadlines.erase(pending);
+    return true;
+}
+
+//! Only timers that were due when this function started are run: one that a callback arms for a
+//! deadline that has already passed runs on the next call, so a callback that keeps rearming its
+//! own timer can't hold up the loop.
+bool EventLoop::_run_timers() {
+    if (_timers.empty()) {
+        return false;
+    }
+    const auto now = Clock::now();
+    _expired.clear();
+    for (auto it = _timers.begin(); it != _timers.end() and it->first.first <= now; ++it) {
+        _expired.push_back(it->first);
+    }
+
+    bool fired = false;
+    for (const auto &key : _expired) {
+        auto timer = _timers.extract(key);
+        if (timer.empty()) {
+            continue;  // canceled or rearmed by an earlier callback
+        }
+        _timer_deadlines.erase(key.second);
+        timer.mapped()();
+        fired = true;
+    }
+    return fired;
+}
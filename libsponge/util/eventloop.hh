@@ -3,10 +3,20 @@
 
 #include "file_descriptor.hh"
 
+#include <array>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
+#include <ctime>
 #include <functional>
 #include <list>
+#include <map>
+#include <optional>
 #include <poll.h>
+#include <sys/epoll.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 //! Waits for events on file descriptors and executes corresponding callbacks.
 class EventLoop {
@@ -17,6 +27,22 @@ class EventLoop {
         Out = POLLOUT  //!< Callback will be triggered when Rule::fd is writable.
     };
 
+    //! The system call that EventLoop::wait_next_event waits in.
+    enum class Backend {
+        Poll,  //!< [poll(2)](\ref man2::poll) on every fd, each call: O(rules) per wakeup
+        Epoll  //!< [epoll(7)](\ref man7::epoll), fds registered once: O(ready fds + rules with `interest`) per wakeup
+    };
+
+    //! Returned by each call to EventLoop::wait_next_event.
+    enum class Result {
+        Success,  //!< At least one Rule was triggered.
+        Timeout,  //!< No rules were triggered before timeout.
+        Exit  //!< All rules have been canceled or were uninterested; make no further calls to EventLoop::wait_next_event.
+    };
+
+    using Clock = std::chrono::steady_clock;  //!< The clock that timer deadlines refer to
+    using TimerId = uint64_t;                 //!< Identifies a timer added with EventLoop::add_timer
+
   private:
     using CallbackT = std::function<void(void)>;  //!< Callback for ready Rule::fd
     using InterestT = std::function<bool(void)>;  //!< `true` return indicates Rule::fd should be polled.
@@ -30,32 +56,113 @@ class EventLoop {
         CallbackT callback;   //!< A callback that reads or writes fd.
         InterestT interest;   //!< A callback that returns `true` whenever fd should be polled.
         CallbackT cancel;     //!< A callback that is called when the rule is cancelled (e.g. on hangup)
+        bool polled = false;  //!< (Backend::Epoll) fd is registered with the kernel for Rule::direction
 
         //! Returns the number of times fd has been read or written, depending on the value of Rule::direction.
         //! \details This function is used internally by EventLoop; you will not need to call it
         unsigned int service_count() const;
+
+        //! Calls Rule::interest; a rule added without one is always interested.
+        bool interested() const { return not interest or interest(); }
+
+        //! Whether fd has reached EOF (for Direction::In) or been closed, so the rule can never fire again.
+        bool defunct() const;
     };
 
-    std::list<Rule> _rules{};  //!< All rules that have been added and not canceled.
+    using RuleIterator = std::list<Rule>::iterator;
 
-  public:
-    //! Returned by each call to EventLoop::wait_next_event.
-    enum class Result {
-        Success,  //!< At least one Rule was triggered.
-        Timeout,  //!< No rules were triggered before timeout.
-        Exit  //!< All rules have been canceled or were uninterested; make no further calls to EventLoop::wait_next_event.
+    //! \brief (Backend::Epoll) The rules for one fd number, which epoll watches as a single entry.
+    //! \details The In and Out rules for a socket usually share its fd number (see FileDescriptor::duplicate).
+    struct Registration {
+        std::array<std::optional<RuleIterator>, 2> rules{};  //!< the Direction::In and Direction::Out rules
+        uint32_t events{0};                                  //!< the events epoll is currently asked for
+        bool always_ready{false};  //!< the fd can't be watched by epoll (e.g. a regular file), and poll(2) would
+                                   //!< always report it ready
     };
 
+    Backend _backend;
+
+    //! All rules (Backend::Poll), or the rules with an `interest` callback (Backend::Epoll)
+    std::list<Rule> _rules{};
+
+    //! (Backend::Epoll) Rules without an `interest` callback, only visited when their fd is ready
+    std::list<Rule> _static_rules{};
+
+    std::optional<FileDescriptor> _epoll{};                   //!< (Backend::Epoll) the epoll instance
+    std::unordered_map<int, Registration> _registrations{};  //!< (Backend::Epoll) by fd number
+    std::vector<RuleIterator> _unchecked{};                  //!< (Backend::Epoll) static rules not yet checked
+    std::vector<int> _always_ready{};                        //!< (Backend::Epoll) fd numbers of such Registrations
+    std::vector<epoll_event> _ready{};                       //!< (Backend::Epoll) filled in by epoll_wait(2)
+    size_t _polled{0};                                       //!< (Backend::Epoll) number of rules with Rule::polled
+    bool _have_epoll_pwait2{true};  //!< (Backend::Epoll) false if the kernel lacks epoll_pwait2(2)
+
+    //! Pending timers, ordered by deadline
+    std::map<std::pair<Clock::time_point, TimerId>, CallbackT> _timers{};
+    std::unordered_map<TimerId, Clock::time_point> _timer_deadlines{};  //!< The deadline of each pending timer
+    TimerId _next_timer_id{0};                                         //!< Id for the next EventLoop::add_timer
+    std::vector<std::pair<Clock::time_point, TimerId>> _expired{};     //!< Scratch space for EventLoop::_run_timers
+
+    //! How long to wait for an fd: `timeout_ms` (negative for ever), or less if a timer is due sooner
+    std::optional<Clock::duration> _timeout(const int timeout_ms) const;
+
+    //! Call the callbacks of the timers whose deadline has passed; returns whether there were any
+    bool _run_timers();
+
+    //! \name Backend::Epoll bookkeeping
+    //!@{
+
+    //! Index of `direction` in Registration::rules
+    static size_t _index(const Direction direction) { return direction == Direction::In ? 0 : 1; }
+
+    //! Ask epoll for `rule`'s direction on its fd, or stop asking
+    void _set_polled(Rule &rule, const bool polled);
+
+    //! Take `rule` out of its fd's Registration, and the fd out of the epoll set if no rule is left for it
+    void _detach(const RuleIterator rule);
+
+    //! Call Rule::cancel, detach the rule, and delete it; returns the next rule in its list
+    RuleIterator _cancel(const RuleIterator rule);
+
+    //! Run the rules for `fd_num` that `revents` says are ready, as the poll backend does for each pollfd
+    void _dispatch(const int fd_num, const uint32_t revents);
+
+    //! epoll_pwait2(2), or [epoll_wait(2)](\ref man2::epoll_wait) with `timeout` rounded up to milliseconds
+    int _epoll_wait(const std::optional<Clock::duration> &timeout);
+    //!@}
+
+    //! \name Wait for fds (or until `timeout`, if set) and run their callbacks
+    //!@{
+    Result _wait_poll(const std::optional<Clock::duration> &timeout);
+    Result _wait_epoll(const std::optional<Clock::duration> &timeout);
+    //!@}
+
+  public:
+    //! Wait with `backend`; Backend::Poll is kept for comparison and for debugging with strace
+    explicit EventLoop(const Backend backend = Backend::Epoll);
+
     //! Add a rule whose callback will be called when `fd` is ready in the specified Direction.
     void add_rule(
         const FileDescriptor &fd,
         const Direction direction,
         const CallbackT &callback,
-        const InterestT &interest = [] { return true; },
+        const InterestT &interest = {},
         const CallbackT &cancel = [] {});
 
-    //! Calls [poll(2)](\ref man2::poll) and then executes callback for each ready fd.
+    //! Calls [poll(2)](\ref man2::poll) or [epoll_wait(2)](\ref man2::epoll_wait) and then executes callback for
+    //! each ready fd and each timer that is due.
     Result wait_next_event(const int timeout_ms);
+
+    //! \brief Call `callback` once, from the first EventLoop::wait_next_event that ends after `deadline`
+    //! \returns an id for EventLoop::rearm_timer and EventLoop::cancel_timer, valid until the timer fires
+    TimerId add_timer(const Clock::time_point deadline, const CallbackT &callback);
+
+    //! \brief Move pending timer `id` to `deadline`
+    //! \returns `false` (and does nothing) if the timer has already fired or been canceled
+    bool rearm_timer(const TimerId id, const Clock::time_point deadline);
+
+    //! \brief Remove pending timer `id` without calling its callback
+    //! \returns `false` if the timer has already fired or been canceled
+    bool cancel_timer(const TimerId id);
 };
 
 using Direction = EventLoop::Direction;
@@ -73,5 +180,19 @@ using Direction = EventLoop::Direction;
 //! A Rule installed using EventLoop::add_cancelable_rule will be polled and canceled under the
 //! same conditions, with the additional condition that if Rule::callback returns `true`, the
 //! Rule will be canceled.
+//!
+//! With Backend::Epoll (the default), a Rule's fd is registered with the kernel once, when the Rule
+//! is added, and unregistered when it is canceled, so a wakeup costs time in proportion to the
+//! number of ready fds rather than the number of rules. Rules added with an `interest` callback
+//! still have it called on every EventLoop::wait_next_event, which changes the registration only
+//! when the answer changes. A rule without one is checked for EOF and closure on the first wait
+//! after it is added and after each run of its callback, not on every wait. Each fd number may
+//! have at most one rule per Direction.
+//!
+//! Timers added with EventLoop::add_timer shorten the wait so that it ends at the earliest deadline,
+//! with the resolution of [ppoll(2)](\ref man2::ppoll) and epoll_pwait2(2) rather than whole
+//! milliseconds. A pending timer keeps the loop alive: EventLoop::wait_next_event returns
+//! Result::Exit only once there is neither an interested rule nor a pending timer. Timers are kept
+//! in an ordered map, so adding, rearming and canceling one costs O(log timers).
 
 #endif  // SPONGE_LIBSPONGE_EVENTLOOP_HH
@@ -98,6 +98,24 @@ size_t FileDescriptor::write(BufferViewList buffer, const bool write_all) {
     return total_bytes_written;
 }
 
+size_t FileDescriptor::write(const string_view str, const bool write_all) {
+    size_t total_bytes_written = 0;
+
+    do {
+        const ssize_t bytes_written = SystemCall(
+            "write", ::write(fd_num(), str.data() + total_bytes_written, str.size() - total_bytes_written));
+        if (bytes_written == 0 and total_bytes_written != str.size()) {
+            throw runtime_error("write returned 0 given non-empty input buffer");
+        }
+
+        register_write();
+
+        total_bytes_written += bytes_written;
+    } while (write_all and total_bytes_written != str.size());
+
+    return total_bytes_written;
+}
+
 void FileDescriptor::set_blocking(const bool blocking_state) {
     int flags = SystemCall("fcntl", fcntl(fd_num(), F_GETFL));
     if (blocking_state) {
@@ -7,6 +7,7 @@
 #include <cstddef>
 #include <limits>
 #include <memory>
+#include <string_view>
 
 //! A reference-counted handle to a file descriptor
 class FileDescriptor {
@@ -44,6 +45,8 @@ class FileDescriptor {
     // private constructor used to duplicate the FileDescriptor (increase the reference count)
     explicit FileDescriptor(std::shared_ptr<FDWrapper> other_shared_ptr);
 
+    friend class IOUring;  // counts the writes it makes on the FileDescriptor's behalf
+
   protected:
     void register_read() { ++_internal_fd->_read_count; }    //!< increment read count
     void register_write() { ++_internal_fd->_write_count; }  //!< increment write count
@@ -70,6 +73,9 @@ class FileDescriptor {
     //! Write a buffer (or list of buffers), possibly blocking until all is written
     size_t write(BufferViewList buffer, const bool write_all = true);
 
+    //! Write contiguous bytes (e.g. a PacketBuffer) with a single write(2), possibly blocking until all is written
+    size_t write(const std::string_view str, const bool write_all = true);
+
     //! Close the underlying file descriptor
     void close() { _internal_fd->close(); }
 
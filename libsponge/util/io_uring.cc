@@ -0,0 +1,210 @@
+#include "io_uring.hh"
+
+#include "util.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+static int io_uring_setup(const unsigned entries, io_uring_params &params) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+}
+
+static int io_uring_enter(const int ring_fd, const unsigned to_submit, const unsigned min_complete) {
+    return static_cast<int>(
+        ::syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, IORING_ENTER_GETEVENTS, nullptr, 0));
+}
+
+//! Map `size` bytes of the ring at `offset`
+static void *map_ring(const int ring_fd, const size_t size, const off_t offset) {
+    void *const ret = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, offset);
+    if (ret == MAP_FAILED) {
+        throw unix_error("mmap");
+    }
+    return ret;
+}
+
+//! A pointer to the field `offset` bytes into a mapped ring
+template <typename T>
+static T *field(void *map, const uint32_t offset) {
+    return reinterpret_cast<T *>(static_cast<char *>(map) + offset);
+}
+
+bool IOUring::available() {
+    static const bool ret = [] {
+        io_uring_params params{};
+        const int fd = io_uring_setup(1, params);
+        if (fd < 0) {
+            return false;  // ENOSYS, EPERM (seccomp or kernel.io_uring_disabled), ...
+        }
+        ::close(fd);
+        return true;
+    }();
+    return ret;
+}
+
+//! \param[in] entries is how many writes can be queued before IOUring::write submits them itself
+IOUring::IOUring(const unsigned entries) : IOUring(entries, io_uring_params{}) {}
+
+IOUring::IOUring(const unsigned entries, io_uring_params params)
+    : _ring(SystemCall("io_uring_setup", io_uring_setup(entries, params))), _operations(params.sq_entries) {
+    _sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        _sq_map_size = max(_sq_map_size, _cq_map_size);
+    }
+    // the destructor does not run if a constructor throws, so undo the mappings made so far here
+    try {
+        _sq_map = map_ring(_ring.fd_num(), _sq_map_size, IORING_OFF_SQ_RING);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            _cq_map = _sq_map;
+        } else {
+            _cq_map = map_ring(_ring.fd_num(), _cq_map_size, IORING_OFF_CQ_RING);
+        }
+        _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        _sqes = static_cast<io_uring_sqe *>(map_ring(_ring.fd_num(), _sqes_size, IORING_OFF_SQES));
+    } catch (...) {
+        _unmap();
+        throw;
+    }
+
+    _sq_tail = field<unsigned>(_sq_map, params.sq_off.tail);
+    _sq_mask = *field<unsigned>(_sq_map, params.sq_off.ring_mask);
+    _sq_array = field<unsigned>(_sq_map, params.sq_off.array);
+    _cq_head = field<unsigned>(_cq_map, params.cq_off.head);
+    _cq_tail = field<unsigned>(_cq_map, params.cq_off.tail);
+    _cq_mask = *field<unsigned>(_cq_map, params.cq_off.ring_mask);
+    _cqes = field<io_uring_cqe>(_cq_map, params.cq_off.cqes);
+}
+
+IOUring::~IOUring() { _unmap(); }
+
+void IOUring::_unmap() {
+    if (_sqes) {
+        ::munmap(_sqes, _sqes_size);
+    }
+    if (_cq_map and _cq_map != _sq_map) {
+        ::munmap(_cq_map, _cq_map_size);
+    }
+    if (_sq_map) {
+        ::munmap(_sq_map, _sq_map_size);
+    }
+}
+
+pair<io_uring_sqe &, IOUring::Operation &> IOUring::_next(FileDescriptor &fd, BufferList &&data) {
+    if (_queued == _operations.size()) {
+        submit();
+    }
+
+    // only this thread writes the tail, and submit() waits for the kernel to consume every entry
+    const unsigned tail = *_sq_tail + _queued;
+    const unsigned index = tail & _sq_mask;
+    io_uring_sqe &sqe = _sqes[index];
+    sqe = {};
+    sqe.user_data = index;
+    _sq_array[index] = index;
+
+    Operation &op = _operations[index];
+    op.data = move(data);
+    op.length = op.data.size();
+    op.fd = &fd;
+    _queued++;
+    return {sqe, op};
+}
+
+size_t IOUring::_fill_iovecs(Operation &op) {
+    if (op.data.buffers().size() > MAX_IOVECS) {
+        op.data = BufferList{op.data.concatenate()};
+    }
+    size_t n = 0;
+    for (const auto &buf : op.data.buffers()) {
+        op.iovecs[n++] = {const_cast<char *>(buf.str().data()), buf.size()};
+    }
+    return n;
+}
+
+//! \param[in] fd is the fd to write to; it must outlive the next IOUring::submit
+//! \param[in] data is the bytes to write
+void IOUring::write(FileDescriptor &fd, BufferList data) {
+    auto [sqe, op] = _next(fd, move(data));
+    sqe.opcode = IORING_OP_WRITEV;
+    sqe.fd = fd.fd_num();
+    sqe.addr = reinterpret_cast<uint64_t>(op.iovecs.data());
+    sqe.len = _fill_iovecs(op);
+}
+
+//! \param[in] fd is a datagram socket; it must outlive the next IOUring::submit
+//! \param[in] destination is the address to send the datagram to
+//! \param[in] data is the payload of the datagram
+void IOUring::sendto(FileDescriptor &fd, const Address &destination, BufferList data) {
+    auto [sqe, op] = _next(fd, move(data));
+    memcpy(&op.destination, static_cast<const sockaddr *>(destination), destination.size());
+    op.message = {};
+    op.message.msg_name = &op.destination;
+    op.message.msg_namelen = destination.size();
+    op.message.msg_iov = op.iovecs.data();
+    op.message.msg_iovlen = _fill_iovecs(op);
+
+    sqe.opcode = IORING_OP_SENDMSG;
+    sqe.fd = fd.fd_num();
+    sqe.addr = reinterpret_cast<uint64_t>(&op.message);
+    sqe.len = 1;
+}
+
+void IOUring::submit() {
+    if (_queued == 0) {
+        return;
+    }
+
+    // publish the new entries to the kernel
+    __atomic_store_n(_sq_tail, *_sq_tail + _queued, __ATOMIC_RELEASE);
+    unsigned to_submit = _queued;
+    unsigned to_complete = _queued;
+    _queued = 0;
+
+    int error = 0;
+    bool short_write = false;
+    while (to_complete > 0) {
+        const int submitted = io_uring_enter(_ring.fd_num(), to_submit, to_complete);
+        _submissions++;
+        if (submitted < 0) {
+            if (errno == EINTR) {
+                continue;  // nothing was submitted
+            }
+            throw unix_error("io_uring_enter");
+        }
+        to_submit -= min(to_submit, static_cast<unsigned>(submitted));
+
+        // reap the completions
+        unsigned head = *_cq_head;
+        const unsigned tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++, to_complete--) {
+            const io_uring_cqe &cqe = _cqes[head & _cq_mask];
+            Operation &op = _operations.at(cqe.user_data);
+            if (cqe.res < 0) {
+                error = error ? error : -cqe.res;
+            } else {
+                short_write |= static_cast<size_t>(cqe.res) != op.length;
+                op.fd->register_write();
+            }
+            op.data = {};
+            op.fd = nullptr;
+        }
+        __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    if (error) {
+        throw unix_error("io_uring write", error);
+    }
+    if (short_write) {
+        throw runtime_error("IOUring: short write");
+    }
+}
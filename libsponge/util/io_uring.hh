@@ -0,0 +1,131 @@
+#ifndef SPONGE_LIBSPONGE_IO_URING_HH
+#define SPONGE_LIBSPONGE_IO_URING_HH
+
+#include "address.hh"
+#include "buffer.hh"
+#include "file_descriptor.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <utility>
+#include <vector>
+
+// from <linux/io_uring.h>, which is only included by io_uring.cc: it brings in <linux/fs.h>, whose macros
+// (e.g. BLOCK_SIZE) collide with names in the rest of sponge
+struct io_uring_params;
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+//! \brief A minimal [io_uring(7)](\ref man7::io_uring) instance that batches writes: queue any number
+//! of them, then hand them all to the kernel with one system call.
+
+//! Each write is queued with the data to write, which the IOUring keeps alive until the write
+//! has completed. IOUring::submit() submits everything queued and waits for it to finish, so to
+//! the caller a batch behaves like the same writes made one after another with write(2) or
+//! sendmsg(2), on a blocking fd.
+//!
+//! Writes are expected to go to packet fds (UDP sockets, TUN/TAP devices), which write all of a
+//! datagram or nothing; a short write is an error.
+//!
+//! The ring is driven with the raw system calls, without liburing. Kernels without io_uring, or
+//! where it is disabled (e.g. by seccomp or the kernel.io_uring_disabled sysctl), are detected by
+//! IOUring::available(), and callers keep using the plain system calls there.
+//!
+//! Only writes go through the ring; reads, and EventLoop's waiting, do not. EventLoop rules are
+//! readiness callbacks that do their own reads (and are checked for doing so), which a completion
+//! queue cannot drive without changing every rule. Multishot receive needs buffers registered
+//! with the kernel, but a received PacketBuffer block lives as long as the Buffers sharing it (e.g.
+//! in the reassembler) and the pool grows on demand, so the blocks cannot be a fixed registered set.
+//! UDP receives are batched with recvmmsg(2) into pooled blocks instead (UDPSocket::recv_batch), and
+//! TunTapFD::read_packet reads one packet per readv(2), also into a pooled block.
+class IOUring {
+  private:
+    static constexpr size_t MAX_IOVECS = 8;  //!< a write of more pieces than this is copied into one
+
+    //! A queued write and everything the kernel reads while it is in flight
+    struct Operation {
+        BufferList data{};                        //!< the bytes, kept alive until completion
+        std::array<iovec, MAX_IOVECS> iovecs{};  //!< `data`, as the kernel sees it
+        msghdr message{};                         //!< (sendto) the datagram
+        sockaddr_storage destination{};           //!< (sendto) where the datagram goes
+        size_t length{0};                         //!< bytes the write must accept
+        FileDescriptor *fd{nullptr};              //!< the fd written to, to count the write
+    };
+
+    FileDescriptor _ring;  //!< the fd returned by io_uring_setup(2)
+
+    //! \name The rings shared with the kernel
+    //!@{
+    void *_sq_map{nullptr};  //!< submission ring (and completion ring, if the kernel maps them together)
+    size_t _sq_map_size{0};
+    void *_cq_map{nullptr};  //!< completion ring, if mapped separately
+    size_t _cq_map_size{0};
+    io_uring_sqe *_sqes{nullptr};  //!< submission queue entries
+    size_t _sqes_size{0};
+
+    unsigned *_sq_tail{nullptr};
+    unsigned _sq_mask{0};
+    unsigned *_sq_array{nullptr};
+    unsigned *_cq_head{nullptr};
+    unsigned *_cq_tail{nullptr};
+    unsigned _cq_mask{0};
+    io_uring_cqe *_cqes{nullptr};
+    //!@}
+
+    std::vector<Operation> _operations;  //!< one per submission queue entry
+    unsigned _queued{0};                 //!< entries filled in since the last submit()
+    uint64_t _submissions{0};            //!< number of io_uring_enter(2) calls
+
+    //! Set up the ring; `params` is filled in by io_uring_setup(2)
+    IOUring(const unsigned entries, io_uring_params params);
+
+    //! Unmap whichever rings are mapped
+    void _unmap();
+
+    //! The next free entry and its Operation; submits the queue first if it is full
+    std::pair<io_uring_sqe &, Operation &> _next(FileDescriptor &fd, BufferList &&data);
+
+    //! Point `op.iovecs` at `op.data`; returns how many iovecs that took
+    static size_t _fill_iovecs(Operation &op);
+
+  public:
+    //! Whether io_uring can be used on this system (checked once, by setting up a small ring)
+    static bool available();
+
+    //! Set up a ring with room for (at least) `entries` queued writes
+    explicit IOUring(const unsigned entries = 64);
+    ~IOUring();
+
+    //! \name
+    //! The kernel holds pointers into the IOUring, so it can be neither copied nor moved
+
+    //!@{
+    IOUring(const IOUring &other) = delete;
+    IOUring &operator=(const IOUring &other) = delete;
+    IOUring(IOUring &&other) = delete;
+    IOUring &operator=(IOUring &&other) = delete;
+    //!@}
+
+    //! Queue a [writev(2)](\ref man2::writev) of `data` to `fd`
+    void write(FileDescriptor &fd, BufferList data);
+
+    //! Queue a [sendmsg(2)](\ref man2::sendmsg) of the datagram `data` to `destination` on socket `fd`
+    void sendto(FileDescriptor &fd, const Address &destination, BufferList data);
+
+    //! \brief Submit every queued write with one [io_uring_enter(2)](\ref man2::io_uring_enter) and wait
+    //! for them all to complete
+    //! \details Counts each write on its FileDescriptor (see FileDescriptor::write_count), and throws
+    //! unix_error for the first write that failed
+    void submit();
+
+    //! Writes queued and not yet submitted
+    size_t queued() const { return _queued; }
+
+    //! Number of io_uring_enter(2) calls so far (for tests and benchmarks)
+    uint64_t submissions() const { return _submissions; }
+};
+
+#endif  // SPONGE_LIBSPONGE_IO_URING_HH
@@ -0,0 +1,122 @@
+#ifndef SPONGE_LIBSPONGE_IPV4_MAP_HH
+#define SPONGE_LIBSPONGE_IPV4_MAP_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+//! \brief A hash table keyed by raw 32-bit IPv4 addresses.
+
+//! Open addressing with linear probing in a power-of-two array that is kept at most half full, so
+//! a lookup usually reads one or two neighbouring slots. Erasing shifts the following entries of
+//! the probe sequence back instead of leaving tombstones, so lookups never slow down as entries
+//! come and go.
+//!
+//! Pointers returned by find() and insert() are invalidated by the next insert() or erase().
+template <typename V>
+class IPv4Map {
+  private:
+    struct Slot {
+        uint32_t key{0};
+        bool used{false};
+        V value{};
+    };
+    std::vector<Slot> _slots{};
+    size_t _size{0};
+    unsigned _shift{32};  //!< 32 - log2(number of slots)
+
+    static constexpr size_t MIN_SLOTS = 16;
+
+    //! First slot of the probe sequence for `key` (Fibonacci hashing: the top bits of key * 2^32/phi)
+    size_t _home(const uint32_t key) const { return uint32_t(key * 2654435769u) >> _shift; }
+
+    size_t _mask() const { return _slots.size() - 1; }
+
+    //! Index of the slot holding `key`, or of the free slot where it would go
+    size_t _probe(const uint32_t key) const {
+        size_t i = _home(key);
+        while (_slots[i].used and _slots[i].key != key) {
+            i = (i + 1) & _mask();
+        }
+        return i;
+    }
+
+    void _rehash(const size_t nslots) {
+        std::vector<Slot> old(nslots);
+        old.swap(_slots);
+        _shift = 32;
+        for (size_t n = nslots; n > 1; n >>= 1) {
+            _shift--;
+        }
+        for (auto &slot : old) {
+            if (slot.used) {
+                _slots[_probe(slot.key)] = std::move(slot);
+            }
+        }
+    }
+
+  public:
+    //! The value stored for `key`, or `nullptr`
+    V *find(const uint32_t key) {
+        if (_size == 0) {
+            return nullptr;
+        }
+        Slot &slot = _slots[_probe(key)];
+        return slot.used ? &slot.value : nullptr;
+    }
+
+    const V *find(const uint32_t key) const { return const_cast<IPv4Map *>(this)->find(key); }
+
+    //! \brief Store `value` for `key`, unless `key` is already present
+    //! \returns the stored value, and whether it was inserted
+    std::pair<V *, bool> insert(const uint32_t key, V &&value) {
+        if ((_size + 1) * 2 > _slots.size()) {
+            _rehash(_slots.empty() ? MIN_SLOTS : _slots.size() * 2);
+        }
+        Slot &slot = _slots[_probe(key)];
+        if (slot.used) {
+            return {&slot.value, false};
+        }
+        slot.key = key;
+        slot.used = true;
+        slot.value = std::move(value);
+        _size++;
+        return {&slot.value, true};
+    }
+
+    //! \brief Remove `key`
+    //! \returns false if it was not present
+    bool erase(const uint32_t key) {
+        if (_size == 0) {
+            return false;
+        }
+        size_t hole = _probe(key);
+        if (not _slots[hole].used) {
+            return false;
+        }
+
+        // move back every later entry of the probe sequence whose home is not between the hole and itself
+        for (size_t i = (hole + 1) & _mask(); _slots[i].used; i = (i + 1) & _mask()) {
+            const size_t home = _home(_slots[i].key);
+            const bool reachable = hole <= i ? (hole < home and home <= i) : (hole < home or home <= i);
+            if (not reachable) {
+                _slots[hole] = std::move(_slots[i]);
+                hole = i;
+            }
+        }
+        _slots[hole] = Slot{};
+        _size--;
+        return true;
+    }
+
+    //! Number of entries
+    size_t size() const { return _size; }
+
+    bool empty() const { return _size == 0; }
+
+    //! Bytes used by the slot array
+    size_t memory_usage() const { return _slots.size() * sizeof(Slot); }
+};
+
+#endif  // SPONGE_LIBSPONGE_IPV4_MAP_HH
@@ -0,0 +1,131 @@
+#include "packet_buffer.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+//! \brief The blocks of one size of one thread, each either in use or free for reuse.
+
+//! Blocks are never handed back explicitly: a block is free once the pool holds the only
+//! reference to it, i.e. every PacketBuffer and Buffer that shared it has been destroyed (on
+//! whatever thread). Packets are mostly released in the order they were made, so the search
+//! resumes where the last one stopped and usually succeeds at the first block it looks at.
+class BlockPool {
+  private:
+    vector<shared_ptr<string>> _blocks{};
+    size_t _next{0};
+    const size_t _block_size;  //!< size of each block
+    const size_t _max_blocks;  //!< blocks kept for reuse; beyond them, blocks are allocated and freed as needed
+
+  public:
+    BlockPool(const size_t block_size, const size_t max_blocks) : _block_size(block_size), _max_blocks(max_blocks) {}
+
+    shared_ptr<string> get() {
+        for (size_t n = 0; n < _blocks.size(); n++) {
+            auto &block = _blocks[_next];
+            _next = (_next + 1) % _blocks.size();
+            if (block.use_count() == 1) {
+                // the last other owner released the block (with release ordering) before we reuse it
+                atomic_thread_fence(memory_order_acquire);
+                return block;
+            }
+        }
+
+        auto block = make_shared<string>(_block_size, 0);
+        if (_blocks.size() < _max_blocks) {
+            _blocks.push_back(block);
+        }
+        return block;
+    }
+
+    size_t size() const { return _blocks.size(); }
+};
+
+thread_local BlockPool pool{PacketBuffer::BLOCK_SIZE, PacketBuffer::POOL_BLOCKS};
+thread_local BlockPool large_pool{PacketBuffer::LARGE_BLOCK_SIZE, PacketBuffer::POOL_LARGE_BLOCKS};
+
+}  // namespace
+
+//! \param[in] capacity the number of bytes that can be appended without moving the packet
+//! \param[in] headroom the number of bytes that can be prepended without moving the packet
+PacketBuffer::PacketBuffer(const size_t capacity, const size_t headroom) : _begin(headroom), _end(headroom) {
+    if (headroom + capacity <= BLOCK_SIZE) {
+        _block = pool.get();
+    } else if (headroom + capacity <= LARGE_BLOCK_SIZE) {
+        _block = large_pool.get();
+    } else {
+        _block = make_shared<string>(headroom + capacity, 0);
+    }
+}
+
+PacketBuffer::PacketBuffer(PacketBuffer &&other) noexcept
+    : _block(move(other._block)), _begin(exchange(other._begin, 0)), _end(exchange(other._end, 0)) {}
+
+PacketBuffer &PacketBuffer::operator=(PacketBuffer &&other) noexcept {
+    _block = move(other._block);
+    _begin = exchange(other._begin, 0);
+    _end = exchange(other._end, 0);
+    return *this;
+}
+
+void PacketBuffer::_reallocate(const size_t headroom, const size_t tailroom) {
+    PacketBuffer bigger(size() + tailroom, headroom);
+    bigger.append(str());
+    *this = move(bigger);
+}
+
+uint8_t *PacketBuffer::prepend(const size_t n) {
+    if (n > headroom()) {
+        _reallocate(n + HEADROOM, tailroom());
+    }
+    _begin -= n;
+    return data();
+}
+
+uint8_t *PacketBuffer::append(const size_t n) {
+    if (n > tailroom()) {
+        _reallocate(headroom(), n);
+    }
+    uint8_t *const ret = data() + size();
+    _end += n;
+    return ret;
+}
+
+void PacketBuffer::append(const string_view str) { copy(str.begin(), str.end(), append(str.size())); }
+
+void PacketBuffer::remove_prefix(const size_t n) {
+    if (n > size()) {
+        throw out_of_range("PacketBuffer::remove_prefix");
+    }
+    _begin += n;
+}
+
+string_view PacketBuffer::str() const {
+    if (not _block) {
+        return {};
+    }
+    return {_block->data() + _begin, size()};
+}
+
+uint8_t *PacketBuffer::data() { return _block ? reinterpret_cast<uint8_t *>(_block->data()) + _begin : nullptr; }
+
+size_t PacketBuffer::pool_size() { return pool.size(); }
+
+size_t PacketBuffer::large_pool_size() { return large_pool.size(); }
+
+//! \details The Buffer refers to the packet's bytes in the block, without copying them.
+Buffer::Buffer(PacketBuffer &&pkt) noexcept {
+    if (pkt.size() > 0) {
+        _starting_offset = pkt._begin;
+        _ending_offset = pkt._block->size() - pkt._end;
+        _storage = move(pkt._block);
+    }
+    pkt._block.reset();
+    pkt._begin = pkt._end = 0;
+}
@@ -0,0 +1,93 @@
+#ifndef SPONGE_LIBSPONGE_PACKET_BUFFER_HH
+#define SPONGE_LIBSPONGE_PACKET_BUFFER_HH
+
+#include "buffer.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+//! \brief A writable packet in a block with room before it, so that each layer can prepend its header in place.
+
+//! Like a BSD mbuf or a Linux sk_buff: the payload is written once, after `HEADROOM` spare bytes,
+//! and then every enclosing protocol writes its header into the bytes just in front of the data
+//! (e.g. with TCPHeader::serialize_into(pkt.prepend(TCPHeader::LENGTH))). Nothing is copied or
+//! allocated per layer.
+//!
+//! Blocks come from a pool owned by the thread that creates the PacketBuffer (a second, smaller
+//! pool holds the LARGE_BLOCK_SIZE blocks of packets that do not fit in BLOCK_SIZE). Converting to a
+//! Buffer (and from there to a BufferList, an EthernetFrame payload, ...) shares the block, which
+//! goes back to the pool once the last Buffer referring to it is gone, on any thread. In steady
+//! state a packet therefore costs no allocation at all.
+class PacketBuffer {
+  private:
+    friend class Buffer;
+
+    std::shared_ptr<std::string> _block{};  //!< the whole block, including headroom and tailroom
+    size_t _begin{0};                       //!< offset of the first byte of the packet
+    size_t _end{0};                         //!< offset just past the last byte of the packet
+
+    //! Move the packet to a new block with at least `headroom` bytes before it and `tailroom` after it
+    void _reallocate(const size_t headroom, const size_t tailroom);
+
+  public:
+    static constexpr size_t BLOCK_SIZE = 2048;  //!< size of a pooled block: headroom plus an MTU-sized packet
+    static constexpr size_t HEADROOM = 64;      //!< default headroom: Ethernet, IPv4 and TCP headers (54 bytes)
+    static constexpr size_t POOL_BLOCKS = 512;  //!< maximum number of blocks each thread keeps for reuse
+
+    //! size of a block of the second pool, for packets too big for BLOCK_SIZE: any UDP datagram, including one
+    //! coalesced by GRO
+    static constexpr size_t LARGE_BLOCK_SIZE = 65536;
+    static constexpr size_t POOL_LARGE_BLOCKS = 16;  //!< maximum number of large blocks each thread keeps for reuse
+
+    //! \brief An empty packet with room for at least `capacity` bytes after `headroom` bytes
+    //! \note Comes from one of this thread's pools unless `headroom + capacity` exceeds LARGE_BLOCK_SIZE
+    explicit PacketBuffer(const size_t capacity = BLOCK_SIZE - HEADROOM, const size_t headroom = HEADROOM);
+
+    //! \name Moving leaves the other PacketBuffer without a block
+    //!@{
+    PacketBuffer(PacketBuffer &&other) noexcept;
+    PacketBuffer &operator=(PacketBuffer &&other) noexcept;
+    PacketBuffer(const PacketBuffer &other) = delete;
+    PacketBuffer &operator=(const PacketBuffer &other) = delete;
+    ~PacketBuffer() = default;
+    //!@}
+
+    //! \brief Grow the packet by `n` bytes at the front
+    //! \returns the new first byte, for the caller to fill in
+    //! \note Moves the packet to a bigger block if there are fewer than `n` bytes of headroom
+    uint8_t *prepend(const size_t n);
+
+    //! \brief Grow the packet by `n` bytes at the back
+    //! \returns the first of the new bytes, for the caller to fill in
+    uint8_t *append(const size_t n);
+
+    //! \brief Copy `str` to the back of the packet
+    void append(const std::string_view str);
+
+    //! \brief Discard the first `n` bytes (e.g. a header that has been parsed)
+    void remove_prefix(const size_t n);
+
+    //! \name Contents
+    //!@{
+    std::string_view str() const;
+    uint8_t *data();
+    size_t size() const { return _end - _begin; }
+    //!@}
+
+    //! Bytes that can be prepended without moving the packet
+    size_t headroom() const { return _begin; }
+
+    //! Bytes that can be appended without moving the packet
+    size_t tailroom() const { return _block ? _block->size() - _end : 0; }
+
+    //! \brief Number of blocks in this thread's pool, whether in use or free (for tests and benchmarks)
+    static size_t pool_size();
+
+    //! \brief Number of large blocks in this thread's pool, whether in use or free (for tests and benchmarks)
+    static size_t large_pool_size();
+};
+
+#endif  // SPONGE_LIBSPONGE_PACKET_BUFFER_HH
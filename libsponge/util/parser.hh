@@ -60,6 +60,17 @@ class NetParser {
 
     //! Remove n bytes from the buffer
     void remove_prefix(const size_t n);
+
+    //! \name Read an integer in network byte order at `in`, which the caller knows is in bounds
+    //!@{
+    static uint32_t u32(const uint8_t *in) {
+        return (uint32_t(in[0]) << 24) | (uint32_t(in[1]) << 16) | (uint32_t(in[2]) << 8) | in[3];
+    }
+
+    static uint16_t u16(const uint8_t *in) { return (in[0] << 8) | in[1]; }
+
+    static uint8_t u8(const uint8_t *in) { return in[0]; }
+    //!@}
 };
 
 struct NetUnparser {
@@ -74,6 +85,28 @@ struct NetUnparser {
 
     //! Write an 8-bit integer into the data stream in network byte order
     static void u8(std::string &s, const uint8_t val);
+
+    //! \name Write into a caller-provided buffer, returning the position after what was written
+    //!@{
+    static uint8_t *u32(uint8_t *out, const uint32_t val) {
+        out[0] = val >> 24;
+        out[1] = val >> 16;
+        out[2] = val >> 8;
+        out[3] = val;
+        return out + 4;
+    }
+
+    static uint8_t *u16(uint8_t *out, const uint16_t val) {
+        out[0] = val >> 8;
+        out[1] = val;
+        return out + 2;
+    }
+
+    static uint8_t *u8(uint8_t *out, const uint8_t val) {
+        out[0] = val;
+        return out + 1;
+    }
+    //!@}
 };
 
 #endif  // SPONGE_LIBSPONGE_PARSER_HH
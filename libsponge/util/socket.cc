@@ -2,9 +2,18 @@
 
 #include "util.hh"
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <netinet/in.h>
+#include <netinet/udp.h>
 #include <stdexcept>
+#include <sys/uio.h>
+#include <type_traits>
 #include <unistd.h>
+#include <utility>
 
 using namespace std;
 
@@ -84,28 +93,110 @@ void Socket::shutdown(const int how) {
     }
 }
 
-//! \note If `mtu` is too small to hold the received datagram, this method throws a std::runtime_error
-void UDPSocket::recv(received_datagram &datagram, const size_t mtu) {
-    // receive source address and payload
-    Address::Raw datagram_source_address;
-    datagram.payload.resize(mtu);
+//! \name How UDPSocket::_recv and UDPSocket::_recv_batch fill in each kind of payload
+//!@{
+
+//! Make room for `mtu` bytes in `payload`; returns where they start
+static char *payload_space(string &payload, const size_t mtu) {
+    payload.resize(mtu);
+    return payload.data();
+}
+
+static char *payload_space(Buffer &payload, const size_t mtu) {
+    PacketBuffer pkt{mtu, 0};
+    char *const ret = reinterpret_cast<char *>(pkt.append(mtu));
+    payload = Buffer{move(pkt)};
+    return ret;
+}
+
+//! Keep the first `len` bytes of `payload`
+static void payload_truncate(string &payload, const size_t len) { payload.resize(len); }
+
+static void payload_truncate(Buffer &payload, const size_t len) { payload.remove_suffix(payload.size() - len); }
+
+//! \brief Cut `payload` down to the `len` bytes of the datagram that `message` received into it
+//! \details A string payload's `mtu` is the caller's choice, so a longer datagram is reported. A pooled payload's
+//! `mtu` is the size of its block, and the rest of a longer datagram went into an overflow slot (see
+//! UDPSocket::_overflow), so both parts are copied into a block of their own.
+//! \returns whether the datagram was longer than the payload's block
+static bool payload_received(string &payload, const msghdr &message, const size_t len, const char *syscall) {
+    if (len > message.msg_iov[0].iov_len) {
+        throw runtime_error(string(syscall) + " (oversized datagram)");
+    }
+    payload_truncate(payload, len);
+    return false;
+}
+
+static bool payload_received(Buffer &payload, const msghdr &message, const size_t len, const char *syscall) {
+    const iovec &block = message.msg_iov[0];
+    if (len <= block.iov_len) {
+        payload_truncate(payload, len);
+        return false;
+    }
+    if (message.msg_iovlen < 2 or len > block.iov_len + message.msg_iov[1].iov_len) {
+        throw runtime_error(string(syscall) + " (oversized datagram)");
+    }
+    PacketBuffer whole{len, 0};
+    uint8_t *const data = whole.append(len);
+    memcpy(data, block.iov_base, block.iov_len);
+    memcpy(data + block.iov_len, message.msg_iov[1].iov_base, len - block.iov_len);
+    payload = Buffer{move(whole)};
+    return true;
+}
 
-    socklen_t fromlen = sizeof(datagram_source_address);
+//! The `len` bytes of `payload` at `offset`
+static string payload_slice(const string &payload, const size_t offset, const size_t len) {
+    return payload.substr(offset, len);
+}
+
+static Buffer payload_slice(Buffer payload, const size_t offset, const size_t len) {
+    payload.remove_prefix(offset);
+    payload_truncate(payload, min(len, payload.size()));
+    return payload;
+}
+//!@}
+
+//! \details The slots are allocated the first time one is needed, and left uninitialized, so only the pages
+//! that long datagrams are written to ever take up memory.
+char *UDPSocket::_overflow(const size_t i) {
+    if (not _recv_overflow) {
+        _recv_overflow.reset(new char[MAX_BATCH * MAX_DATAGRAM]);
+    }
+    return _recv_overflow.get() + i * MAX_DATAGRAM;
+}
 
-    const ssize_t recv_len = SystemCall(
-        "recvfrom",
-        ::recvfrom(
-            fd_num(), datagram.payload.data(), datagram.payload.size(), MSG_TRUNC, datagram_source_address, &fromlen));
+//! \note If `mtu` is too small to hold the received datagram, a string payload makes this method throw a
+//! std::runtime_error, and a pooled one receives the rest of it into an overflow slot
+template <typename Datagram>
+void UDPSocket::_recv(Datagram &datagram, const size_t mtu) {
+    // receive source address and payload
+    Address::Raw datagram_source_address;
+    array<iovec, 2> iovecs{};
+    iovecs[0] = {payload_space(datagram.payload, mtu), mtu};
 
-    if (recv_len > ssize_t(mtu)) {
-        throw runtime_error("recvfrom (oversized datagram)");
+    msghdr message{};
+    message.msg_name = static_cast<sockaddr *>(datagram_source_address);
+    message.msg_namelen = sizeof(datagram_source_address.storage);
+    message.msg_iov = iovecs.data();
+    message.msg_iovlen = 1;
+    if constexpr (is_same_v<Datagram, received_buffer>) {
+        if (mtu < MAX_DATAGRAM) {
+            iovecs[1] = {_overflow(0), MAX_DATAGRAM - mtu};
+            message.msg_iovlen = 2;
+        }
     }
 
+    const ssize_t recv_len = SystemCall("recvmsg", ::recvmsg(fd_num(), &message, MSG_TRUNC));
+    _oversized += payload_received(datagram.payload, message, recv_len, "recvmsg");
+
     register_read();
-    datagram.source_address = {datagram_source_address, fromlen};
-    datagram.payload.resize(recv_len);
+    datagram.source_address = {datagram_source_address, message.msg_namelen};
 }
 
+void UDPSocket::recv(received_datagram &datagram, const size_t mtu) { _recv(datagram, mtu); }
+
+void UDPSocket::recv(received_buffer &datagram, const size_t mtu) { _recv(datagram, mtu); }
+
 UDPSocket::received_datagram UDPSocket::recv(const size_t mtu) {
     received_datagram ret{{nullptr, 0}, ""};
     recv(ret, mtu);
@@ -141,6 +232,188 @@ void UDPSocket::send(const BufferViewList &payload) {
     register_write();
 }
 
+//! Room for the one control message that UDP GSO and GRO use: the size of the segments
+union SegmentSizeControl {
+    cmsghdr header;
+    char buf[CMSG_SPACE(sizeof(int))];
+};
+
+static constexpr size_t MAX_GSO_SEGMENTS = 64;        //!< UDP_MAX_SEGMENTS on older kernels
+static constexpr size_t MAX_GSO_LENGTH = 65535 - 28;  //!< the largest UDP payload in an IPv4 datagram
+
+//! \returns the size of the datagrams that GRO coalesced into the received `message`, or 0 if it is just one
+static size_t gro_segment_size(msghdr &message) {
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&message); cmsg != nullptr; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+        if (cmsg->cmsg_level == IPPROTO_UDP and cmsg->cmsg_type == UDP_GRO) {
+            int segment_size = 0;
+            memcpy(&segment_size, CMSG_DATA(cmsg), sizeof(segment_size));
+            return segment_size;
+        }
+    }
+    return 0;
+}
+
+//! \note If `mtu` is too small to hold a received datagram, a string payload makes this method throw a
+//! std::runtime_error, and a pooled one receives the rest of it into an overflow slot
+template <typename Datagram>
+void UDPSocket::_recv_batch(vector<Datagram> &datagrams, const size_t n, const size_t mtu) {
+    const size_t count = min(n, MAX_BATCH);
+
+    // Strings are received into the socket's scratch space and copied out at their length, so slots that no
+    // datagram arrives in cost nothing, and the caller's strings keep their capacity from one call to the
+    // next. Pooled payloads are received in place, with an overflow slot after each block.
+    constexpr bool into_scratch = is_same_v<Datagram, received_datagram>;
+    if constexpr (into_scratch) {
+        if (_recv_scratch.size() < count * mtu) {
+            _recv_scratch.resize(count * mtu);
+        }
+    } else {
+        datagrams.resize(count, {{nullptr, 0}, {}});
+    }
+
+    array<mmsghdr, MAX_BATCH> messages{};
+    array<array<iovec, 2>, MAX_BATCH> iovecs{};
+    array<Address::Raw, MAX_BATCH> sources{};
+    array<SegmentSizeControl, MAX_BATCH> controls{};
+    for (size_t i = 0; i < count; i++) {
+        msghdr &message = messages[i].msg_hdr;
+        message.msg_name = static_cast<sockaddr *>(sources[i]);
+        message.msg_namelen = sizeof(sources[i].storage);
+        message.msg_iov = iovecs[i].data();
+        message.msg_iovlen = 1;
+        message.msg_control = controls[i].buf;
+        message.msg_controllen = sizeof(controls[i].buf);
+
+        if constexpr (into_scratch) {
+            iovecs[i][0] = {_recv_scratch.data() + i * mtu, mtu};
+        } else {
+            iovecs[i][0] = {payload_space(datagrams[i].payload, mtu), mtu};
+            if (mtu < MAX_DATAGRAM) {
+                iovecs[i][1] = {_overflow(i), MAX_DATAGRAM - mtu};
+                message.msg_iovlen = 2;
+            }
+        }
+    }
+
+    // MSG_WAITFORONE: wait for the first datagram, then take only what is already queued
+    const size_t received = SystemCall(
+        "recvmmsg", ::recvmmsg(fd_num(), messages.data(), count, MSG_WAITFORONE | MSG_TRUNC, nullptr));
+    datagrams.resize(received, {{nullptr, 0}, {}});
+
+    // fill in each datagram, and note the GRO segment size of each
+    array<size_t, MAX_BATCH> segment_sizes{};
+    for (size_t i = 0; i < received; i++) {
+        const size_t len = messages[i].msg_len;
+        if constexpr (into_scratch) {
+            if (len > mtu) {
+                throw runtime_error("recvmmsg (oversized datagram)");
+            }
+            datagrams[i].payload.assign(_recv_scratch.data() + i * mtu, len);
+        } else {
+            _oversized += payload_received(datagrams[i].payload, messages[i].msg_hdr, len, "recvmmsg");
+        }
+        register_read();
+        datagrams[i].source_address = {sources[i], messages[i].msg_hdr.msg_namelen};
+        segment_sizes[i] = gro_segment_size(messages[i].msg_hdr);
+    }
+
+    // split coalesced datagrams, from the back so that the indices of the ones not yet split stay put
+    for (size_t i = received; i-- > 0;) {
+        const size_t segment_size = segment_sizes[i];
+        auto &payload = datagrams[i].payload;
+        if (segment_size == 0 or payload.size() <= segment_size) {
+            continue;
+        }
+        vector<Datagram> pieces;
+        for (size_t offset = segment_size; offset < payload.size(); offset += segment_size) {
+            register_read();
+            pieces.push_back({datagrams[i].source_address, payload_slice(payload, offset, segment_size)});
+        }
+        payload_truncate(payload, segment_size);
+        datagrams.insert(
+            datagrams.begin() + i + 1, make_move_iterator(pieces.begin()), make_move_iterator(pieces.end()));
+    }
+}
+
+void UDPSocket::recv_batch(vector<received_datagram> &datagrams, const size_t n, const size_t mtu) {
+    _recv_batch(datagrams, n, mtu);
+}
+
+void UDPSocket::recv_batch(vector<received_buffer> &datagrams, const size_t n, const size_t mtu) {
+    _recv_batch(datagrams, n, mtu);
+}
+
+void UDPSocket::send_batch(const Address &destination, const vector<BufferList> &payloads, const bool gso) {
+    size_t nbuffers = 0;
+    for (const auto &payload : payloads) {
+        nbuffers += payload.buffers().size();
+    }
+
+    // the messages point into these, so they must not reallocate
+    vector<iovec> iovecs;
+    iovecs.reserve(nbuffers);
+    vector<SegmentSizeControl> controls;
+    controls.reserve(payloads.size());
+
+    vector<mmsghdr> messages;
+    vector<size_t> lengths;                // bytes in each message
+    vector<size_t> datagrams_per_message;  // datagrams the kernel splits each message into
+    for (size_t first = 0; first < payloads.size();) {
+        // with GSO, extend the message over the run of payloads that the kernel can split back apart
+        const size_t segment_size = payloads[first].size();
+        size_t end = first + 1;
+        size_t length = segment_size;
+        while (gso and segment_size > 0 and end < payloads.size() and end - first < MAX_GSO_SEGMENTS and
+               payloads[end - 1].size() == segment_size and payloads[end].size() <= segment_size and
+               length + payloads[end].size() <= MAX_GSO_LENGTH) {
+            length += payloads[end].size();
+            end++;
+        }
+
+        mmsghdr message{};
+        message.msg_hdr.msg_name = const_cast<sockaddr *>(static_cast<const sockaddr *>(destination));
+        message.msg_hdr.msg_namelen = destination.size();
+        message.msg_hdr.msg_iov = iovecs.data() + iovecs.size();
+        for (size_t i = first; i < end; i++) {
+            for (const auto &buf : payloads[i].buffers()) {
+                iovecs.push_back({const_cast<char *>(buf.str().data()), buf.size()});
+            }
+        }
+        message.msg_hdr.msg_iovlen = iovecs.data() + iovecs.size() - message.msg_hdr.msg_iov;
+
+        if (end - first > 1) {
+            controls.emplace_back();
+            cmsghdr &cmsg = controls.back().header;
+            cmsg.cmsg_level = IPPROTO_UDP;
+            cmsg.cmsg_type = UDP_SEGMENT;
+            cmsg.cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            const uint16_t gso_size = segment_size;
+            memcpy(CMSG_DATA(&cmsg), &gso_size, sizeof(gso_size));
+            message.msg_hdr.msg_control = controls.back().buf;
+            message.msg_hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+        }
+
+        messages.push_back(message);
+        lengths.push_back(length);
+        datagrams_per_message.push_back(end - first);
+        first = end;
+    }
+
+    for (size_t sent = 0; sent < messages.size();) {
+        const size_t n =
+            SystemCall("sendmmsg", ::sendmmsg(fd_num(), messages.data() + sent, messages.size() - sent, 0));
+        for (size_t i = sent; i < sent + n; i++) {
+            if (messages[i].msg_len != lengths[i]) {
+                throw runtime_error("datagram payload too big for sendmmsg()");
+            }
+            for (size_t j = 0; j < datagrams_per_message[i]; j++) {
+                register_write();
+            }
+        }
+        sent += n;
+    }
+}
+
 // mark the socket as listening for incoming connections
 //! \param[in] backlog is the number of waiting connections to queue (see [listen(2)](\ref man2::listen))
 void TCPSocket::listen(const int backlog) { SystemCall("listen", ::listen(fd_num(), backlog)); }
@@ -166,3 +439,6 @@ void Socket::setsockopt(const int level, const int option, const option_type &op
 // allow local address to be reused sooner, at the cost of some robustness
 //! \note Using `SO_REUSEADDR` may reduce the robustness of your application
 void Socket::set_reuseaddr() { setsockopt(SOL_SOCKET, SO_REUSEADDR, int(true)); }
+
+//! \param[in] enable is whether the kernel may coalesce received datagrams
+void UDPSocket::set_gro(const bool enable) { setsockopt(IPPROTO_UDP, UDP_GRO, int(enable)); }
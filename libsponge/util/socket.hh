@@ -2,12 +2,17 @@
 #define SPONGE_LIBSPONGE_SOCKET_HH
 
 #include "address.hh"
+#include "buffer.hh"
 #include "file_descriptor.hh"
+#include "packet_buffer.hh"
 
+#include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
 #include <sys/socket.h>
+#include <vector>
 
 //! \brief Base class for network sockets (TCP, UDP, etc.)
 //! \details Socket is generally used via a subclass. See TCPSocket and UDPSocket for usage examples.
@@ -49,12 +54,36 @@ class Socket : public FileDescriptor {
 
 //! A wrapper around [UDP sockets](\ref man7::udp)
 class UDPSocket : public Socket {
+  private:
+    //! \name The receive functions, for either kind of payload
+    //!@{
+    template <typename Datagram>
+    void _recv(Datagram &datagram, const size_t mtu);
+
+    template <typename Datagram>
+    void _recv_batch(std::vector<Datagram> &datagrams, const size_t n, const size_t mtu);
+    //!@}
+
+    size_t _oversized{0};  //!< datagrams too long for the pooled blocks they were received into
+
+    //! Where recv_batch() receives string payloads, before copying out the bytes each datagram holds
+    std::string _recv_scratch{};
+
+    //! MAX_BATCH slots of MAX_DATAGRAM bytes, for whatever of each datagram does not fit its pooled block
+    std::unique_ptr<char[]> _recv_overflow{};
+
+    //! The overflow slot for the `i`th datagram of a batch
+    char *_overflow(const size_t i);
+
   protected:
     //! \brief Construct from FileDescriptor (used by TCPOverUDPSocketAdapter)
     //! \param[in] fd is the FileDescriptor from which to construct
     explicit UDPSocket(FileDescriptor &&fd) : Socket(std::move(fd), AF_INET, SOCK_DGRAM) {}
 
   public:
+    static constexpr size_t MAX_BATCH = 64;         //!< Most datagrams recv_batch() asks the kernel for at once
+    static constexpr size_t MAX_DATAGRAM = 65536;  //!< More than the longest UDP payload
+
     //! Default: construct an unbound, unconnected UDP socket
     UDPSocket() : Socket(AF_INET, SOCK_DGRAM) {}
 
@@ -70,11 +99,54 @@ class UDPSocket : public Socket {
     //! Receive a datagram and the Address of its sender (caller can allocate storage)
     void recv(received_datagram &datagram, const size_t mtu = 65536);
 
+    //! \brief Like received_datagram, but with the payload in a block from the PacketBuffer pool
+    //! \details The block goes back to the pool once the last Buffer sharing it (e.g. the payload of a
+    //! TCPSegment parsed from this one) is gone, so in steady state receiving allocates nothing.
+    struct received_buffer {
+        Address source_address;  //!< Address from which this datagram was received
+        Buffer payload;          //!< UDP datagram payload
+    };
+
+    //! \brief Receive a datagram into a pooled block, and the Address of its sender
+    //! \details A datagram longer than `mtu` is still received whole: the rest of it goes into an overflow
+    //! slot that the socket keeps, and the datagram is then copied into a block of its own (see oversized()).
+    //! \note The block is pooled only if `mtu` (or the length of a longer datagram) is at most
+    //! PacketBuffer::LARGE_BLOCK_SIZE
+    void recv(received_buffer &datagram, const size_t mtu = PacketBuffer::BLOCK_SIZE);
+
     //! Send a datagram to specified Address
     void sendto(const Address &destination, const BufferViewList &payload);
 
     //! Send datagram to the socket's connected address (must call connect() first)
     void send(const BufferViewList &payload);
+
+    //! \brief Receive up to `n` (at most MAX_BATCH) datagrams with one [recvmmsg(2)](\ref man2::recvmmsg)
+    //! \details Blocks (on a blocking socket) only until the first datagram arrives. `datagrams` is resized to
+    //! the number received. A datagram coalesced by GRO (see set_gro()) is split back into the datagrams that
+    //! were sent, so there can be more than `n` of them. The datagrams are received into a scratch area of
+    //! `n` * `mtu` bytes that the socket keeps, and only their bytes are copied into the payloads, which keep
+    //! their capacity when `datagrams` is passed again.
+    void recv_batch(std::vector<received_datagram> &datagrams, const size_t n, const size_t mtu = 65536);
+
+    //! \brief Like recv_batch(), but into pooled blocks as recv(received_buffer &) does
+    //! \details The datagrams split from one that GRO coalesced share its block; none of them is copied.
+    //! Datagrams longer than `mtu` are received whole, as recv(received_buffer &) receives them.
+    void recv_batch(std::vector<received_buffer> &datagrams,
+                    const size_t n,
+                    const size_t mtu = PacketBuffer::BLOCK_SIZE);
+
+    //! \brief Send each of `payloads` as a datagram to `destination`, with one [sendmmsg(2)](\ref man2::sendmmsg)
+    //! \details With `gso`, each run of equal-sized payloads (the last may be shorter) goes to the kernel as one
+    //! UDP GSO datagram, which it splits into the individual datagrams (see UDP_SEGMENT in [udp(7)](\ref man7::udp))
+    void send_batch(const Address &destination, const std::vector<BufferList> &payloads, const bool gso = false);
+
+    //! \brief Let the kernel coalesce a run of received datagrams into one, with UDP_GRO
+    //! \note Only recv_batch() splits them again
+    void set_gro(const bool enable);
+
+    //! Datagrams that the pooled recv() and recv_batch() copied into a block of their own, for being longer than
+    //! their `mtu`
+    size_t oversized() const { return _oversized; }
 };
 
 //! \class UDPSocket
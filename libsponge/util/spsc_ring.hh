@@ -0,0 +1,66 @@
+#ifndef SPONGE_LIBSPONGE_SPSC_RING_HH
+#define SPONGE_LIBSPONGE_SPSC_RING_HH
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+//! \brief A bounded single-producer, single-consumer queue that needs no lock.
+
+//! One thread may call push() while another calls pop(). The producer only writes `_tail` and the
+//! consumer only writes `_head`, each on its own cache line, so the two threads share nothing
+//! but the slots they hand over.
+template <typename T>
+class SPSCRing {
+  private:
+    std::vector<T> _slots;
+    const size_t _mask;
+    alignas(64) std::atomic<size_t> _head{0};  //!< index of the next slot to pop, written by the consumer
+    alignas(64) std::atomic<size_t> _tail{0};  //!< index of the next slot to push, written by the producer
+
+    static size_t _round_up(const size_t capacity) {
+        size_t ret = 1;
+        while (ret < capacity) {
+            ret <<= 1;
+        }
+        return ret;
+    }
+
+  public:
+    //! \param[in] capacity the number of elements the ring can hold, rounded up to a power of two
+    explicit SPSCRing(const size_t capacity) : _slots(_round_up(capacity)), _mask(_slots.size() - 1) {}
+
+    //! \brief Append `value` (producer only)
+    //! \returns false, leaving `value` untouched, if the ring is full
+    bool push(T &&value) {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head.load(std::memory_order_acquire) == _slots.size()) {
+            return false;
+        }
+        _slots[tail & _mask] = std::move(value);
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    //! \brief Remove the oldest element (consumer only)
+    //! \returns the element, or empty if the ring is empty
+    std::optional<T> pop() {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire)) {
+            return std::nullopt;
+        }
+        std::optional<T> ret{std::move(_slots[head & _mask])};
+        _head.store(head + 1, std::memory_order_release);
+        return ret;
+    }
+
+    //! \note Only a hint while the other thread is running
+    bool empty() const { return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire); }
+
+    //! Maximum number of elements
+    size_t capacity() const { return _slots.size(); }
+};
+
+#endif  // SPONGE_LIBSPONGE_SPSC_RING_HH
@@ -2,18 +2,40 @@
 
 #include "util.hh"
 
+#include <array>
+#include <cstdint>
 #include <cstring>
 #include <fcntl.h>
 #include <linux/if.h>
 #include <linux/if_tun.h>
+#include <stdexcept>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <utility>
 
 static constexpr const char *CLONEDEV = "/dev/net/tun";
 
+//! The header in front of each packet of a device opened with IFF_VNET_HDR (`struct virtio_net_hdr`
+//! from <linux/virtio_net.h>, which can't be included from C++ because it has a field named `class`)
+struct VirtioNetHeader {
+    uint8_t flags;
+    uint8_t gso_type;
+    uint16_t hdr_len;
+    uint16_t gso_size;
+    uint16_t csum_start;
+    uint16_t csum_offset;
+};
+static_assert(sizeof(VirtioNetHeader) == 10);
+
+static constexpr uint8_t VIRTIO_NET_HDR_F_NEEDS_CSUM = 1;  //!< the checksum is partial: the packet comes from this host
+static constexpr uint8_t VIRTIO_NET_HDR_F_DATA_VALID = 2;  //!< the checksums have been checked
+
 using namespace std;
 
 //! \param[in] devname is the name of the TUN or TAP device, specified at its creation.
 //! \param[in] is_tun is `true` for a TUN device (expects IP datagrams), or `false` for a TAP device (expects Ethernet frames)
+//! \param[in] checksum_offload asks the kernel to put a virtio-net header in front of each packet, saying whether
+//! it has already checked the packet's checksums (and to leave them to us when the packet comes from this host)
 //!
 //! To create a TUN device, you should already have run
 //!
@@ -21,11 +43,14 @@ using namespace std;
 //!
 //! as root before calling this function.
 
-TunTapFD::TunTapFD(const string &devname, const bool is_tun)
-    : FileDescriptor(SystemCall("open", open(CLONEDEV, O_RDWR))) {
+TunTapFD::TunTapFD(const string &devname, const bool is_tun, const bool checksum_offload)
+    : FileDescriptor(SystemCall("open", open(CLONEDEV, O_RDWR))), _checksum_offload(checksum_offload) {
     struct ifreq tun_req {};
 
     tun_req.ifr_flags = (is_tun ? IFF_TUN : IFF_TAP) | IFF_NO_PI;  // tun device with no packetinfo
+    if (checksum_offload) {
+        tun_req.ifr_flags |= IFF_VNET_HDR;
+    }
 
     // copy devname to ifr_name, making sure to null terminate
 
@@ -33,4 +58,81 @@ TunTapFD::TunTapFD(const string &devname, const bool is_tun)
     tun_req.ifr_name[IFNAMSIZ - 1] = '\0';
 
     SystemCall("ioctl", ioctl(fd_num(), TUNSETIFF, static_cast<void *>(&tun_req)));
+
+    if (checksum_offload) {
+        SystemCall("ioctl", ioctl(fd_num(), TUNSETOFFLOAD, TUN_F_CSUM));
+    }
+}
+
+//! \details The slot is allocated the first time it is needed, and left uninitialized, so only the pages that
+//! long packets are written to ever take up memory.
+char *TunTapFD::_overflow() {
+    if (not _read_overflow) {
+        _read_overflow.reset(new char[MAX_PACKET]);
+    }
+    return _read_overflow.get();
+}
+
+//! \details The packet is read with one [readv(2)](\ref man2::readv): the virtio-net header (if any) on its own, then
+//! the packet into a block from the PacketBuffer pool, after the usual headroom, and whatever does not fit the block
+//! into an overflow slot. A packet that spills into the slot is copied into a block of its own.
+TunTapFD::Packet TunTapFD::read_packet() {
+    VirtioNetHeader vnet_hdr{};
+    PacketBuffer pkt{};
+    const size_t room = pkt.tailroom();
+    uint8_t *const data = pkt.append(room);
+
+    array<iovec, 3> iovecs{};
+    size_t iovcnt = 0;
+    if (_checksum_offload) {
+        iovecs[iovcnt++] = {&vnet_hdr, sizeof(vnet_hdr)};
+    }
+    iovecs[iovcnt++] = {data, room};
+    iovecs[iovcnt++] = {_overflow(), MAX_PACKET - room};
+
+    const size_t bytes_read = SystemCall("readv", ::readv(fd_num(), iovecs.data(), iovcnt));
+    register_read();
+
+    const size_t header_len = _checksum_offload ? sizeof(vnet_hdr) : 0;
+    if (bytes_read < header_len) {
+        throw runtime_error("TunTapFD: packet is shorter than a virtio-net header");
+    }
+    const size_t len = bytes_read - header_len;
+
+    Packet ret{Buffer{move(pkt)}, false};
+    if (len <= room) {
+        ret.data.remove_suffix(room - len);
+    } else {
+        PacketBuffer whole{len};
+        uint8_t *const whole_data = whole.append(len);
+        memcpy(whole_data, data, room);
+        memcpy(whole_data + room, _read_overflow.get(), len - room);
+        ret.data = Buffer{move(whole)};
+    }
+    if (not _checksum_offload) {
+        return ret;
+    }
+
+    // DATA_VALID: the kernel (or the NIC) has checked the checksums; NEEDS_CSUM: the packet was made on
+    // this host and its checksum is only partial, which is fine because it never crossed a wire
+    ret.checksums_valid = vnet_hdr.flags & (VIRTIO_NET_HDR_F_DATA_VALID | VIRTIO_NET_HDR_F_NEEDS_CSUM);
+    return ret;
+}
+
+void TunTapFD::_prepend_vnet_header(PacketBuffer &pkt) const {
+    if (_checksum_offload) {
+        // no flags and no segmentation: our checksums are complete
+        const VirtioNetHeader vnet_hdr{};
+        memcpy(pkt.prepend(sizeof(vnet_hdr)), &vnet_hdr, sizeof(vnet_hdr));
+    }
+}
+
+void TunTapFD::write_packet(PacketBuffer &&pkt) {
+    _prepend_vnet_header(pkt);
+    write(pkt.str());
+}
+
+void TunTapFD::write_packet(PacketBuffer &&pkt, IOUring &ring) {
+    _prepend_vnet_header(pkt);
+    ring.write(*this, Buffer{move(pkt)});
 }
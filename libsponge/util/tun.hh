@@ -1,22 +1,64 @@
 #ifndef SPONGE_LIBSPONGE_TUN_HH
 #define SPONGE_LIBSPONGE_TUN_HH
 
+#include "buffer.hh"
 #include "file_descriptor.hh"
+#include "io_uring.hh"
+#include "packet_buffer.hh"
 
+#include <cstddef>
+#include <memory>
 #include <string>
 
 //! A FileDescriptor to a [Linux TUN/TAP](https://www.kernel.org/doc/Documentation/networking/tuntap.txt) device
 class TunTapFD : public FileDescriptor {
+  private:
+    bool _checksum_offload;  //!< every packet is preceded by a virtio-net header
+
+    //! More than the longest IP datagram (TUN) or Ethernet frame (TAP) that a device can hand over
+    static constexpr size_t MAX_PACKET = 65536 + 64;
+
+    //! MAX_PACKET bytes, for whatever of a packet read_packet() reads does not fit its pooled block
+    std::unique_ptr<char[]> _read_overflow{};
+
+    //! The overflow slot
+    char *_overflow();
+
+    //! Prepend the virtio-net header that the device expects, if it has checksum offload
+    void _prepend_vnet_header(PacketBuffer &pkt) const;
+
   public:
     //! Open an existing persistent [TUN or TAP device](https://www.kernel.org/doc/Documentation/networking/tuntap.txt).
-    explicit TunTapFD(const std::string &devname, const bool is_tun);
+    explicit TunTapFD(const std::string &devname, const bool is_tun, const bool checksum_offload = false);
+
+    //! A packet read from the device
+    struct Packet {
+        Buffer data{};                //!< the IP datagram (TUN) or Ethernet frame (TAP)
+        bool checksums_valid{false};  //!< the kernel vouches for the packet's checksums (checksum offload only)
+    };
+
+    //! \brief Read one packet, without its virtio-net header if the device has checksum offload
+    //! \details The packet is received into a block from the PacketBuffer pool, as UDPSocket::recv(received_buffer &)
+    //! receives a datagram, so in steady state reading allocates nothing.
+    Packet read_packet();
+
+    //! \brief Write one packet, after a virtio-net header if the device has checksum offload
+    //! \note The virtio-net header goes in the packet's headroom, so the packet is still written with one write(2)
+    void write_packet(PacketBuffer &&pkt);
+
+    //! \brief Queue one packet on `ring`, as write_packet() would write it
+    void write_packet(PacketBuffer &&pkt, IOUring &ring);
+
+    //! \brief Whether the device was opened with checksum offload
+    bool checksum_offload() const { return _checksum_offload; }
 };
 
 //! A FileDescriptor to a [Linux TUN](https://www.kernel.org/doc/Documentation/networking/tuntap.txt) device
 class TunFD : public TunTapFD {
   public:
     //! Open an existing persistent [TUN device](https://www.kernel.org/doc/Documentation/networking/tuntap.txt).
-    explicit TunFD(const std::string &devname) : TunTapFD(devname, true) {}
+    explicit TunFD(const std::string &devname, const bool checksum_offload = false)
+        : TunTapFD(devname, true, checksum_offload) {}
 };
 
 //! A FileDescriptor to a [Linux TAP](https://www.kernel.org/doc/Documentation/networking/tuntap.txt) device
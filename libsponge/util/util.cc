@@ -1,13 +1,20 @@
 #include "util.hh"
 
+#include <arpa/inet.h>
 #include <array>
 #include <cctype>
 #include <chrono>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <sys/socket.h>
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SPONGE_CHECKSUM_X86 1
+#include <immintrin.h>
+#endif
+
 using namespace std;
 
 //! \returns the number of milliseconds since the program started
@@ -86,15 +93,176 @@ mt19937 get_random_generator() {
 //! on the Internet checksum, and consult the [IP](\ref rfc::rfc791) and [TCP](\ref rfc::rfc793) RFCs.
 InternetChecksum::InternetChecksum(const uint32_t initial_sum) : _sum(initial_sum) {}
 
+namespace {
+
+//! A function that sums `len` bytes as 16-bit words in host byte order, with end-around carry.
+//! The result only needs to be congruent to the true sum modulo 0xffff.
+using SumWords = uint64_t (*)(const uint8_t *data, size_t len);
+
+uint64_t add_with_carry(const uint64_t a, const uint64_t b) {
+    const uint64_t sum = a + b;
+    return sum + (sum < b);
+}
+
+uint16_t fold16(uint64_t sum) {
+    while (sum > 0xffff) {
+        sum = (sum >> 16) + (sum & 0xffff);
+    }
+    return sum;
+}
+
+//! \details Eight bytes at a time: 2^64 - 1 is a multiple of 2^16 - 1, so a 64-bit end-around-carry
+//! sum is congruent to the 16-bit one.
+uint64_t sum_words_scalar(const uint8_t *data, size_t len) {
+    uint64_t sum = 0;
+    for (; len >= 8; data += 8, len -= 8) {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        sum = add_with_carry(sum, word);
+    }
+
+    // the tail lands in the same lanes a full load would put it in, so an odd last byte
+    // ends up as the first (high-order) byte of its word
+    uint64_t tail = 0;
+    memcpy(&tail, data, len);
+    return add_with_carry(sum, tail);
+}
+
+#ifdef SPONGE_CHECKSUM_X86
+//! Blocks summed into 32-bit lanes before they are flushed; each block adds at most 2 * 0xffff per lane
+constexpr size_t SIMD_BLOCKS_PER_FLUSH = 16384;
+
+[[gnu::target("sse2")]] uint64_t sum_words_sse2(const uint8_t *data, size_t len) {
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t sum = 0;
+    while (len >= 16) {
+        const size_t blocks = min(len / 16, SIMD_BLOCKS_PER_FLUSH);
+        __m128i acc = zero;
+        for (size_t i = 0; i < blocks; i++, data += 16) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+            acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(v, zero));
+            acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(v, zero));
+        }
+        len -= blocks * 16;
+
+        array<uint32_t, 4> lanes{};
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes.data()), acc);
+        for (const uint32_t lane : lanes) {
+            sum += lane;
+        }
+    }
+    return add_with_carry(sum, sum_words_scalar(data, len));
+}
+
+[[gnu::target("avx2")]] uint64_t sum_words_avx2(const uint8_t *data, size_t len) {
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t sum = 0;
+    while (len >= 32) {
+        const size_t blocks = min(len / 32, SIMD_BLOCKS_PER_FLUSH);
+        __m256i acc = zero;
+        for (size_t i = 0; i < blocks; i++, data += 32) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data));
+            acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(v, zero));
+            acc = _mm256_add_epi32(acc, _mm256_unpackhi_epi16(v, zero));
+        }
+        len -= blocks * 32;
+
+        array<uint32_t, 8> lanes{};
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes.data()), acc);
+        for (const uint32_t lane : lanes) {
+            sum += lane;
+        }
+    }
+    return add_with_carry(sum, sum_words_scalar(data, len));
+}
+#endif
+
+struct ChecksumKernel {
+    const char *name;
+    SumWords sum_words;
+    bool (*supported)();
+};
+
+//! All implementations, slowest first
+const array CHECKSUM_KERNELS{
+    ChecksumKernel{"scalar", sum_words_scalar, [] { return true; }},
+#ifdef SPONGE_CHECKSUM_X86
+    ChecksumKernel{"sse2", sum_words_sse2, [] { return bool(__builtin_cpu_supports("sse2")); }},
+    ChecksumKernel{"avx2", sum_words_avx2, [] { return bool(__builtin_cpu_supports("avx2")); }},
+#endif
+};
+
+//! The implementation used by InternetChecksum::add, chosen on first use
+SumWords &selected_kernel() {
+    static SumWords kernel = [] {
+#ifdef SPONGE_CHECKSUM_X86
+        __builtin_cpu_init();
+#endif
+        SumWords fastest = sum_words_scalar;
+        for (const auto &k : CHECKSUM_KERNELS) {
+            if (k.supported()) {
+                fastest = k.sum_words;
+            }
+        }
+        return fastest;
+    }();
+    return kernel;
+}
+
+}  // namespace
+
+//! \details Bytes are summed as 16-bit words by the fastest kernel the CPU supports. The kernels sum
+//! in host byte order; the ones' complement sum of byte-swapped words is the byte-swapped sum
+//! ([RFC 1071](\ref rfc::rfc1071)), so one swap at the end gives the network-order sum.
+//! A chunk that starts at an odd offset in the checksummed data first completes the pending word.
 void InternetChecksum::add(std::string_view data) {
-    for (size_t i = 0; i < data.size(); i++) {
-        uint16_t val = uint8_t(data[i]);
-        if (not _parity) {
-            val <<= 8;
+    const auto *bytes = reinterpret_cast<const uint8_t *>(data.data());
+    size_t len = data.size();
+    uint64_t sum = _sum;
+
+    if (_parity and len > 0) {
+        sum += bytes[0];
+        bytes++;
+        len--;
+        _parity = false;
+    }
+
+    if (len > 0) {
+        sum += ntohs(fold16(selected_kernel()(bytes, len)));
+        _parity = len % 2 == 1;
+    }
+
+    // keep the sum exact while it fits, otherwise fold with end-around carry
+    while (sum > 0xffffffff) {
+        sum = (sum >> 32) + (sum & 0xffffffff);
+    }
+    _sum = sum;
+}
+
+//! \details HC' = ~(~HC + ~m + m'). Unlike HC' = HC - ~m - m' (eqn. 2), this never produces
+//! 0xffff (-0) where a full recomputation would produce 0x0000.
+uint16_t InternetChecksum::adjust(const uint16_t cksum, const uint16_t old_word, const uint16_t new_word) {
+    return ~fold16(uint32_t(uint16_t(~cksum)) + uint16_t(~old_word) + new_word);
+}
+
+vector<string> InternetChecksum::kernels() {
+    vector<string> ret;
+    for (const auto &k : CHECKSUM_KERNELS) {
+        if (k.supported()) {
+            ret.emplace_back(k.name);
+        }
+    }
+    return ret;
+}
+
+bool InternetChecksum::use_kernel(const string &name) {
+    for (const auto &k : CHECKSUM_KERNELS) {
+        if (name == k.name and k.supported()) {
+            selected_kernel() = k.sum_words;
+            return true;
         }
-        _sum += val;
-        _parity = !_parity;
     }
+    return false;
 }
 
 uint16_t InternetChecksum::value() const {
@@ -61,6 +61,17 @@ class InternetChecksum {
     InternetChecksum(const uint32_t initial_sum = 0);
     void add(std::string_view data);
     uint16_t value() const;
+
+    //! \brief Checksum after one 16-bit word of the checksummed data changes from `old_word` to `new_word`
+    //! ([RFC 1624](\ref rfc::rfc1624), eqn. 3), without summing the data again
+    static uint16_t adjust(const uint16_t cksum, const uint16_t old_word, const uint16_t new_word);
+
+    //! Names of the implementations of add() that this CPU supports, fastest last
+    static std::vector<std::string> kernels();
+
+    //! Make add() use the named implementation (for tests and benchmarks; not thread-safe)
+    //! \returns `false` if there is no such implementation or the CPU doesn't support it
+    static bool use_kernel(const std::string &name);
 };
 
 //! Hexdump the contents of a packet (or any other sequence of bytes)
@@ -0,0 +1,70 @@
+#include "byte_stream.hh"
+#include "test_should_be.hh"
+
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        // moving a string into a chunked stream and reading it back as Buffers makes no copies
+        {
+            ByteStream bs{64, true};
+            string data = "hello, world, this is a long string";
+            const char *storage = data.data();
+
+            test_should_be(bs.write(move(data)), size_t(35));
+            test_should_be(bs.buffer_size(), size_t(35));
+
+            BufferList out = bs.read_buffers(5);
+            test_should_be(out.size(), size_t(5));
+            test_should_be(out.concatenate() == "hello", true);
+            test_should_be(Buffer(out).str().data() == storage, true);
+
+            out = bs.read_buffers(100);
+            test_should_be(out.concatenate() == ", world, this is a long string", true);
+            test_should_be(Buffer(out).str().data() == storage + 5, true);
+
+            test_should_be(bs.copy_count(), size_t(0));
+            test_should_be(bs.bytes_read(), size_t(35));
+            test_should_be(bs.buffer_empty(), true);
+        }
+
+        // a Buffer that does not fit is trimmed to the remaining capacity, still without a copy
+        {
+            ByteStream bs{8, true};
+            test_should_be(bs.write(Buffer{string("abcdef")}), size_t(6));
+            test_should_be(bs.write(Buffer{string("ghijkl")}), size_t(2));
+            test_should_be(bs.remaining_capacity(), size_t(0));
+            test_should_be(bs.peek_buffers(100).size(), size_t(8));
+
+            BufferList out = bs.read_buffers(7);
+            test_should_be(out.buffers().size(), size_t(2));
+            test_should_be(out.concatenate() == "abcdefg", true);
+            test_should_be(bs.read(1) == "h", true);
+
+            test_should_be(bs.copy_count(), size_t(1));
+        }
+
+        // writes from a const std::string& are copied once, in either mode
+        {
+            ByteStream chunked{8, true};
+            ByteStream ring{8};
+            const string data = "cat";
+
+            chunked.write(data);
+            ring.write(data);
+
+            test_should_be(chunked.copy_count(), size_t(1));
+            test_should_be(ring.copy_count(), size_t(1));
+            test_should_be(chunked.read(3) == ring.read(3), true);
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
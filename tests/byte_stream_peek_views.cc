@@ -0,0 +1,62 @@
+#include "byte_stream.hh"
+#include "byte_stream_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main() {
+    try {
+        {
+            ByteStreamTestHarness test{"peek-views-contiguous", 15};
+
+            test.execute(PeekViews{"", 0});
+
+            test.execute(Write{"cat"});
+
+            test.execute(PeekViews{"cat", 1});
+            test.execute(PeekViews{"ca", 1});
+            test.execute(Peek{"cat"});
+        }
+
+        {
+            ByteStreamTestHarness test{"peek-views-wrap-around", 8};
+
+            test.execute(Write{"abcdef"});
+            test.execute(Pop{4});
+            test.execute(Write{"ghijkl"});
+
+            test.execute(BufferSize{8});
+            test.execute(RemainingCapacity{0});
+            test.execute(PeekViews{"efgh", 1});
+            test.execute(PeekViews{"efghij", 2});
+            test.execute(PeekViews{"efghijkl", 2});
+            test.execute(Peek{"efghijkl"});
+
+            test.execute(Pop{4});
+
+            test.execute(PeekViews{"ijkl", 1});
+
+            test.execute(Write{"mno"});
+
+            test.execute(PeekViews{"ijklmno", 1});
+            test.execute(BytesRead{8});
+            test.execute(BytesWritten{15});
+        }
+
+        {
+            ByteStreamTestHarness test{"peek-views-zero-capacity", 0};
+
+            test.execute(Write{"cat"});
+
+            test.execute(BytesWritten{0});
+            test.execute(PeekViews{"", 0});
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
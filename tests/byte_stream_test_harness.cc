@@ -46,7 +46,7 @@ void ByteStreamAction::execute(ByteStream &) const {}
 ByteStreamAction::~ByteStreamAction() {}
 
 ByteStreamTestHarness::ByteStreamTestHarness(const std::string &test_name, const size_t capacity)
-    : _test_name(test_name), _byte_stream(capacity) {
+    : _test_name(test_name), _byte_stream(capacity), _chunked_byte_stream(capacity, true) {
     std::ostringstream ss;
     ss << "Initialized with ("
        << "capacity=" << capacity << ")";
@@ -56,6 +56,11 @@ ByteStreamTestHarness::ByteStreamTestHarness(const std::string &test_name, const
 void ByteStreamTestHarness::execute(const ByteStreamTestStep &step) {
     try {
         step.execute(_byte_stream);
+        try {
+            step.execute(_chunked_byte_stream);
+        } catch (const ByteStreamExpectationViolation &e) {
+            throw ByteStreamExpectationViolation(std::string("(chunked mode) ") + e.what());
+        }
         _steps_executed.emplace_back(step);
     } catch (const ByteStreamExpectationViolation &e) {
         std::cerr << "Test Failure on expectation:\n\t" << std::string(step);
@@ -182,3 +187,33 @@ void Peek::execute(ByteStream &bs) const {
                                              output + "\"");
     }
 }
+
+// PeekViews
+PeekViews::PeekViews(const std::string &output, const size_t num_views) : _output(output), _num_views(num_views) {}
+std::string PeekViews::description() const {
+    return "\"" + _output + "\" at the front of the stream in " + std::to_string(_num_views) + " view(s)";
+}
+void PeekViews::execute(ByteStream &bs) const {
+    if (bs.chunked()) {
+        // a chunked stream has no ring buffer to view, only its chunks
+        if (bs.peek_buffers(_output.size()).size() != _output.size()) {
+            throw ByteStreamExpectationViolation("peek_buffers() returned the wrong number of bytes");
+        }
+        return;
+    }
+
+    const auto [first, second] = bs.peek_views(_output.size());
+    const std::string output = std::string(first) + std::string(second);
+    if (output != _output) {
+        throw ByteStreamExpectationViolation("Expected \"" + _output + "\" in the peeked views, but found \"" +
+                                             output + "\"");
+    }
+    const size_t num_views = (first.empty() ? 0 : 1) + (second.empty() ? 0 : 1);
+    if (num_views != _num_views) {
+        throw ByteStreamExpectationViolation("Expected " + std::to_string(_num_views) + " peeked view(s), but found " +
+                                             std::to_string(num_views));
+    }
+    if (bs.peek_buffers(_output.size()).size() != _output.size()) {
+        throw ByteStreamExpectationViolation("peek_buffers() disagrees with peek_views() about the peeked size");
+    }
+}
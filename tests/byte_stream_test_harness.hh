@@ -128,9 +128,19 @@ struct Peek : public ByteStreamExpectation {
     void execute(ByteStream &) const override;
 };
 
+struct PeekViews : public ByteStreamExpectation {
+    std::string _output;
+    size_t _num_views;
+
+    PeekViews(const std::string &output, const size_t num_views);
+    std::string description() const override;
+    void execute(ByteStream &) const override;
+};
+
 class ByteStreamTestHarness {
     std::string _test_name;
     ByteStream _byte_stream;
+    ByteStream _chunked_byte_stream;
     std::vector<std::string> _steps_executed{};
 
   public:
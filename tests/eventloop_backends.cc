@@ -0,0 +1,185 @@
+#include "eventloop.hh"
+#include "file_descriptor.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+static constexpr size_t NPIPES = 64;
+static constexpr unsigned NREPS = 200;
+
+//! A non-blocking pipe: read end, write end
+static pair<FileDescriptor, FileDescriptor> make_pipe() {
+    int fds[2];
+    SystemCall("pipe2", ::pipe2(fds, O_NONBLOCK | O_CLOEXEC));
+    return {FileDescriptor{fds[0]}, FileDescriptor{fds[1]}};
+}
+
+static string name(const EventLoop::Backend backend) { return backend == EventLoop::Backend::Poll ? "poll" : "epoll"; }
+
+//! Exactly the callbacks of ready fds run, and the loop times out when none is ready
+static void check_ready_set(const EventLoop::Backend backend, mt19937 &rd) {
+    EventLoop loop{backend};
+    vector<pair<FileDescriptor, FileDescriptor>> pipes;
+    vector<unsigned> runs(NPIPES);
+    for (size_t i = 0; i < NPIPES; i++) {
+        pipes.push_back(make_pipe());
+        loop.add_rule(pipes.back().first, Direction::In, [&, i] {
+            pipes[i].first.read();
+            runs[i]++;
+        });
+    }
+
+    if (loop.wait_next_event(0) != EventLoop::Result::Timeout) {
+        throw runtime_error(name(backend) + ": no fd is ready, but the wait did not time out");
+    }
+
+    for (unsigned rep = 0; rep < NREPS; rep++) {
+        vector<unsigned> expected(runs);
+        for (unsigned n = rd() % 4 + 1; n > 0; n--) {
+            const size_t i = rd() % NPIPES;
+            pipes[i].second.write("x");
+            expected[i] = runs[i] + 1;
+        }
+        if (loop.wait_next_event(0) != EventLoop::Result::Success or runs != expected) {
+            throw runtime_error(name(backend) + ": callbacks did not match the ready fds");
+        }
+    }
+}
+
+//! An interest callback switches its rule on and off, and the loop exits once nothing is of interest
+static void check_interest(const EventLoop::Backend backend) {
+    int fds[2];
+    SystemCall("socketpair", ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds));
+    FileDescriptor a{fds[0]}, b{fds[1]};
+
+    EventLoop loop{backend};
+    string to_send;
+    string received;
+    loop.add_rule(
+        a,
+        Direction::Out,
+        [&] { to_send.erase(0, a.write(to_send)); },
+        [&] { return not to_send.empty(); });
+    loop.add_rule(
+        a,
+        Direction::In,
+        [&] { received += a.read(); },
+        [&] { return received.size() < 5; });
+
+    if (loop.wait_next_event(0) != EventLoop::Result::Timeout) {
+        throw runtime_error(name(backend) + ": a writable but uninterested fd woke the loop");
+    }
+
+    to_send = "hello";
+    if (loop.wait_next_event(0) != EventLoop::Result::Success or not to_send.empty() or b.read() != "hello") {
+        throw runtime_error(name(backend) + ": interested Out rule did not run");
+    }
+
+    b.write("world");
+    if (loop.wait_next_event(0) != EventLoop::Result::Success or received != "world") {
+        throw runtime_error(name(backend) + ": In rule on the same fd did not run");
+    }
+
+    if (loop.wait_next_event(0) != EventLoop::Result::Exit) {
+        throw runtime_error(name(backend) + ": loop with no interested rule did not exit");
+    }
+}
+
+//! Rules are canceled at EOF and when their fd is closed
+static void check_cancel(const EventLoop::Backend backend) {
+    EventLoop loop{backend};
+    auto eof = make_pipe();
+    auto closed = make_pipe();
+    unsigned canceled = 0;
+
+    loop.add_rule(
+        eof.first, Direction::In, [&] { eof.first.read(); }, {}, [&] { canceled++; });
+    loop.add_rule(
+        closed.first, Direction::In, [&] { closed.first.read(); }, {}, [&] { canceled++; });
+
+    eof.second.close();
+    closed.first.close();
+
+    for (unsigned i = 0; i < 10 and loop.wait_next_event(0) != EventLoop::Result::Exit; i++) {
+    }
+    if (canceled != 2) {
+        throw runtime_error(name(backend) + ": " + to_string(canceled) + " of 2 rules were canceled");
+    }
+    if (loop.wait_next_event(0) != EventLoop::Result::Exit) {
+        throw runtime_error(name(backend) + ": loop did not exit after every rule was canceled");
+    }
+}
+
+//! A regular file (which epoll can't watch) is read to EOF, as with poll(2)
+static void check_regular_file(const EventLoop::Backend backend) {
+    char path[] = "/tmp/eventloop_backends_XXXXXX";
+    FileDescriptor file{SystemCall("mkstemp", ::mkstemp(path))};
+    SystemCall("unlink", ::unlink(path));
+    file.write(string(10000, 'f'));
+    SystemCall("lseek", ::lseek(file.fd_num(), 0, SEEK_SET));
+
+    EventLoop loop{backend};
+    size_t bytes = 0;
+    loop.add_rule(file, Direction::In, [&] { bytes += file.read(4096).size(); });
+    for (unsigned i = 0; i < 10 and loop.wait_next_event(-1) != EventLoop::Result::Exit; i++) {
+    }
+    if (bytes != 10000 or not file.eof()) {
+        throw runtime_error(name(backend) + ": read " + to_string(bytes) + " bytes of a regular file");
+    }
+}
+
+//! A callback that neither reads nor writes its fd is an error
+static void check_busy_wait(const EventLoop::Backend backend) {
+    EventLoop loop{backend};
+    auto [r, w] = make_pipe();
+    loop.add_rule(r, Direction::In, [] {});
+    w.write("x");
+    try {
+        loop.wait_next_event(0);
+    } catch (const runtime_error &) {
+        return;
+    }
+    throw runtime_error(name(backend) + ": busy wait not detected");
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        for (const auto backend : {EventLoop::Backend::Poll, EventLoop::Backend::Epoll}) {
+            check_ready_set(backend, rd);
+            check_interest(backend);
+            check_cancel(backend);
+            check_regular_file(backend);
+            check_busy_wait(backend);
+        }
+
+        // epoll watches each fd once, so a second rule for the same fd and direction is refused
+        EventLoop loop{EventLoop::Backend::Epoll};
+        FileDescriptor r = make_pipe().first;
+        loop.add_rule(r, Direction::In, [&] { r.read(); });
+        try {
+            loop.add_rule(r, Direction::In, [&] { r.read(); });
+            throw runtime_error("epoll: second rule for the same fd and direction was accepted");
+        } catch (const runtime_error &e) {
+            if (string(e.what()).find("already has a rule") == string::npos) {
+                throw;
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,151 @@
+#include "eventloop.hh"
+#include "file_descriptor.hh"
+#include "util.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono_literals;
+
+using Clock = EventLoop::Clock;
+
+//! How late a timer may fire on a loaded machine before the test calls it a failure
+static constexpr auto SLACK = 50ms;
+
+static string name(const EventLoop::Backend backend) { return backend == EventLoop::Backend::Poll ? "poll" : "epoll"; }
+
+//! Timers fire in deadline order, not before their deadline, and keep an otherwise empty loop alive
+static void check_order(const EventLoop::Backend backend) {
+    EventLoop loop{backend};
+    const auto start = Clock::now();
+    vector<pair<int, Clock::time_point>> fired;
+    for (const int ms : {7, 2, 5, 2, 0}) {
+        loop.add_timer(start + chrono::milliseconds{ms}, [&, ms] { fired.emplace_back(ms, Clock::now()); });
+    }
+
+    while (loop.wait_next_event(-1) != EventLoop::Result::Exit) {
+    }
+    if (fired.size() != 5) {
+        throw runtime_error(name(backend) + ": " + to_string(fired.size()) + " of 5 timers fired");
+    }
+    for (size_t i = 0; i < fired.size(); i++) {
+        const auto deadline = start + chrono::milliseconds{fired[i].first};
+        if (i > 0 and fired[i].first < fired[i - 1].first) {
+            throw runtime_error(name(backend) + ": timers fired out of order");
+        }
+        if (fired[i].second < deadline or fired[i].second > deadline + SLACK) {
+            throw runtime_error(name(backend) + ": " + to_string(fired[i].first) + " ms timer fired at the wrong time");
+        }
+    }
+}
+
+//! A timer due in less than a millisecond is not rounded to whole milliseconds
+static void check_resolution(const EventLoop::Backend backend) {
+    EventLoop loop{backend};
+    auto wakeups = 0;
+    bool fired = false;
+    const auto deadline = Clock::now() + 300us;
+    loop.add_timer(deadline, [&] { fired = true; });
+    while (not fired) {
+        wakeups++;
+        loop.wait_next_event(-1);
+    }
+    if (Clock::now() < deadline) {
+        throw runtime_error(name(backend) + ": sub-millisecond timer fired early");
+    }
+    if (wakeups > 3) {
+        throw runtime_error(name(backend) + ": " + to_string(wakeups) + " wakeups for one sub-millisecond timer");
+    }
+}
+
+//! Rearming and canceling, including from callbacks
+static void check_rearm_cancel(const EventLoop::Backend backend) {
+    EventLoop loop{backend};
+    const auto start = Clock::now();
+    unsigned a_runs = 0, b_runs = 0, c_runs = 0;
+
+    const auto a = loop.add_timer(start + 1h, [&] { a_runs++; });
+    const auto b = loop.add_timer(start + 1h, [&] { b_runs++; });
+
+    if (not loop.rearm_timer(a, start + 1ms) or not loop.cancel_timer(b)) {
+        throw runtime_error(name(backend) + ": pending timer could not be rearmed or canceled");
+    }
+    if (loop.cancel_timer(b) or loop.rearm_timer(b, start)) {
+        throw runtime_error(name(backend) + ": canceled timer was still pending");
+    }
+
+    // c's callback adds another timer, for a deadline that has already passed: it runs on the next wait
+    bool readded = false;
+    const auto c = loop.add_timer(start, [&] {
+        c_runs++;
+        if (not readded) {
+            readded = true;
+            loop.add_timer(start, [&] { c_runs++; });
+        }
+    });
+
+    if (loop.wait_next_event(0) != EventLoop::Result::Success or c_runs != 1) {
+        throw runtime_error(name(backend) + ": due timer did not run exactly once");
+    }
+    if (loop.rearm_timer(c, start)) {
+        throw runtime_error(name(backend) + ": fired timer could still be rearmed");
+    }
+    while (loop.wait_next_event(-1) != EventLoop::Result::Exit) {
+    }
+    if (a_runs != 1 or b_runs != 0 or c_runs != 2) {
+        throw runtime_error(name(backend) + ": wrong timers ran");
+    }
+}
+
+//! A wait with a timeout shorter than the next timer times out; ready fds and timers both count as success
+static void check_with_fds(const EventLoop::Backend backend) {
+    int fds[2];
+    SystemCall("pipe2", ::pipe2(fds, O_NONBLOCK | O_CLOEXEC));
+    FileDescriptor r{fds[0]}, w{fds[1]};
+
+    EventLoop loop{backend};
+    string received;
+    loop.add_rule(r, Direction::In, [&] { received += r.read(); });
+    bool fired = false;
+    loop.add_timer(Clock::now() + 20ms, [&] { fired = true; });
+
+    if (loop.wait_next_event(1) != EventLoop::Result::Timeout or fired) {
+        throw runtime_error(name(backend) + ": wait did not time out before the timer");
+    }
+    w.write("x");
+    if (loop.wait_next_event(-1) != EventLoop::Result::Success or received != "x" or fired) {
+        throw runtime_error(name(backend) + ": ready fd did not end the wait");
+    }
+    const auto before = Clock::now();
+    if (loop.wait_next_event(1000) != EventLoop::Result::Success or not fired) {
+        throw runtime_error(name(backend) + ": timer did not end the wait");
+    }
+    if (Clock::now() - before > 20ms + SLACK) {
+        throw runtime_error(name(backend) + ": waited past the timer");
+    }
+}
+
+int main() {
+    try {
+        for (const auto backend : {EventLoop::Backend::Poll, EventLoop::Backend::Epoll}) {
+            check_order(backend);
+            check_resolution(backend);
+            check_rearm_cancel(backend);
+            check_with_fds(backend);
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
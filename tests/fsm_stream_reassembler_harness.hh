@@ -19,6 +19,8 @@ class ReassemblerExpectationViolation : public std::runtime_error {
 struct ReassemblerTestStep {
     virtual std::string to_string() const { return "ReassemblerTestStep"; }
     virtual void execute(StreamReassembler &) const {}
+    //! Same as execute(), but submits segments through the Buffer overload of push_substring
+    virtual void execute_buffered(StreamReassembler &reassembler) const { execute(reassembler); }
     virtual ~ReassemblerTestStep() {}
 };
 
@@ -157,20 +159,31 @@ struct SubmitSegment : public ReassemblerAction {
     }
 
     void execute(StreamReassembler &reassembler) const { reassembler.push_substring(_data, _index, _eof); }
+
+    void execute_buffered(StreamReassembler &reassembler) const {
+        reassembler.push_substring(Buffer{std::string(_data)}, _index, _eof);
+    }
 };
 
 class ReassemblerTestHarness {
     StreamReassembler reassembler;
+    StreamReassembler buffered_reassembler;
     std::vector<std::string> steps_executed;
 
   public:
-    ReassemblerTestHarness(const size_t capacity) : reassembler(capacity), steps_executed() {
+    ReassemblerTestHarness(const size_t capacity)
+        : reassembler(capacity), buffered_reassembler(capacity), steps_executed() {
         steps_executed.emplace_back("Initialized (capacity = " + std::to_string(capacity) + ")");
     }
 
     void execute(const ReassemblerTestStep &step) {
         try {
             step.execute(reassembler);
+            try {
+                step.execute_buffered(buffered_reassembler);
+            } catch (const ReassemblerExpectationViolation &e) {
+                throw ReassemblerExpectationViolation(std::string("(Buffer segments) ") + e.what());
+            }
             steps_executed.emplace_back(step.to_string());
         } catch (const ReassemblerExpectationViolation &e) {
             std::cerr << "Test Failure on expectation:\n\t" << step.to_string();
@@ -0,0 +1,89 @@
+#include "byte_stream.hh"
+#include "stream_reassembler.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+static constexpr size_t CAPACITY = 4096;
+static constexpr size_t MEMORY_LIMIT = CAPACITY + 1024;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        string d(CAPACITY, 0);
+        generate(d.begin(), d.end(), [&] { return rd(); });
+
+        // adversarial loss: every other byte arrives, each as its own segment
+        {
+            StreamReassembler buf{CAPACITY, MEMORY_LIMIT};
+            for (size_t i = 1; i < CAPACITY; i += 2) {
+                buf.push_substring(Buffer{d.substr(i, 1)}, i, false);
+                if (buf.memory_usage() > MEMORY_LIMIT) {
+                    throw runtime_error("test 1 - memory usage exceeded the limit");
+                }
+            }
+
+            const auto held = buf.stats();
+            if (held.segments_held == 0 || held.bytes_held != held.segments_held) {
+                throw runtime_error("test 1 - unexpected segments or bytes held");
+            }
+            if (held.bytes_dropped != CAPACITY / 2 - held.segments_held) {
+                throw runtime_error("test 1 - dropped bytes were not accounted for");
+            }
+            if (held.memory_usage != buf.memory_usage()) {
+                throw runtime_error("test 1 - stats disagree with memory_usage()");
+            }
+
+            // the stream must still make progress once the missing bytes arrive in order
+            buf.push_substring(d, 0, true);
+            if (buf.stream_out().read(CAPACITY) != d || !buf.stream_out().eof()) {
+                throw runtime_error("test 1 - stream did not complete under the memory limit");
+            }
+
+            const auto done = buf.stats();
+            if (done.segments_held != 0 || done.bytes_held != 0 || done.coalesce_ops < held.segments_held) {
+                throw runtime_error("test 1 - unexpected stats after assembly");
+            }
+        }
+
+        // without a limit nothing inside the window is dropped
+        {
+            StreamReassembler buf{CAPACITY};
+            for (size_t i = 1; i < CAPACITY; i += 2) {
+                buf.push_substring(d.substr(i, 1), i, false);
+            }
+            buf.push_substring(string(2 * CAPACITY, 'x'), CAPACITY, false);
+
+            const auto stats = buf.stats();
+            if (stats.segments_held != CAPACITY / 2 || stats.bytes_held != CAPACITY / 2) {
+                throw runtime_error("test 2 - unexpected segments or bytes held");
+            }
+            if (stats.bytes_dropped != 2 * CAPACITY) {
+                throw runtime_error("test 2 - bytes beyond the window were not counted as dropped");
+            }
+        }
+
+        try {
+            StreamReassembler buf{CAPACITY, CAPACITY - 1};
+            throw runtime_error("test 3 - a limit below the capacity was accepted");
+        } catch (const runtime_error &e) {
+            if (string(e.what()).find("test 3") != string::npos) {
+                throw;
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -29,6 +29,7 @@ int main() {
         // overlapping segments
         for (unsigned rep_no = 0; rep_no < NREPS; ++rep_no) {
             StreamReassembler buf{NSEGS * MAX_SEG_LEN};
+            StreamReassembler buffered{NSEGS * MAX_SEG_LEN};
 
             vector<tuple<size_t, size_t>> seq_size;
             size_t offset = 0;
@@ -45,6 +46,7 @@ int main() {
 
             for (auto [off, sz] : seq_size) {
                 string dd(d.cbegin() + off, d.cbegin() + off + sz);
+                buffered.push_substring(Buffer{string(dd)}, off, off + sz == offset);
                 buf.push_substring(move(dd), off, off + sz == offset);
             }
 
@@ -55,6 +57,9 @@ int main() {
             if (!equal(result.cbegin(), result.cend(), d.cbegin())) {
                 throw runtime_error("test 2 - content of RX bytes is incorrect");
             }
+            if (read(buffered) != result) {
+                throw runtime_error("test 2 - content of RX bytes from Buffer segments is incorrect");
+            }
         }
     } catch (const exception &e) {
         cerr << "Exception: " << e.what() << endl;
@@ -0,0 +1,78 @@
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+static constexpr unsigned NREPS = 4096;
+static constexpr size_t MAX_LEN = 9000;
+
+//! The original byte-at-a-time algorithm
+static uint16_t reference_checksum(const uint32_t initial_sum, const string_view data) {
+    uint32_t sum = initial_sum;
+    for (size_t i = 0; i < data.size(); i++) {
+        sum += (i % 2 == 0) ? uint32_t(uint8_t(data[i])) << 8 : uint8_t(data[i]);
+    }
+    while (sum > 0xffff) {
+        sum = (sum >> 16) + (sum & 0xffff);
+    }
+    return ~sum;
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // every byte 0xff maximizes carries; the buffer is long enough to exercise the SIMD flush
+        const string ones(1 << 20, char(0xff));
+
+        for (const auto &kernel : InternetChecksum::kernels()) {
+            if (not InternetChecksum::use_kernel(kernel)) {
+                throw runtime_error(kernel + ": listed kernel could not be selected");
+            }
+
+            for (unsigned rep = 0; rep < NREPS; rep++) {
+                // random length, random offset into the buffer (for unaligned loads), random chunking
+                string buf(MAX_LEN + 64, 0);
+                for (auto &ch : buf) {
+                    ch = rd();
+                }
+                const size_t offset = rd() % 64;
+                const size_t len = rd() % MAX_LEN;
+                const string_view data = string_view(buf).substr(offset, len);
+                const uint32_t initial_sum = rd() % 0x40000;
+
+                InternetChecksum check(initial_sum);
+                size_t pos = 0;
+                while (pos < data.size()) {
+                    const size_t chunk = (rd() % 4 == 0) ? rd() % 8 : rd() % 1500;
+                    check.add(data.substr(pos, chunk));
+                    pos += chunk;
+                }
+
+                if (check.value() != reference_checksum(initial_sum, data)) {
+                    throw runtime_error(kernel + ": checksum of " + to_string(len) + " bytes at offset " +
+                                        to_string(offset) + " does not match the byte-at-a-time result");
+                }
+            }
+
+            // 0xffff words sum to 0 in ones' complement, whatever the length
+            InternetChecksum check;
+            check.add(ones);
+            if (check.value() != 0) {
+                throw runtime_error(kernel + ": checksum of 1 MiB of 0xff is wrong");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+#include "address.hh"
+#include "buffer.hh"
+#include "file_descriptor.hh"
+#include "io_uring.hh"
+#include "socket.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+//! A pipe: read end, write end
+static pair<FileDescriptor, FileDescriptor> make_pipe() {
+    int fds[2];
+    SystemCall("pipe2", ::pipe2(fds, O_CLOEXEC));
+    return {FileDescriptor{fds[0]}, FileDescriptor{fds[1]}};
+}
+
+//! Writes reach a pipe in the order they were queued, with one io_uring_enter per batch
+static void check_pipe() {
+    auto [r, w] = make_pipe();
+    IOUring ring{8};
+
+    string expected;
+    for (unsigned i = 0; i < 5; i++) {
+        BufferList data{string("write " + to_string(i) + ";")};
+        data.append(BufferList{string(i, '.')});  // more than one piece
+        expected += data.concatenate();
+        ring.write(w, move(data));
+    }
+    // more pieces than fit in the iovecs
+    BufferList many;
+    for (unsigned i = 0; i < 20; i++) {
+        many.append(BufferList{to_string(i % 10)});
+    }
+    expected += many.concatenate();
+    ring.write(w, move(many));
+
+    if (ring.queued() != 6 or w.write_count() != 0 or ring.submissions() != 0) {
+        throw runtime_error("writes were not just queued");
+    }
+    ring.submit();
+    if (ring.queued() != 0 or w.write_count() != 6 or ring.submissions() != 1) {
+        throw runtime_error("submit() did not complete every write with one io_uring_enter");
+    }
+    if (r.read(expected.size() + 1) != expected) {
+        throw runtime_error("pipe did not receive the writes in order");
+    }
+
+    ring.submit();
+    if (ring.submissions() != 1) {
+        throw runtime_error("submit() with nothing queued entered the kernel");
+    }
+}
+
+//! A full queue is submitted before the next write is queued
+static void check_full_queue() {
+    auto [r, w] = make_pipe();
+    IOUring ring{4};
+    string expected;
+    for (unsigned i = 0; i < 10; i++) {
+        expected += to_string(i);
+        ring.write(w, to_string(i));
+    }
+    ring.submit();
+    if (w.write_count() != 10 or ring.submissions() < 3) {
+        throw runtime_error("a full queue was not submitted");
+    }
+    if (r.read(expected.size() + 1) != expected) {
+        throw runtime_error("pipe did not receive every write in order");
+    }
+}
+
+//! Datagrams go to their own destinations, each as one datagram
+static void check_sendto() {
+    UDPSocket a, b, sender;
+    a.bind(Address("127.0.0.1", 0));
+    b.bind(Address("127.0.0.1", 0));
+    sender.bind(Address("127.0.0.1", 0));
+
+    IOUring ring;
+    vector<string> to_a, to_b;
+    for (unsigned i = 0; i < 8; i++) {
+        const string payload = "datagram " + to_string(i);
+        BufferList data{payload.substr(0, 4)};
+        data.append(BufferList{payload.substr(4)});
+        if (i % 3 == 0) {
+            to_b.push_back(payload);
+            ring.sendto(sender, b.local_address(), move(data));
+        } else {
+            to_a.push_back(payload);
+            ring.sendto(sender, a.local_address(), move(data));
+        }
+    }
+    ring.submit();
+    if (sender.write_count() != 8) {
+        throw runtime_error("sendto writes were not counted");
+    }
+
+    for (const auto &[sock, expected] : {make_pair(&a, to_a), make_pair(&b, to_b)}) {
+        for (const auto &payload : expected) {
+            const auto dgram = sock->recv();
+            if (dgram.payload != payload or dgram.source_address != sender.local_address()) {
+                throw runtime_error("received \"" + dgram.payload + "\", expected \"" + payload + "\"");
+            }
+        }
+    }
+}
+
+//! A failed write is reported by submit(), after the other writes have completed
+static void check_error() {
+    auto [r, w] = make_pipe();
+    IOUring ring;
+    ring.write(w, string("ok"));
+    ring.write(r, string("read end"));  // EBADF
+    try {
+        ring.submit();
+    } catch (const unix_error &e) {
+        if (e.code().value() != EBADF) {
+            throw;
+        }
+        if (ring.queued() != 0 or w.write_count() != 1 or r.read() != "ok") {
+            throw runtime_error("the successful write was lost with the failed one");
+        }
+        return;
+    }
+    throw runtime_error("write to the read end of a pipe did not fail");
+}
+
+int main() {
+    try {
+        if (not IOUring::available()) {
+            cerr << "io_uring is not available; skipping" << endl;
+            return EXIT_SUCCESS;
+        }
+        check_pipe();
+        check_full_queue();
+        check_sendto();
+        check_error();
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,97 @@
+#include "ipv4_datagram.hh"
+#include "ipv4_header.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+static constexpr unsigned NREPS = 65536;
+
+//! The checksum of `header`, computed from scratch
+static uint16_t full_cksum(IPv4Header header) {
+    header.cksum = 0;
+    InternetChecksum check;
+    check.add(header.serialize());
+    return check.value();
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        for (unsigned rep = 0; rep < NREPS; rep++) {
+            IPv4Header header;
+            header.tos = rd();
+            header.len = IPv4Header::LENGTH + rd() % 1480;
+            header.id = rd();
+            header.ttl = rd();
+            header.proto = rd();
+            header.src = rd();
+            header.dst = rd();
+            header.cksum = full_cksum(header);
+
+            switch (rep % 3) {
+                case 0:
+                    header.set_ttl(rd());
+                    break;
+                case 1:
+                    header.set_src(rd());
+                    break;
+                default:
+                    header.set_dst(rd());
+                    break;
+            }
+
+            if (header.cksum != full_cksum(header)) {
+                throw runtime_error("incrementally adjusted checksum differs from a full recomputation:\n" +
+                                    header.to_string());
+            }
+        }
+
+        // a forwarded datagram: parse, decrement the TTL in place, serialize without recomputing
+        {
+            IPv4Datagram original;
+            original.header().src = 0x0a000001;
+            original.header().dst = 0x0a000002;
+            original.payload() = string("hello");
+            original.header().len = original.header().hlen * 4 + original.payload().size();
+
+            IPv4Datagram forwarded;
+            if (forwarded.parse(original.serialize().concatenate()) != ParseResult::NoError) {
+                throw runtime_error("could not parse a serialized datagram");
+            }
+            forwarded.set_ttl(forwarded.header().ttl - 1);
+
+            original.header().ttl--;
+            if (forwarded.serialize().concatenate() != original.serialize().concatenate()) {
+                throw runtime_error("forwarded datagram does not match one serialized from scratch");
+            }
+
+            IPv4Datagram reparsed;
+            if (reparsed.parse(forwarded.serialize().concatenate()) != ParseResult::NoError) {
+                throw runtime_error("forwarded datagram has a bad checksum");
+            }
+
+            // reading through header() keeps the stored checksum; a change through it is noticed
+            if (forwarded.header().ttl != original.header().ttl or
+                forwarded.serialize().concatenate() != original.serialize().concatenate()) {
+                throw runtime_error("reading the header changed the serialized datagram");
+            }
+            forwarded.header().ttl = 7;
+            if (reparsed.parse(forwarded.serialize().concatenate()) != ParseResult::NoError) {
+                throw runtime_error("checksum was not recomputed after the header was modified");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+#include "ipv4_map.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+static constexpr unsigned NROUNDS = 32;
+static constexpr unsigned NOPS = 20000;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        for (unsigned round = 0; round < NROUNDS; round++) {
+            // keys from a small range collide and cluster, so erasing has to shift entries back
+            const uint32_t base = rd();
+            const uint32_t range = 1 + rd() % (round % 2 ? 64 : 100000);
+
+            IPv4Map<uint64_t> table;
+            map<uint32_t, uint64_t> reference;
+            for (unsigned op = 0; op < NOPS; op++) {
+                const uint32_t key = base + rd() % range;
+                const uint64_t value = rd();
+                switch (rd() % 3) {
+                    case 0: {
+                        const auto [stored, inserted] = table.insert(key, uint64_t{value});
+                        const auto [expected, expected_inserted] = reference.insert({key, value});
+                        if (inserted != expected_inserted or *stored != expected->second) {
+                            throw runtime_error("insert(" + to_string(key) + ") differs from std::map");
+                        }
+                    } break;
+                    case 1:
+                        if (table.erase(key) != (reference.erase(key) == 1)) {
+                            throw runtime_error("erase(" + to_string(key) + ") differs from std::map");
+                        }
+                        break;
+                    default: {
+                        const uint64_t *found = table.find(key);
+                        const auto expected = reference.find(key);
+                        if ((found != nullptr) != (expected != reference.end()) or
+                            (found != nullptr and *found != expected->second)) {
+                            throw runtime_error("find(" + to_string(key) + ") differs from std::map");
+                        }
+                    } break;
+                }
+                if (table.size() != reference.size()) {
+                    throw runtime_error("size " + to_string(table.size()) + ", expected " +
+                                        to_string(reference.size()));
+                }
+            }
+
+            // every remaining entry can still be found after all the shifting
+            for (const auto &[key, value] : reference) {
+                const uint64_t *found = table.find(key);
+                if (found == nullptr or *found != value) {
+                    throw runtime_error("lost entry " + to_string(key));
+                }
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
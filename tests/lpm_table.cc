@@ -0,0 +1,99 @@
+#include "lpm_table.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static constexpr unsigned NTABLES = 64;
+static constexpr unsigned NLOOKUPS = 20000;
+
+struct Route {
+    uint32_t prefix;
+    uint8_t prefix_length;
+};
+
+//! Router's original linear scan: longest match wins, ties go to the route added last
+static optional<uint32_t> linear_lookup(const vector<Route> &routes, const uint32_t addr) {
+    optional<uint32_t> ret;
+    uint8_t longest_prefix_match = 0;
+    for (uint32_t i = 0; i < routes.size(); i++) {
+        const uint32_t netmask = routes[i].prefix_length == 0 ? 0 : 0xFFFFFFFF << (32 - routes[i].prefix_length);
+        if ((addr & netmask) == routes[i].prefix && routes[i].prefix_length >= longest_prefix_match) {
+            longest_prefix_match = routes[i].prefix_length;
+            ret = i;
+        }
+    }
+    return ret;
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        for (unsigned table_no = 0; table_no < NTABLES; table_no++) {
+            // prefixes drawn from a few base addresses, so they nest, overlap and repeat
+            vector<uint32_t> bases;
+            for (unsigned i = 0; i < 4; i++) {
+                bases.push_back(rd());
+            }
+
+            vector<Route> routes;
+            LPMTable table;
+            const size_t nroutes = 1 + rd() % 300;
+            for (size_t i = 0; i < nroutes; i++) {
+                const uint8_t prefix_length = rd() % 33;
+                const uint32_t netmask = prefix_length == 0 ? 0 : 0xFFFFFFFF << (32 - prefix_length);
+                uint32_t prefix = (bases[rd() % bases.size()] ^ (rd() & rd() & rd())) & netmask;
+                if (rd() % 20 == 0) {
+                    prefix |= ~netmask & rd();  // bits past the prefix length: never matches
+                }
+                routes.push_back({prefix, prefix_length});
+                table.insert(prefix, prefix_length, i);
+            }
+            table.build();
+
+            for (unsigned i = 0; i < NLOOKUPS; i++) {
+                // mostly addresses near the prefixes, some anywhere
+                uint32_t addr = rd();
+                if (rd() % 4 != 0) {
+                    addr = routes[rd() % routes.size()].prefix ^ (rd() & rd() & rd() & rd());
+                }
+
+                const auto expected = linear_lookup(routes, addr);
+                const auto actual = table.lookup(addr);
+                if (expected != actual) {
+                    throw runtime_error("lookup of " + to_string(addr) + " in table " + to_string(table_no) +
+                                        " returned " + (actual ? to_string(*actual) : "nothing") + " instead of " +
+                                        (expected ? to_string(*expected) : "nothing"));
+                }
+            }
+        }
+
+        // an empty table, and routes inserted after build() are not visible until the next one
+        LPMTable table;
+        if (table.lookup(0x01020304).has_value()) {
+            throw runtime_error("empty table returned a route");
+        }
+        table.insert(0, 0, 7);
+        if (table.built() or table.lookup(0x01020304).has_value()) {
+            throw runtime_error("route was visible before build()");
+        }
+        table.build();
+        if (table.lookup(0x01020304) != 7u) {
+            throw runtime_error("default route was not found");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
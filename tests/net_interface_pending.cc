@@ -0,0 +1,152 @@
+#include "arp_message.hh"
+#include "network_interface.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+static const EthernetAddress LOCAL_ETH{0x02, 0, 0, 0, 0, 0x01};
+static const uint32_t LOCAL_IP = 0x0a000001;  // 10.0.0.1
+
+static InternetDatagram make_datagram(const uint16_t id) {
+    InternetDatagram dgram;
+    dgram.header().src = LOCAL_IP;
+    dgram.header().dst = 0x08080808;
+    dgram.header().id = id;
+    dgram.payload() = string(100, 'x');
+    dgram.header().len = dgram.header().hlen * 4 + dgram.payload().size();
+    return dgram;
+}
+
+static EthernetAddress neighbor_eth(const uint32_t ip) {
+    return {0x02, 0, uint8_t(ip >> 24), uint8_t(ip >> 16), uint8_t(ip >> 8), uint8_t(ip)};
+}
+
+//! `ip` answers the interface's ARP request
+static EthernetFrame arp_reply(const uint32_t ip) {
+    ARPMessage arp;
+    arp.opcode = ARPMessage::OPCODE_REPLY;
+    arp.sender_ethernet_address = neighbor_eth(ip);
+    arp.sender_ip_address = ip;
+    arp.target_ethernet_address = LOCAL_ETH;
+    arp.target_ip_address = LOCAL_IP;
+    EthernetFrame frame;
+    frame.header() = {LOCAL_ETH, neighbor_eth(ip), EthernetHeader::TYPE_ARP};
+    frame.payload() = arp.serialize();
+    return frame;
+}
+
+//! Number of frames of `type` in the interface's outbound queue, which is emptied
+static size_t drain(NetworkInterface &iface, const uint16_t type) {
+    size_t ret = 0;
+    for (auto &frames = iface.frames_out(); not frames.empty(); frames.pop()) {
+        ret += frames.front().header().type == type;
+    }
+    return ret;
+}
+
+static void expect(const bool condition, const string &what) {
+    if (not condition) {
+        throw runtime_error(what);
+    }
+}
+
+int main() {
+    try {
+        cerr.setstate(ios::failbit);  // no DEBUG line from the constructor
+
+        // one next hop: its queue is bounded, and the reply flushes what it holds, in order
+        {
+            NetworkInterface iface{LOCAL_ETH, Address::from_ipv4_numeric(LOCAL_IP), {8, 1 << 20}};
+            const uint32_t next_hop = 0x0a000002;
+            for (uint16_t id = 0; id < 100; id++) {
+                iface.send_datagram(make_datagram(id), Address::from_ipv4_numeric(next_hop));
+            }
+            expect(drain(iface, EthernetHeader::TYPE_ARP) == 1, "expected one ARP request");
+            expect(iface.pending_stats().datagrams == 8, "per-next-hop bound not applied");
+            expect(iface.pending_stats().dropped == 92, "drops not counted");
+
+            iface.recv_frame(arp_reply(next_hop));
+            for (uint16_t id = 0; id < 8; id++) {
+                auto &frames = iface.frames_out();
+                expect(not frames.empty(), "held datagram " + to_string(id) + " not sent");
+                InternetDatagram dgram;
+                expect(dgram.parse(frames.front().payload().concatenate()) == ParseResult::NoError,
+                       "bad datagram");
+                expect(dgram.header().id == id, "held datagrams sent out of order");
+                expect(frames.front().header().dst == neighbor_eth(next_hop), "sent to the wrong address");
+                frames.pop();
+            }
+            expect(iface.frames_out().empty(), "unexpected frame");
+            expect(iface.pending_stats().datagrams == 0 and iface.pending_stats().bytes == 0,
+                   "counters not updated after the flush");
+        }
+
+        // many next hops: the byte bound holds across all of them, and a reply flushes only its own
+        {
+            const size_t dgram_bytes = make_datagram(0).header().len;
+            NetworkInterface iface{LOCAL_ETH, Address::from_ipv4_numeric(LOCAL_IP), {64, 1000 * dgram_bytes, 5000}};
+            for (uint32_t i = 0; i < 5000; i++) {
+                iface.send_datagram(make_datagram(i), Address::from_ipv4_numeric(0x0b000000 + i));
+            }
+            expect(drain(iface, EthernetHeader::TYPE_ARP) == 5000, "expected one ARP request per next hop");
+            expect(iface.pending_stats().datagrams == 1000, "byte bound not applied");
+            expect(iface.pending_stats().bytes == 1000 * dgram_bytes, "bytes not counted");
+            expect(iface.pending_stats().dropped == 4000, "drops not counted");
+
+            iface.recv_frame(arp_reply(0x0b000007));
+            expect(drain(iface, EthernetHeader::TYPE_IPv4) == 1, "reply did not flush exactly its next hop");
+            iface.recv_frame(arp_reply(0x0b000000 + 4000));
+            expect(drain(iface, EthernetHeader::TYPE_IPv4) == 0, "dropped datagram was sent");
+
+            // the space freed by the flush can be used again
+            iface.send_datagram(make_datagram(0), Address::from_ipv4_numeric(0x0b000001));
+            expect(iface.pending_stats().datagrams == 1000, "freed space not reused");
+
+            // unanswered requests are sent again, and what waits for them is kept
+            iface.tick(5000);
+            expect(drain(iface, EthernetHeader::TYPE_ARP) == 4998, "requests not sent again");
+            expect(iface.pending_stats().datagrams == 1000, "held datagrams lost on retry");
+        }
+
+        // next hops that never answer are given up on, and only so many are waited for at once
+        {
+            NetworkInterface iface{LOCAL_ETH, Address::from_ipv4_numeric(LOCAL_IP), {8, 1 << 20, 100, 3}};
+            for (uint32_t i = 0; i < 150; i++) {
+                iface.send_datagram(make_datagram(i), Address::from_ipv4_numeric(0x0b000000 + i));
+            }
+            expect(drain(iface, EthernetHeader::TYPE_ARP) == 100, "next hops beyond the bound were resolved");
+            expect(iface.pending_stats().next_hops == 100, "next hops not counted");
+            expect(iface.pending_stats().datagrams == 100 and iface.pending_stats().dropped == 50,
+                   "datagrams for next hops beyond the bound not dropped");
+
+            iface.tick(5000);
+            iface.tick(5000);
+            expect(drain(iface, EthernetHeader::TYPE_ARP) == 200, "requests not sent again");
+            iface.recv_frame(arp_reply(0x0b000005));
+            expect(drain(iface, EthernetHeader::TYPE_IPv4) == 1, "reply to a repeated request not used");
+
+            iface.tick(5000);
+            expect(drain(iface, EthernetHeader::TYPE_ARP) == 0, "request sent beyond the limit");
+            expect(iface.pending_stats().next_hops == 0 and iface.pending_stats().datagrams == 0 and
+                       iface.pending_stats().bytes == 0,
+                   "unanswered next hops not given up on");
+            expect(iface.pending_stats().dropped == 50 + 99, "datagrams of unanswered next hops not counted");
+
+            // a next hop given up on can be tried again
+            iface.send_datagram(make_datagram(0), Address::from_ipv4_numeric(0x0b000000));
+            expect(drain(iface, EthernetHeader::TYPE_ARP) == 1, "next hop given up on not requested again");
+        }
+    } catch (const exception &e) {
+        cerr.clear();
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
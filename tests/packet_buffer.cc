@@ -0,0 +1,178 @@
+#include "ethernet_frame.hh"
+#include "ethernet_header.hh"
+#include "ipv4_datagram.hh"
+#include "packet_buffer.hh"
+#include "tcp_segment.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Count calls to operator new, to check that a warm pool makes packets without allocating
+
+static size_t allocations = 0;
+
+void *operator new(const size_t size) {
+    allocations++;
+    if (void *ptr = malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+static constexpr unsigned NREPS = 1000;
+
+static string random_string(mt19937 &rd, const size_t len) {
+    string ret(len, 0);
+    generate(ret.begin(), ret.end(), [&] { return rd(); });
+    return ret;
+}
+
+static TCPSegment random_segment(mt19937 &rd, const size_t payload_len) {
+    TCPSegment seg;
+    seg.header().sport = rd();
+    seg.header().dport = rd();
+    seg.header().seqno = WrappingInt32{uint32_t(rd())};
+    seg.header().ack = true;
+    seg.header().ackno = WrappingInt32{uint32_t(rd())};
+    seg.header().win = rd();
+    seg.payload() = Buffer{random_string(rd, payload_len)};
+    return seg;
+}
+
+static IPv4Header header_for(mt19937 &rd, const TCPSegment &seg) {
+    IPv4Header ip;
+    ip.src = rd();
+    ip.dst = rd();
+    ip.id = rd();
+    ip.len = ip.hlen * 4 + seg.header().doff * 4 + seg.payload().size();
+    return ip;
+}
+
+//! The same frame, serialized layer by layer as a BufferList
+static string frame_via_buffer_list(const EthernetHeader &eth, const IPv4Header &ip, const TCPSegment &seg) {
+    InternetDatagram dgram;
+    dgram.header() = ip;
+    dgram.payload() = seg.serialize(ip.pseudo_cksum());
+    EthernetFrame frame;
+    frame.header() = eth;
+    frame.payload() = dgram.serialize();
+    return frame.serialize().concatenate();
+}
+
+static PacketBuffer frame_via_packet_buffer(const EthernetHeader &eth, const IPv4Header &ip, const TCPSegment &seg) {
+    PacketBuffer pkt = seg.serialize_packet(ip.pseudo_cksum());
+    ip.prepend_to(pkt);
+    eth.prepend_to(pkt);
+    return pkt;
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        const EthernetHeader eth{{0x02, 0, 0, 0, 0, 1}, {0x02, 0, 0, 0, 0, 2}, EthernetHeader::TYPE_IPv4};
+
+        // headers prepended in place produce the same bytes as serializing each layer to a BufferList
+        for (unsigned rep = 0; rep < NREPS; rep++) {
+            const TCPSegment seg = random_segment(rd, rd() % 1461);
+            const IPv4Header ip = header_for(rd, seg);
+            const PacketBuffer pkt = frame_via_packet_buffer(eth, ip, seg);
+            if (pkt.str() != frame_via_buffer_list(eth, ip, seg)) {
+                throw runtime_error("PacketBuffer and BufferList serializations differ");
+            }
+        }
+
+        // a Buffer shares the packet's block, and reads back as the frame
+        {
+            const TCPSegment seg = random_segment(rd, 100);
+            const IPv4Header ip = header_for(rd, seg);
+            PacketBuffer pkt = frame_via_packet_buffer(eth, ip, seg);
+            const string expected{pkt.str()};
+            const char *const first_byte = pkt.str().data();
+
+            const Buffer buf{move(pkt)};
+            if (pkt.size() != 0 or buf.str() != expected or buf.str().data() != first_byte) {
+                throw runtime_error("Buffer did not take over the PacketBuffer's bytes");
+            }
+
+            EthernetFrame frame;
+            InternetDatagram dgram;
+            TCPSegment parsed;
+            if (frame.parse(buf) != ParseResult::NoError or dgram.parse(frame.payload()) != ParseResult::NoError or
+                parsed.parse(dgram.payload().concatenate(), dgram.header().pseudo_cksum()) != ParseResult::NoError) {
+                throw runtime_error("frame built in a PacketBuffer does not parse");
+            }
+            if (parsed.payload().str() != seg.payload().str()) {
+                throw runtime_error("wrong TCP payload after parsing");
+            }
+
+            // the block is not reused while the Buffer refers to it
+            for (unsigned i = 0; i < 2 * PacketBuffer::POOL_BLOCKS; i++) {
+                PacketBuffer other;
+                other.append(string(1000, 'x'));
+            }
+            if (buf.str() != expected) {
+                throw runtime_error("a block was reused while a Buffer still referred to it");
+            }
+        }
+
+        // out of headroom or tailroom, the packet moves to a bigger block
+        {
+            PacketBuffer pkt(10, 2);
+            pkt.append("payload");
+            copy_n("header", 6, pkt.prepend(6));
+            if (pkt.str() != "headerpayload" or pkt.headroom() < PacketBuffer::HEADROOM) {
+                throw runtime_error("prepend() past the headroom: " + string(pkt.str()));
+            }
+            const string big(3 * PacketBuffer::BLOCK_SIZE, 'y');
+            pkt.append(big);
+            if (pkt.str() != "headerpayload" + big) {
+                throw runtime_error("append() past the tailroom");
+            }
+            pkt.remove_prefix(6);
+            if (pkt.str().substr(0, 7) != "payload") {
+                throw runtime_error("remove_prefix()");
+            }
+        }
+
+        // once the pool is warm, building a frame and handing it on as a Buffer allocates nothing
+        {
+            const TCPSegment seg = random_segment(rd, 1000);
+            const IPv4Header ip = header_for(rd, seg);
+            vector<Buffer> in_flight(16);
+            for (unsigned rep = 0; rep < 2 * in_flight.size(); rep++) {
+                in_flight[rep % in_flight.size()] = frame_via_packet_buffer(eth, ip, seg);
+            }
+
+            const size_t pool_before = PacketBuffer::pool_size();
+            const size_t before = allocations;
+            for (unsigned rep = 0; rep < NREPS; rep++) {
+                in_flight[rep % in_flight.size()] = frame_via_packet_buffer(eth, ip, seg);
+            }
+            if (allocations != before) {
+                throw runtime_error(to_string(allocations - before) + " allocations for " + to_string(NREPS) +
+                                    " packets from a warm pool");
+            }
+            if (PacketBuffer::pool_size() != pool_before) {
+                throw runtime_error("pool grew although blocks were released");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,200 @@
+#include "arp_message.hh"
+#include "ethernet_frame.hh"
+#include "ipv4_datagram.hh"
+#include "router.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace std;
+using namespace std::chrono;
+
+static constexpr size_t NINTERFACES = 4;
+static constexpr size_t NHANDOFF = 100;
+
+static EthernetAddress router_eth(const size_t i) { return {0x02, 0, 0, 0, 0, uint8_t(i + 1)}; }
+static EthernetAddress host_eth(const size_t i) { return {0x02, 0, 0, 0, 1, uint8_t(i + 1)}; }
+static uint32_t router_ip(const size_t i) { return 0x0a000001 | (i << 8); }  // 10.0.i.1
+static uint32_t host_ip(const size_t i) { return 0x0a000002 | (i << 8); }    // 10.0.i.2
+
+static EthernetFrame make_frame(const EthernetAddress &src, const EthernetAddress &dst, const uint16_t type) {
+    EthernetFrame frame;
+    frame.header() = {dst, src, type};
+    return frame;
+}
+
+//! Host `i` tells router interface `i` where it is
+static EthernetFrame arp_reply(const size_t i) {
+    ARPMessage arp;
+    arp.opcode = ARPMessage::OPCODE_REPLY;
+    arp.sender_ethernet_address = host_eth(i);
+    arp.sender_ip_address = host_ip(i);
+    arp.target_ethernet_address = router_eth(i);
+    arp.target_ip_address = router_ip(i);
+    EthernetFrame frame = make_frame(host_eth(i), router_eth(i), EthernetHeader::TYPE_ARP);
+    frame.payload() = arp.serialize();
+    return frame;
+}
+
+//! A datagram from host `i` to `dst`, sent to router interface `i`
+static EthernetFrame datagram_frame(const size_t i, const uint32_t dst, const uint16_t id) {
+    InternetDatagram dgram;
+    dgram.header().src = host_ip(i);
+    dgram.header().dst = dst;
+    dgram.header().id = id;
+    dgram.payload() = string("datagram " + to_string(id));
+    dgram.header().len = dgram.header().hlen * 4 + dgram.payload().size();
+    EthernetFrame frame = make_frame(host_eth(i), router_eth(i), EthernetHeader::TYPE_IPv4);
+    frame.payload() = dgram.serialize().concatenate();
+    return frame;
+}
+
+static void push(Router &router, const size_t i, EthernetFrame &&frame) {
+    if (not router.push_frame(i, move(frame))) {
+        throw runtime_error("input queue of interface " + to_string(i) + " is full");
+    }
+}
+
+//! The datagram carried by `frame`, if it is an IPv4 frame
+static optional<InternetDatagram> datagram_in(const EthernetFrame &frame) {
+    if (frame.header().type != EthernetHeader::TYPE_IPv4) {
+        return nullopt;
+    }
+    InternetDatagram dgram;
+    if (dgram.parse(frame.payload().concatenate()) != ParseResult::NoError) {
+        throw runtime_error("router sent a bad IPv4 datagram");
+    }
+    return dgram;
+}
+
+//! Wait for router interface `i` to send a datagram, skipping other frames
+static pair<EthernetFrame, InternetDatagram> expect_datagram(Router &router, const size_t i) {
+    const auto deadline = steady_clock::now() + seconds(10);
+    while (steady_clock::now() < deadline) {
+        auto frame = router.pop_frame(i);
+        if (not frame.has_value()) {
+            this_thread::yield();
+            continue;
+        }
+        if (auto dgram = datagram_in(frame.value()); dgram.has_value()) {
+            return {move(frame.value()), move(dgram.value())};
+        }
+    }
+    throw runtime_error("timed out waiting for a datagram on interface " + to_string(i));
+}
+
+static void check_forwarded(const pair<EthernetFrame, InternetDatagram> &sent,
+                            const EthernetAddress &expected_dst,
+                            const uint16_t expected_id) {
+    const auto &[frame, dgram] = sent;
+    if (frame.header().dst != expected_dst) {
+        throw runtime_error("datagram sent to the wrong Ethernet address: " + frame.header().to_string());
+    }
+    if (dgram.header().id != expected_id) {
+        throw runtime_error("expected datagram " + to_string(expected_id) + ", got " + dgram.header().summary());
+    }
+    if (dgram.header().ttl != IPv4Header::DEFAULT_TTL - 1) {
+        throw runtime_error("TTL was not decremented: " + dgram.header().summary());
+    }
+}
+
+int main() {
+    try {
+        cerr.setstate(ios::failbit);  // no DEBUG lines from the interfaces and routes
+        Router router;
+        for (size_t i = 0; i < NINTERFACES; i++) {
+            router.add_interface(AsyncNetworkInterface{router_eth(i), Address::from_ipv4_numeric(router_ip(i))});
+            router.add_route(router_ip(i) & 0xffffff00, 24, {}, i);
+        }
+        cerr.clear();
+
+        router.start_workers();
+        if (not router.workers_running()) {
+            throw runtime_error("workers did not start");
+        }
+        try {
+            router.add_interface(AsyncNetworkInterface{router_eth(9), Address::from_ipv4_numeric(router_ip(9))});
+            throw logic_error("add_interface() succeeded while the workers were running");
+        } catch (const runtime_error &) {
+        }
+
+        for (size_t i = 0; i < NINTERFACES; i++) {
+            push(router, i, arp_reply(i));
+        }
+
+        // every host to every other host
+        uint16_t id = 0;
+        for (size_t from = 0; from < NINTERFACES; from++) {
+            for (size_t to = 0; to < NINTERFACES; to++) {
+                if (from != to) {
+                    push(router, from, datagram_frame(from, host_ip(to), ++id));
+                    check_forwarded(expect_datagram(router, to), host_eth(to), id);
+                }
+            }
+        }
+
+        // a route added while the workers run applies to the next datagram
+        router.add_route(0x0a000280, 25, Address::from_ipv4_numeric(host_ip(3)), 3);  // 10.0.2.128/25
+        push(router, 0, datagram_frame(0, 0x0a0002c8, ++id));                         // 10.0.2.200
+        check_forwarded(expect_datagram(router, 3), host_eth(3), id);
+
+        // so do routes added in bulk; one to an interface that does not exist adds none of them
+        try {
+            router.add_routes({{0x0a000300, 25, Address::from_ipv4_numeric(host_ip(1)), 1},  // 10.0.3.0/25
+                               {0x0a000380, 25, {}, NINTERFACES}});
+            throw logic_error("add_routes() accepted a route to a nonexistent interface");
+        } catch (const runtime_error &) {
+        }
+        cerr.setstate(ios::failbit);
+        try {
+            router.add_route(0x0a000300, 25, {}, NINTERFACES);
+            throw logic_error("add_route() accepted a route to a nonexistent interface");
+        } catch (const runtime_error &) {
+        }
+        cerr.clear();
+        router.add_routes({{0x0a000300, 25, Address::from_ipv4_numeric(host_ip(1)), 1},  // 10.0.3.0/25
+                           {0x0a000380, 25, Address::from_ipv4_numeric(host_ip(2)), 2}});
+        push(router, 0, datagram_frame(0, 0x0a000310, ++id));  // 10.0.3.16
+        check_forwarded(expect_datagram(router, 1), host_eth(1), id);
+        push(router, 0, datagram_frame(0, 0x0a000390, ++id));  // 10.0.3.144
+        check_forwarded(expect_datagram(router, 2), host_eth(2), id);
+
+        // frames still queued when the workers stop are handed to the interfaces, in order
+        const uint16_t first_id = id + 1;
+        for (size_t i = 0; i < NHANDOFF; i++) {
+            push(router, 2, datagram_frame(2, host_ip(1), ++id));
+        }
+        router.stop_workers();
+        if (router.workers_running()) {
+            throw runtime_error("workers did not stop");
+        }
+        router.route();
+        auto &frames = router.interface(1).frames_out();
+        for (size_t i = 0; i < NHANDOFF; i++) {
+            optional<InternetDatagram> dgram;
+            while (not dgram.has_value() and not frames.empty()) {
+                dgram = datagram_in(frames.front());
+                frames.pop();
+            }
+            if (not dgram.has_value() or dgram->header().id != first_id + i) {
+                throw runtime_error("datagram " + to_string(first_id + i) + " lost or reordered when stopping");
+            }
+        }
+
+        if (router.fabric_drops() != 0) {
+            throw runtime_error("datagrams dropped between workers");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,126 @@
+#include "arp_message.hh"
+#include "ethernet_header.hh"
+#include "ipv4_header.hh"
+#include "tcp_header.hh"
+#include "util.hh"
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+// Count calls to operator new, to check that serialize_into() never allocates
+
+static size_t allocations = 0;
+
+void *operator new(const size_t size) {
+    allocations++;
+    if (void *ptr = malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+static constexpr unsigned NREPS = 1000;
+
+//! Room for a whole Ethernet + IPv4 + TCP header stack
+static constexpr size_t HEADROOM = EthernetHeader::LENGTH + IPv4Header::LENGTH + TCPHeader::LENGTH;
+static_assert(HEADROOM == 54);
+
+static void check_same(const uint8_t *written, const string &expected, const string &what) {
+    if (string(reinterpret_cast<const char *>(written), expected.size()) != expected) {
+        throw runtime_error(what + ": serialize_into() and serialize() disagree");
+    }
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        for (unsigned rep = 0; rep < NREPS; rep++) {
+            EthernetHeader eth;
+            eth.dst = {uint8_t(rd()), 2, 3, 4, 5, uint8_t(rd())};
+            eth.src = {uint8_t(rd()), 7, 8, 9, 10, uint8_t(rd())};
+            eth.type = EthernetHeader::TYPE_IPv4;
+
+            IPv4Header ip;
+            ip.tos = rd();
+            ip.len = rd();
+            ip.id = rd();
+            ip.df = rd() % 2;
+            ip.offset = rd();
+            ip.ttl = rd();
+            ip.cksum = rd();
+            ip.src = rd();
+            ip.dst = rd();
+
+            TCPHeader tcp;
+            tcp.sport = rd();
+            tcp.dport = rd();
+            tcp.seqno = WrappingInt32{uint32_t(rd())};
+            tcp.ackno = WrappingInt32{uint32_t(rd())};
+            tcp.ack = rd() % 2;
+            tcp.syn = rd() % 2;
+            tcp.fin = rd() % 2;
+            tcp.win = rd();
+            tcp.cksum = rd();
+
+            ARPMessage arp;
+            arp.opcode = rd() % 2 ? ARPMessage::OPCODE_REQUEST : ARPMessage::OPCODE_REPLY;
+            arp.sender_ethernet_address = eth.src;
+            arp.sender_ip_address = rd();
+            arp.target_ethernet_address = eth.dst;
+            arp.target_ip_address = rd();
+
+            // the whole header stack goes into one preallocated area, with no heap allocation
+            array<uint8_t, HEADROOM> headroom{};
+            array<uint8_t, ARPMessage::LENGTH> arp_bytes{};
+            const size_t before = allocations;
+            eth.serialize_into(headroom.data());
+            ip.serialize_into(headroom.data() + EthernetHeader::LENGTH);
+            tcp.serialize_into(headroom.data() + EthernetHeader::LENGTH + IPv4Header::LENGTH);
+            arp.serialize_into(arp_bytes.data());
+            if (allocations != before) {
+                throw runtime_error("serialize_into() allocated " + to_string(allocations - before) + " times");
+            }
+
+            check_same(headroom.data(), eth.serialize(), "Ethernet header");
+            check_same(headroom.data() + EthernetHeader::LENGTH, ip.serialize(), "IPv4 header");
+            check_same(headroom.data() + EthernetHeader::LENGTH + IPv4Header::LENGTH, tcp.serialize(), "TCP header");
+            check_same(arp_bytes.data(), arp.serialize(), "ARP message");
+
+            // and they read back as what was written
+            IPv4Header parsed_ip;
+            NetParser p{string(reinterpret_cast<const char *>(headroom.data()) + EthernetHeader::LENGTH,
+                               IPv4Header::LENGTH + TCPHeader::LENGTH)};
+            parsed_ip.parse(p);
+            if (parsed_ip.src != ip.src or parsed_ip.dst != ip.dst or parsed_ip.id != ip.id) {
+                throw runtime_error("serialized IPv4 header parses differently: " + parsed_ip.to_string());
+            }
+        }
+
+        // options are zero-filled up to the advertised length
+        {
+            IPv4Header ip;
+            ip.hlen = 6;
+            array<uint8_t, 24> out;
+            out.fill(0xff);
+            ip.serialize_into(out.data());
+            check_same(out.data(), ip.serialize(), "IPv4 header with options");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,183 @@
+#include "ethernet_frame.hh"
+#include "ipv4_datagram.hh"
+#include "tcp_frame.hh"
+#include "tcp_segment.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+static constexpr unsigned NREPS = 20000;
+
+//! What the layered parsers make of a frame
+struct Layered {
+    ParseResult result = ParseResult::NoError;
+    EthernetHeader eth{};
+    IPv4Header ip{};
+    TCPSegment seg{};
+};
+
+//! IPv4Datagram::parse() and TCPSegment::parse()
+static Layered parse_layered_ipv4(const string &raw) {
+    Layered ret;
+    IPv4Datagram dgram;
+    ret.result = dgram.parse(string(raw));
+    ret.ip = dgram.header();
+    if (ret.result != ParseResult::NoError) {
+        return ret;
+    }
+    if (dgram.header().proto != IPv4Header::PROTO_TCP) {
+        ret.result = ParseResult::Unsupported;
+        return ret;
+    }
+
+    ret.result = ret.seg.parse(dgram.payload(), dgram.header().pseudo_cksum());
+    return ret;
+}
+
+//! EthernetFrame::parse(), then as parse_layered_ipv4()
+static Layered parse_layered(const string &raw) {
+    EthernetFrame frame;
+    const ParseResult result = frame.parse(string(raw));
+    if (result != ParseResult::NoError) {
+        return {result, frame.header(), {}, {}};
+    }
+    if (frame.header().type != EthernetHeader::TYPE_IPv4) {
+        return {ParseResult::Unsupported, frame.header(), {}, {}};
+    }
+
+    Layered ret = parse_layered_ipv4(frame.payload().concatenate());
+    ret.eth = frame.header();
+    return ret;
+}
+
+static void check_same(const TCPFrame &frame, const ParseResult result, const Layered &expected, const bool eth) {
+    if (result != expected.result) {
+        throw runtime_error("TCPFrame returned " + as_string(result) + ", layered parsers " +
+                            as_string(expected.result));
+    }
+    if (result != ParseResult::NoError) {
+        return;
+    }
+
+    if (eth and frame.ethernet_header().to_string() != expected.eth.to_string()) {
+        throw runtime_error("Ethernet headers differ: " + frame.ethernet_header().to_string());
+    }
+    if (frame.ip_header().to_string() != expected.ip.to_string()) {
+        throw runtime_error("IPv4 headers differ: " + frame.ip_header().to_string());
+    }
+    if (frame.segment().header().to_string() != expected.seg.header().to_string()) {
+        throw runtime_error("TCP headers differ: " + frame.segment().header().to_string());
+    }
+    if (frame.segment().payload().str() != expected.seg.payload().str()) {
+        throw runtime_error("TCP payloads differ");
+    }
+}
+
+static string random_frame(mt19937 &rd, const bool damage = true) {
+    TCPSegment seg;
+    seg.header().sport = rd();
+    seg.header().dport = rd();
+    seg.header().seqno = WrappingInt32{uint32_t(rd())};
+    seg.header().ackno = WrappingInt32{uint32_t(rd())};
+    seg.header().ack = rd() % 2;
+    seg.header().syn = rd() % 2;
+    seg.header().fin = rd() % 2;
+    seg.header().psh = rd() % 2;
+    seg.header().win = rd();
+    seg.header().uptr = rd() % 4 ? 0 : rd();
+    seg.header().doff = rd() % 4 ? 5 : 5 + rd() % 11;  // mostly without options
+    string payload(rd() % 1461, 0);
+    generate(payload.begin(), payload.end(), [&] { return rd(); });
+    seg.payload() = Buffer{move(payload)};
+
+    IPv4Datagram dgram;
+    dgram.header().hlen = rd() % 8 ? 5 : 5 + rd() % 11;
+    dgram.header().src = rd();
+    dgram.header().dst = rd();
+    dgram.header().id = rd();
+    dgram.header().ttl = rd();
+    dgram.header().proto = rd() % 8 ? IPv4Header::PROTO_TCP : 17;
+    dgram.header().len = dgram.header().hlen * 4 + seg.header().doff * 4 + seg.payload().size();
+    dgram.payload() = seg.serialize(dgram.header().pseudo_cksum());
+
+    EthernetFrame frame;
+    frame.header().dst = {2, 0, 0, 0, 0, uint8_t(rd())};
+    frame.header().src = {2, 0, 0, 0, 1, uint8_t(rd())};
+    frame.header().type = rd() % 8 ? EthernetHeader::TYPE_IPv4 : EthernetHeader::TYPE_ARP;
+    frame.payload() = dgram.serialize();
+    string raw = frame.serialize().concatenate();
+
+    // damage some of the frames
+    switch (damage ? rd() % 4 : 3) {
+        case 0:
+            raw.at(rd() % raw.size()) ^= 1 << (rd() % 8);
+            break;
+        case 1:
+            raw.resize(rd() % raw.size());
+            break;
+        default:
+            break;
+    }
+    return raw;
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        unsigned parsed = 0;
+
+        for (unsigned rep = 0; rep < NREPS; rep++) {
+            const string raw = random_frame(rd);
+
+            TCPFrame frame;
+            const ParseResult result = frame.parse(string(raw));
+            check_same(frame, result, parse_layered(raw), true);
+            parsed += result == ParseResult::NoError;
+
+            // the same datagram without its Ethernet header, as read from a TUN device
+            if (raw.size() >= EthernetHeader::LENGTH) {
+                const string datagram = raw.substr(EthernetHeader::LENGTH);
+                TCPFrame from_tun;
+                check_same(from_tun, from_tun.parse_ipv4(string(datagram)), parse_layered_ipv4(datagram), false);
+            }
+        }
+
+        if (parsed < NREPS / 4) {
+            throw runtime_error("only " + to_string(parsed) + " frames were valid");
+        }
+
+        // trusted checksums are not looked at, with or without options
+        for (unsigned rep = 0; rep < NREPS / 10; rep++) {
+            string raw = random_frame(rd, false);
+            const Layered expected = parse_layered(raw);
+            if (expected.result != ParseResult::NoError) {
+                continue;
+            }
+            const size_t tcp_cksum_offset = EthernetHeader::LENGTH + expected.ip.hlen * 4 + 16;
+            raw.at(EthernetHeader::LENGTH + 10) ^= 0x5a;  // IPv4 header checksum
+            raw.at(tcp_cksum_offset) ^= 0xa5;             // TCP checksum
+
+            TCPFrame frame;
+            if (frame.parse(string(raw)) != ParseResult::BadChecksum) {
+                throw runtime_error("bad checksum not noticed");
+            }
+            const ParseResult result = frame.parse(string(raw), TCPFrame::Checksums::Trusted);
+            if (result != ParseResult::NoError or frame.segment().payload().str() != expected.seg.payload().str()) {
+                throw runtime_error("parse with trusted checksums returned " + as_string(result));
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,233 @@
+#include "address.hh"
+#include "buffer.hh"
+#include "packet_buffer.hh"
+#include "socket.hh"
+#include "util.hh"
+
+#include <cerrno>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//! A UDP socket bound to an ephemeral port on the loopback interface
+static UDPSocket loopback_socket() {
+    UDPSocket sock;
+    sock.bind(Address("127.0.0.1", 0));
+    return sock;
+}
+
+//! `n` payloads of `size` bytes each (the last `last_size` bytes), each in two pieces, with distinct contents
+static vector<BufferList> make_payloads(const size_t n, const size_t size, const size_t last_size) {
+    vector<BufferList> ret;
+    for (size_t i = 0; i < n; i++) {
+        string payload = to_string(i);
+        payload.resize(i + 1 == n ? last_size : size, static_cast<char>('a' + i % 26));
+        BufferList data{payload.substr(0, payload.size() / 2)};
+        data.append(BufferList{payload.substr(payload.size() / 2)});
+        ret.push_back(move(data));
+    }
+    return ret;
+}
+
+//! Receive with recv_batch() until `expected` datagrams arrived, and check them
+static void expect_datagrams(UDPSocket &receiver,
+                             const Address &source,
+                             const vector<BufferList> &expected,
+                             const string &what) {
+    vector<UDPSocket::received_datagram> received, batch;
+    while (received.size() < expected.size()) {
+        receiver.recv_batch(batch, expected.size() - received.size());
+        if (batch.empty()) {
+            throw runtime_error(what + ": recv_batch() returned no datagram");
+        }
+        for (auto &dgram : batch) {
+            received.push_back(move(dgram));
+        }
+    }
+    if (received.size() != expected.size()) {
+        throw runtime_error(what + ": received " + to_string(received.size()) + " datagrams, expected " +
+                            to_string(expected.size()));
+    }
+    for (size_t i = 0; i < expected.size(); i++) {
+        if (received[i].payload != expected[i].concatenate() or received[i].source_address != source) {
+            throw runtime_error(what + ": datagram " + to_string(i) + " differs");
+        }
+    }
+}
+
+//! send_batch() sends each payload as its own datagram, and recv_batch() takes only what is waiting
+static void check_batch() {
+    UDPSocket sender = loopback_socket(), receiver = loopback_socket();
+    const auto payloads = make_payloads(100, 500, 37);  // more than UDPSocket::MAX_BATCH
+
+    sender.send_batch(receiver.local_address(), payloads);
+    if (sender.write_count() != payloads.size()) {
+        throw runtime_error("batch: " + to_string(sender.write_count()) + " writes counted");
+    }
+
+    vector<UDPSocket::received_datagram> batch;
+    receiver.recv_batch(batch, 10);
+    if (batch.size() != 10 or receiver.read_count() != 10) {
+        throw runtime_error("batch: recv_batch() did not stop at n datagrams");
+    }
+    expect_datagrams(receiver,
+                     sender.local_address(),
+                     vector<BufferList>(payloads.begin() + 10, payloads.end()),
+                     "batch");
+
+    // nothing is waiting: a non-blocking socket does not wait for the first datagram
+    receiver.set_blocking(false);
+    try {
+        receiver.recv_batch(batch, 10);
+    } catch (const unix_error &e) {
+        if (e.code().value() == EAGAIN) {
+            return;
+        }
+        throw;
+    }
+    throw runtime_error("batch: recv_batch() on an empty non-blocking socket did not fail with EAGAIN");
+}
+
+//! With GSO, runs of equal-sized payloads still arrive as separate datagrams, and GRO is undone by recv_batch()
+static void check_gso_gro() {
+    UDPSocket sender = loopback_socket(), receiver = loopback_socket();
+    receiver.set_gro(true);
+
+    // two runs of equal sizes, each ending in a shorter payload, then a run too long for one GSO datagram
+    vector<BufferList> payloads = make_payloads(10, 1200, 300);
+    for (auto &&payload : make_payloads(5, 800, 800)) {
+        payloads.push_back(move(payload));
+    }
+    for (auto &&payload : make_payloads(70, 100, 100)) {
+        payloads.push_back(move(payload));
+    }
+
+    try {
+        sender.send_batch(receiver.local_address(), payloads, true);
+    } catch (const unix_error &e) {
+        if (e.code().value() == EINVAL or e.code().value() == ENOPROTOOPT or e.code().value() == EIO) {
+            cerr << "UDP GSO is not available (" << e.what() << "); skipping" << endl;
+            return;
+        }
+        throw;
+    }
+    if (sender.write_count() != payloads.size()) {
+        throw runtime_error("gso: " + to_string(sender.write_count()) + " writes counted");
+    }
+    expect_datagrams(receiver, sender.local_address(), payloads, "gso");
+    if (receiver.read_count() != payloads.size()) {
+        throw runtime_error("gso: " + to_string(receiver.read_count()) + " reads counted");
+    }
+}
+
+//! Datagrams received into pooled blocks are intact, and the blocks are recycled once released
+static void check_pooled() {
+    UDPSocket sender = loopback_socket(), receiver = loopback_socket();
+    const auto payloads = make_payloads(32, 1400, 40);
+    const size_t pool_before = PacketBuffer::pool_size();
+
+    for (unsigned rep = 0; rep < 20; rep++) {
+        sender.send_batch(receiver.local_address(), payloads);
+
+        // half one at a time, half in batches
+        vector<UDPSocket::received_buffer> batch;
+        for (size_t i = 0; i < payloads.size();) {
+            if (i < payloads.size() / 2) {
+                UDPSocket::received_buffer dgram{{nullptr, 0}, {}};
+                receiver.recv(dgram);
+                batch = {dgram};
+            } else {
+                receiver.recv_batch(batch, payloads.size() - i);
+            }
+            for (const auto &dgram : batch) {
+                if (dgram.payload.str() != payloads[i].concatenate() or
+                    dgram.source_address != sender.local_address()) {
+                    throw runtime_error("pooled: datagram " + to_string(i) + " differs");
+                }
+                i++;
+            }
+        }
+    }
+    if (PacketBuffer::pool_size() > pool_before + UDPSocket::MAX_BATCH + 1) {
+        throw runtime_error("pooled: " + to_string(PacketBuffer::pool_size() - pool_before) +
+                            " blocks for at most " + to_string(payloads.size()) + " datagrams in use at once");
+    }
+
+    // too long for a pooled block: received whole and counted, alone or in the middle of a batch
+    const string longer(PacketBuffer::BLOCK_SIZE + 1, 'x'), longest(60000, 'y');
+    sender.sendto(receiver.local_address(), longer);
+    UDPSocket::received_buffer dgram{{nullptr, 0}, {}};
+    receiver.recv(dgram);
+    if (dgram.payload.str() != longer or dgram.source_address != sender.local_address() or receiver.oversized() != 1) {
+        throw runtime_error("pooled: oversized datagram was not received whole");
+    }
+    sender.sendto(receiver.local_address(), string("before"));
+    sender.sendto(receiver.local_address(), longest);
+    sender.sendto(receiver.local_address(), longer);
+    sender.sendto(receiver.local_address(), string("after"));
+    vector<UDPSocket::received_buffer> batch;
+    while (batch.size() < 4) {
+        vector<UDPSocket::received_buffer> more;
+        receiver.recv_batch(more, 4 - batch.size());
+        for (auto &received : more) {
+            batch.push_back(move(received));
+        }
+    }
+    if (batch[0].payload.str() != "before" or batch[1].payload.str() != longest or batch[2].payload.str() != longer or
+        batch[3].payload.str() != "after" or receiver.oversized() != 3) {
+        throw runtime_error("pooled: oversized datagrams in a batch were not received whole");
+    }
+}
+
+//! With GRO, datagrams are received into large blocks, which are reused from one batch to the next
+static void check_pooled_gro() {
+    UDPSocket sender = loopback_socket(), receiver = loopback_socket();
+    receiver.set_gro(true);
+    const auto payloads = make_payloads(40, 1000, 1000);
+    const size_t slots = 4;
+
+    vector<UDPSocket::received_buffer> batch;
+    for (unsigned rep = 0; rep < 50; rep++) {
+        try {
+            sender.send_batch(receiver.local_address(), payloads, true);
+        } catch (const unix_error &e) {
+            if (e.code().value() == EINVAL or e.code().value() == ENOPROTOOPT or e.code().value() == EIO) {
+                cerr << "UDP GSO is not available (" << e.what() << "); skipping" << endl;
+                return;
+            }
+            throw;
+        }
+        for (size_t i = 0; i < payloads.size();) {
+            receiver.recv_batch(batch, slots, PacketBuffer::LARGE_BLOCK_SIZE);
+            for (const auto &dgram : batch) {
+                if (dgram.payload.str() != payloads[i].concatenate()) {
+                    throw runtime_error("pooled gro: datagram " + to_string(i) + " differs");
+                }
+                i++;
+            }
+        }
+    }
+    if (PacketBuffer::large_pool_size() > 2 * slots) {
+        throw runtime_error("pooled gro: " + to_string(PacketBuffer::large_pool_size()) + " large blocks for " +
+                            to_string(slots) + " slots");
+    }
+}
+
+int main() {
+    try {
+        check_batch();
+        check_gso_gro();
+        check_pooled();
+        check_pooled_gro();
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}